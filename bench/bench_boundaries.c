@@ -0,0 +1,186 @@
+/**
+ * @file bench_boundaries.c
+ * @brief Benchmark of the core boundary search on real variant positions.
+ *
+ * Processes the reference as `-vgx` does, then resolves the boundaries of
+ * every VCF record with the former search (5-core window, whole-chromosome
+ * binary search otherwise, and a linear scan for the end boundary) on the
+ * plain core arrays and with the galloping `find_boundaries` on the compacted
+ * core tables. Both are driven by the previous hit as in the vgx workers and
+ * must agree on every record. Only the searches are timed.
+ *
+ * Usage: bench_boundaries ref.fa var.vcf[.gz] [lcp_level] [repeat]
+ */
+
+#include "struct_def.h"
+#include "fa_parser.h"
+#include "utils.h"
+#include "bench_util.h"
+
+struct bench_query {
+    int chrom_index;
+    uint64_t start_loc;
+    uint64_t end_loc;
+};
+
+static void find_boundaries_scan(uint64_t start_loc, uint64_t end_loc, const struct simple_core *cores, uint64_t cores_size, uint64_t start_index, uint64_t *latest_core_index, uint64_t *first_core_after) {
+
+    uint64_t core_idx_1 = cores[start_index].end <= start_loc ? start_index : 0;
+    int left, mid, right;
+
+    left = core_idx_1;
+    right = core_idx_1+5 < cores_size && end_loc < cores[core_idx_1+5].start ? core_idx_1+5 : cores_size;
+    while (left < right) {
+        mid = left + (right - left) / 2;
+        if (cores[mid].end <= start_loc) {
+            core_idx_1 = mid;
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+
+    while (core_idx_1 && start_loc < cores[core_idx_1].end ) {
+        core_idx_1--;
+    }
+
+    *latest_core_index = core_idx_1;
+    *first_core_after = cores_size;
+    for (uint64_t j=core_idx_1; j<cores_size; j++) {
+        if (end_loc <= cores[j].start) {
+            *first_core_after = j;
+            return;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s ref.fa var.vcf[.gz] [lcp_level] [repeat]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int repeat = argc > 4 ? atoi(argv[4]) : 5;
+
+    struct opt_arg args;
+    memset(&args, 0, sizeof(args));
+    args.program = VGX;
+    args.fasta_path = argv[1];
+    args.fasta_fai_path = (char *)malloc(strlen(argv[1])+5);
+    sprintf(args.fasta_fai_path, "%s.fai", argv[1]);
+    args.lcp_level = argc > 3 ? atoi(argv[3]) : 4;
+    args.thread_number = 1;
+    args.core_id_index = 1;
+
+    LCP_INIT();
+
+    struct ref_seq seqs;
+    read_fasta(&args, &seqs);
+    refine_seqs(&seqs, 1);
+
+    // keep the plain cores for the former search
+    struct simple_core **plain_cores = (struct simple_core **)malloc(seqs.size * sizeof(struct simple_core *));
+    for (int i=0; i<seqs.size; i++) {
+        plain_cores[i] = (struct simple_core *)malloc(seqs.chrs[i].cores_size * sizeof(struct simple_core));
+        if (seqs.chrs[i].cores_size) {
+            memcpy(plain_cores[i], seqs.chrs[i].cores, seqs.chrs[i].cores_size * sizeof(struct simple_core));
+        }
+    }
+    compact_ref_cores(&seqs, 1);
+
+    bgzf_file_t *file = bgzf_open(argv[2], 1);
+    if (file == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't open file %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t capacity = 1048576, size = 0, line_capacity = 1048576;
+    struct bench_query *queries = (struct bench_query *)malloc(capacity * sizeof(struct bench_query));
+    char *line = (char *)malloc(line_capacity);
+    int64_t len;
+    while ((len = bgzf_getline(file, &line, &line_capacity)) != -1) {
+        if (len < 2 || line[0] == '#') continue;
+
+        char *saveptr;
+        char *chrom = strtok_r(line, "\t", &saveptr);
+        char *pos   = strtok_r(NULL, "\t", &saveptr);
+        strtok_r(NULL, "\t", &saveptr); // ID
+        char *ref   = strtok_r(NULL, "\t", &saveptr);
+        if (pos == NULL || ref == NULL) continue;
+
+        int chrom_index = find_chr(&seqs, chrom);
+        if (chrom_index == -1 || seqs.chrs[chrom_index].cores_size == 0) continue;
+
+        if (size == capacity) {
+            capacity *= 2;
+            queries = (struct bench_query *)realloc(queries, capacity * sizeof(struct bench_query));
+        }
+        uint64_t start_loc = strtoull(pos, NULL, 10) - 1;
+        queries[size++] = (struct bench_query){chrom_index, start_loc, start_loc + strlen(ref)};
+    }
+    bgzf_close(file);
+    free(line);
+
+    double best_scan = 0, best_gallop = 0;
+    for (int r=0; r<repeat; r++) {
+        for (int method=0; method<2; method++) {
+            int prev_chrom = -1;
+            uint64_t latest = 0, latest_other = 0, first_after, first_after_other;
+
+            double start = now_sec();
+            for (uint64_t q=0; q<size; q++) {
+                const struct chr *chrom = &(seqs.chrs[queries[q].chrom_index]);
+                if (queries[q].chrom_index != prev_chrom) {
+                    prev_chrom = queries[q].chrom_index;
+                    latest = 0;
+                }
+                if (method == 0) {
+                    find_boundaries_scan(queries[q].start_loc, queries[q].end_loc, plain_cores[queries[q].chrom_index], chrom->cores_size, latest, &latest, &first_after);
+                } else {
+                    find_boundaries(queries[q].start_loc, queries[q].end_loc, chrom, latest, &latest, &first_after);
+                }
+            }
+            double elapsed = now_sec() - start;
+
+            if (method == 0) {
+                best_scan = (r == 0 || elapsed < best_scan) ? elapsed : best_scan;
+            } else {
+                best_gallop = (r == 0 || elapsed < best_gallop) ? elapsed : best_gallop;
+            }
+
+            // verify on the first round only (outside the timed loop)
+            if (r == 0 && method == 1) {
+                prev_chrom = -1;
+                for (uint64_t q=0; q<size; q++) {
+                    const struct chr *chrom = &(seqs.chrs[queries[q].chrom_index]);
+                    if (queries[q].chrom_index != prev_chrom) {
+                        prev_chrom = queries[q].chrom_index;
+                        latest = latest_other = 0;
+                    }
+                    find_boundaries_scan(queries[q].start_loc, queries[q].end_loc, plain_cores[queries[q].chrom_index], chrom->cores_size, latest_other, &latest_other, &first_after_other);
+                    find_boundaries(queries[q].start_loc, queries[q].end_loc, chrom, latest, &latest, &first_after);
+                    if (latest != latest_other || first_after != first_after_other) {
+                        fprintf(stderr, "[ERROR] Boundaries differ for %s:%lu (%lu,%lu vs %lu,%lu)\n", chrom->seq_name, queries[q].start_loc + 1,
+                                latest_other, first_after_other, latest, first_after);
+                        return EXIT_FAILURE;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("records\tscan_sec\tgallop_sec\tscan_ns_rec\tgallop_ns_rec\n");
+    printf("%lu\t%.4f\t%.4f\t%.1f\t%.1f\n", size, best_scan, best_gallop,
+           size ? best_scan / size * 1e9 : 0.0, size ? best_gallop / size * 1e9 : 0.0);
+
+    free(queries);
+    for (int i=0; i<seqs.size; i++) {
+        free(plain_cores[i]);
+    }
+    free(plain_cores);
+    free_ref_seq(&seqs);
+    free(args.fasta_fai_path);
+
+    return EXIT_SUCCESS;
+}
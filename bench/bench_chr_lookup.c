@@ -0,0 +1,88 @@
+/**
+ * @file bench_chr_lookup.c
+ * @brief Benchmark of chromosome name resolution on many-contig references.
+ *
+ * Compares the linear `strcmp` scan over `seqs->chrs` against `find_chr`
+ * for random VCF-like queries. The names are either synthetic scaffold
+ * names or read from a FASTA index, so no sequence is loaded.
+ *
+ * Usage: bench_chr_lookup [contigs|ref.fa.fai] [queries]
+ */
+
+#include "struct_def.h"
+#include "fa_parser.h"
+#include "bench_util.h"
+
+static int linear_find(const struct ref_seq *seqs, const char *name) {
+    for (int i=0; i<seqs->size; i++) {
+        if (strcmp(name, seqs->chrs[i].seq_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int is_fai(const char *path) {
+    size_t len = strlen(path);
+    return 4 <= len && strcmp(path + len - 4, ".fai") == 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    const char *source = argc > 1 ? argv[1] : "50000";
+    uint64_t queries = argc > 2 ? strtoull(argv[2], NULL, 10) : 100000;
+
+    struct ref_seq seqs;
+    memset(&seqs, 0, sizeof(seqs));
+
+    if (is_fai(source)) {
+        struct opt_arg args;
+        memset(&args, 0, sizeof(args));
+        args.fasta_fai_path = (char *)source;
+        read_fai(&args, &seqs);
+    } else {
+        seqs.size = atoi(source);
+        seqs.chrs = (struct chr *)calloc(seqs.size, sizeof(struct chr));
+        for (int i=0; i<seqs.size; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), "scaffold_%d_HRSCAF_%d", i, i * 7 + 3);
+            seqs.chrs[i].seq_name = strdup(name);
+        }
+        build_chr_name_table(&seqs);
+    }
+
+    // VCF records of a contig are adjacent, but every contig is visited
+    int *order = (int *)malloc(queries * sizeof(int));
+    uint64_t state = 42;
+    for (uint64_t q=0; q<queries; q++) {
+        order[q] = (int)(next_rand(&state) % seqs.size);
+    }
+
+    double start = now_sec();
+    uint64_t sum_linear = 0;
+    for (uint64_t q=0; q<queries; q++) {
+        sum_linear += linear_find(&seqs, seqs.chrs[order[q]].seq_name);
+    }
+    double linear_time = now_sec() - start;
+
+    start = now_sec();
+    uint64_t sum_hash = 0;
+    for (uint64_t q=0; q<queries; q++) {
+        sum_hash += find_chr(&seqs, seqs.chrs[order[q]].seq_name);
+    }
+    double hash_time = now_sec() - start;
+
+    if (sum_linear != sum_hash) {
+        fprintf(stderr, "[ERROR] Lookups differ (%lu vs %lu)\n", sum_linear, sum_hash);
+        return EXIT_FAILURE;
+    }
+
+    printf("contigs\tqueries\tlinear_sec\thash_sec\tlinear_ns_q\thash_ns_q\n");
+    printf("%d\t%lu\t%.3f\t%.3f\t%.1f\t%.1f\n", seqs.size, queries, linear_time, hash_time,
+           linear_time / queries * 1e9, hash_time / queries * 1e9);
+
+    free(order);
+    free_ref_seq(&seqs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file bench_gfa_out.c
+ * @brief Throughput benchmark of the GFA record emitters.
+ *
+ * Renders the same synthetic S and L records with `fprintf` into a stdio
+ * stream (the former output path) and with `print_seq`/`print_link` into a
+ * `gfa_stream_t`, and reports the rate of both.
+ *
+ * Usage: bench_gfa_out [records] [output]
+ */
+
+#include "struct_def.h"
+#include "utils.h"
+#include "bench_util.h"
+
+int main(int argc, char *argv[]) {
+
+    uint64_t records = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    const char *path = argc > 2 ? argv[2] : "/dev/null";
+
+    // typical core lengths and ids of a human-scale graph
+    char seq[64];
+    for (int i=0; i<64; i++) {
+        seq[i] = "ACGT"[(i * 7) % 4];
+    }
+    const char *seq_name = "chr1";
+    uint64_t base_id = 3000000000ULL;
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't open output file %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    double start = now_sec();
+    for (uint64_t i=0; i<records; i++) {
+        int seq_len = 16 + (int)(i % 48);
+        fprintf(out, "S\t%lu\t", base_id + i);
+        fwrite(seq, 1, seq_len, out);
+        fprintf(out, "\tSN:Z:%s\tSO:i:%d\tSR:i:%d\n", seq_name, (int)(i * 40), 0);
+        fprintf(out, "L\t%lu\t%c\t%lu\t%c\t%ldM\n", base_id + i - 1, '+', base_id + i, '+', (uint64_t)0);
+    }
+    fclose(out);
+    double stdio_time = now_sec() - start;
+
+    gfa_file_t file;
+    gfa_file_open(&file, path);
+    gfa_stream_t stream;
+    gfa_stream_open(&stream, &file);
+
+    start = now_sec();
+    for (uint64_t i=0; i<records; i++) {
+        int seq_len = 16 + (int)(i % 48);
+        print_seq(base_id + i, seq, seq_len, seq_name, (int)(i * 40), 0, 1, &stream);
+        print_link(base_id + i - 1, '+', base_id + i, '+', 0, &stream);
+        gfa_stream_sync(&stream, GFA_STREAM_FLUSH_SIZE);
+    }
+    gfa_stream_close(&stream);
+    gfa_file_close(&file);
+    double stream_time = now_sec() - start;
+
+    printf("records\tstdio_sec\tstream_sec\tstdio_mrec_s\tstream_mrec_s\n");
+    printf("%lu\t%.3f\t%.3f\t%.2f\t%.2f\n", records, stdio_time, stream_time,
+           2 * records / stdio_time / 1e6, 2 * records / stream_time / 1e6);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bench_large_coords.c
+ * @brief Check of the coordinate path on a chromosome longer than 4 Gbp.
+ *
+ * The chromosome is an anonymous mapping that is only written inside its LCP
+ * cores, so only one page per core becomes resident. The boundaries of random
+ * variations are resolved with `find_boundaries` on the compacted cores and
+ * compared against a plain binary search, and the cores are printed with
+ * `print_ref_seq` and parsed back to check the sequence and the SO tag. Only
+ * the searches are timed.
+ *
+ * Usage: bench_large_coords [size_gbp] [cores] [queries]
+ */
+
+#include "struct_def.h"
+#include "utils.h"
+#include "bench_util.h"
+#include <sys/mman.h>
+
+static uint64_t expected_latest(const struct chr *chrom, uint64_t start_loc) {
+    uint64_t low = 0, high = (uint64_t)chrom->cores_size;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (chrom->cores[mid].end <= start_loc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low ? low - 1 : 0;
+}
+
+static uint64_t expected_first_after(const struct chr *chrom, uint64_t end_loc) {
+    uint64_t low = 0, high = (uint64_t)chrom->cores_size;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (chrom->cores[mid].start < end_loc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int main(int argc, char *argv[]) {
+
+    uint64_t size    = (uint64_t)((argc > 1 ? atof(argv[1]) : 5.0) * 1e9);
+    int cores_size   = argc > 2 ? atoi(argv[2]) : 20000;
+    uint64_t queries = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000000;
+    uint64_t step    = size / cores_size;
+
+    if (step < 128) {
+        fprintf(stderr, "[ERROR] Too many cores for a %lu bp chromosome.\n", size);
+        return EXIT_FAILURE;
+    }
+
+    struct chr chrom;
+    memset(&chrom, 0, sizeof(chrom));
+    chrom.seq_name   = "chrL";
+    chrom.seq_size   = size;
+    chrom.cores_size = cores_size;
+    chrom.cores      = (struct simple_core *)malloc(cores_size * sizeof(struct simple_core));
+    chrom.seq        = (char *)mmap(NULL, size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (chrom.seq == MAP_FAILED) {
+        fprintf(stderr, "[ERROR] Couldn't map a %lu bp chromosome.\n", size);
+        return EXIT_FAILURE;
+    }
+
+    // bases are written only inside the cores, each base is a function of its position
+    for (int j=0; j<cores_size; j++) {
+        uint64_t start = (uint64_t)j * step + j % 7;
+        uint64_t end   = start + 50 + j % 40;
+        chrom.cores[j] = (struct simple_core){(uint64_t)j + 1, start, end};
+        for (uint64_t k=start; k<end; k++) {
+            chrom.seq[k] = "ACGT"[(k * 7 + k / 5) % 4];
+        }
+    }
+
+    compact_chr_cores(&chrom);
+
+    // variations of up to three cores long, from anywhere in the chromosome
+    uint64_t *starts = (uint64_t *)malloc(queries * sizeof(uint64_t));
+    uint64_t *ends   = (uint64_t *)malloc(queries * sizeof(uint64_t));
+    uint64_t state = 88172645463325252ULL;
+    for (uint64_t q=0; q<queries; q++) {
+        starts[q] = next_rand(&state) % (size - 3 * step);
+        ends[q]   = starts[q] + 1 + next_rand(&state) % (3 * step);
+    }
+
+    uint64_t latest, first_after;
+    double start = now_sec();
+    uint64_t checksum = 0;
+    for (uint64_t q=0; q<queries; q++) {
+        find_boundaries(starts[q], ends[q], &chrom, 0, &latest, &first_after);
+        checksum += latest + first_after;
+    }
+    double search_time = now_sec() - start;
+
+    for (uint64_t q=0; q<queries; q++) {
+        find_boundaries(starts[q], ends[q], &chrom, 0, &latest, &first_after);
+        if (latest != expected_latest(&chrom, starts[q]) || first_after != expected_first_after(&chrom, ends[q])) {
+            fprintf(stderr, "[ERROR] Boundaries of [%lu, %lu) are %lu,%lu, expected %lu,%lu.\n", starts[q], ends[q],
+                    latest, first_after, expected_latest(&chrom, starts[q]), expected_first_after(&chrom, ends[q]));
+            return EXIT_FAILURE;
+        }
+    }
+
+    gfa_file_t file;
+    gfa_file_open(&file, "/dev/null");
+    gfa_stream_t stream;
+    gfa_stream_open(&stream, &file);
+
+    uint64_t max_so = 0;
+    for (int j=0; j<cores_size; j++) {
+        const struct simple_core *core = &(chrom.cores[j]);
+        print_ref_seq(core_id(&chrom, j), &chrom, core_start(&chrom, j), core_end(&chrom, j), 1, &stream);
+        gfa_put_char(&stream, '\0');
+
+        uint64_t id, so;
+        char seq[128];
+        if (sscanf(stream.data, "S\t%lu\t%127s\tSN:Z:chrL\tSO:i:%lu\tSR:i:0\n", &id, seq, &so) != 3 || id != core->id ||
+            so != core->start || strlen(seq) != core->end - core->start || memcmp(seq, chrom.seq + core->start, strlen(seq)) != 0) {
+            fprintf(stderr, "[ERROR] Segment of core %d is printed as %s", j, stream.data);
+            return EXIT_FAILURE;
+        }
+        max_so = so;
+        stream.size = 0;
+    }
+
+    gfa_stream_close(&stream);
+    gfa_file_close(&file);
+
+    printf("size_bp\tcores\tqueries\tmax_so\tsearch_sec\tsearch_ns_q\tchecksum\n");
+    printf("%lu\t%d\t%lu\t%lu\t%.3f\t%.1f\t%lu\n", size, cores_size, queries, max_so, search_time,
+           search_time / queries * 1e9, checksum);
+
+    munmap(chrom.seq, size + 1);
+    free(chrom.cores);
+    free_core_table(&(chrom.table));
+    free(starts);
+    free(ends);
+
+    return EXIT_SUCCESS;
+}
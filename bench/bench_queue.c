@@ -0,0 +1,161 @@
+/**
+ * @file bench_queue.c
+ * @brief Push/pop throughput of the lock-free ring against the mutex queue.
+ *
+ * The mutex queue is the one `vg_work_queue_t` and `line_queue` used before
+ * (one mutex, two condition variables signalled on every operation).
+ * Every producer pushes `items` pointers and consumers pop until all of them
+ * are consumed.
+ *
+ * Usage: bench_queue [producers] [consumers] [items] [capacity]
+ */
+
+#include "mpmc.h"
+#include <stdio.h>
+#include <string.h>
+#include "bench_util.h"
+
+struct mutex_queue {
+    void **items;
+    int size;
+    int capacity;
+    int front;
+    int rear;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_not_full;
+    pthread_cond_t cond_not_empty;
+};
+
+static void mutex_queue_push(struct mutex_queue *queue, void *item) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size == queue->capacity) {
+        pthread_cond_wait(&queue->cond_not_full, &queue->mutex);
+    }
+    queue->items[queue->rear] = item;
+    queue->rear = (queue->rear + 1) % queue->capacity;
+    queue->size++;
+    pthread_cond_signal(&queue->cond_not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void *mutex_queue_pop(struct mutex_queue *queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size == 0) {
+        pthread_cond_wait(&queue->cond_not_empty, &queue->mutex);
+    }
+    void *item = queue->items[queue->front];
+    queue->front = (queue->front + 1) % queue->capacity;
+    queue->size--;
+    pthread_cond_signal(&queue->cond_not_full);
+    pthread_mutex_unlock(&queue->mutex);
+    return item;
+}
+
+struct bench_arg {
+    int use_ring;
+    uint64_t items;
+    struct mutex_queue *queue;
+    mpmc_ring_t *ring;
+    eventcount_t *not_full;
+    eventcount_t *not_empty;
+    int *exit_signal;
+    uint64_t sum;
+};
+
+static void *producer(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    for (uint64_t i=1; i<=b->items; i++) {
+        if (b->use_ring) {
+            mpmc_push(b->ring, (void *)(uintptr_t)i, b->not_full, b->not_empty);
+        } else {
+            mutex_queue_push(b->queue, (void *)(uintptr_t)i);
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    for (uint64_t i=0; i<b->items; i++) {
+        void *item = b->use_ring ? mpmc_pop(b->ring, b->not_full, b->not_empty, b->exit_signal) : mutex_queue_pop(b->queue);
+        b->sum += (uint64_t)(uintptr_t)item;
+    }
+    return NULL;
+}
+
+static double run(int use_ring, int producers, int consumers, uint64_t items, int capacity, uint64_t *sum) {
+    struct mutex_queue queue;
+    mpmc_ring_t ring;
+    eventcount_t not_full, not_empty;
+    int exit_signal = 0;
+
+    queue.items = (void **)malloc(capacity * sizeof(void *));
+    queue.size = queue.front = queue.rear = 0;
+    queue.capacity = capacity;
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.cond_not_full, NULL);
+    pthread_cond_init(&queue.cond_not_empty, NULL);
+    if (queue.items == NULL || !mpmc_init(&ring, capacity)) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to queues.\n");
+        exit(EXIT_FAILURE);
+    }
+    ec_init(&not_full);
+    ec_init(&not_empty);
+
+    pthread_t threads[producers + consumers];
+    struct bench_arg args[producers + consumers];
+    uint64_t total = items * producers;
+
+    double start = now_sec();
+
+    for (int i=0; i<producers+consumers; i++) {
+        int is_producer = i < producers;
+        int j = i - producers;
+        args[i] = (struct bench_arg){use_ring, is_producer ? items : total / consumers + ((uint64_t)j < total % consumers),
+                                     &queue, &ring, &not_full, &not_empty, &exit_signal, 0};
+        pthread_create(&threads[i], NULL, is_producer ? producer : consumer, &args[i]);
+    }
+
+    *sum = 0;
+    for (int i=0; i<producers+consumers; i++) {
+        pthread_join(threads[i], NULL);
+        *sum += args[i].sum;
+    }
+
+    double elapsed = now_sec() - start;
+
+    free(queue.items);
+    pthread_mutex_destroy(&queue.mutex);
+    pthread_cond_destroy(&queue.cond_not_full);
+    pthread_cond_destroy(&queue.cond_not_empty);
+    mpmc_free(&ring);
+    ec_destroy(&not_full);
+    ec_destroy(&not_empty);
+
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int producers = argc > 1 ? atoi(argv[1]) : 1;
+    int consumers = argc > 2 ? atoi(argv[2]) : 8;
+    uint64_t items = argc > 3 ? strtoull(argv[3], NULL, 10) : 2000000;
+    int capacity = argc > 4 ? atoi(argv[4]) : 2 * consumers;
+
+    uint64_t expected = producers * (items * (items + 1) / 2);
+    uint64_t sum_mutex, sum_ring;
+
+    double t_mutex = run(0, producers, consumers, items, capacity, &sum_mutex);
+    double t_ring = run(1, producers, consumers, items, capacity, &sum_ring);
+    double total = (double)items * producers;
+
+    printf("queue\tproducers\tconsumers\tcapacity\tseconds\tMops/s\n");
+    printf("mutex\t%d\t%d\t%d\t%.4f\t%.2f\n", producers, consumers, capacity, t_mutex, total / t_mutex / 1e6);
+    printf("ring\t%d\t%d\t%d\t%.4f\t%.2f\n", producers, consumers, capacity, t_ring, total / t_ring / 1e6);
+
+    if (sum_mutex != expected || sum_ring != expected) {
+        fprintf(stderr, "[ERROR] Lost or duplicated items.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
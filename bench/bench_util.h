@@ -0,0 +1,31 @@
+/**
+ * @file bench_util.h
+ * @brief Timing and random numbers shared by the benchmarks.
+ */
+
+#ifndef __BENCH_UTIL_H__
+#define __BENCH_UTIL_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Monotonic time in seconds.
+ */
+static inline double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Next number of a xorshift64 generator, `*state` should not be 0.
+ */
+static inline uint64_t next_rand(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+#endif
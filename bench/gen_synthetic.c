@@ -0,0 +1,530 @@
+/**
+ * @file gen_synthetic.c
+ * @brief Deterministic synthetic reference and VCF for the end-to-end benchmark.
+ *
+ * Writes `prefix.fa`, `prefix.fa.fai` and `prefix.vcf`. Chromosome lengths
+ * decrease linearly from the given length to its half. The sequence is made
+ * of unique random segments, diverged copies of a small library of repeat
+ * families and tandem repeats, in the requested proportion, with runs of N on
+ * top. Records are sorted, do not overlap, never touch an N and carry the
+ * reference bases in REF. SV insertions partly copy a repeat family as is,
+ * so the same allele recurs as mobile element insertions do. The same options
+ * and seed always give the same files.
+ *
+ * Usage: gen_synthetic -o prefix [options] (see -h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <getopt.h>
+
+#define FASTA_LINE_WIDTH 60
+#define REPEAT_FAMILIES 16
+#define MAX_ALLELES 3
+#define SMALL_INDEL_MAX 50
+
+enum var_type { VAR_SNP, VAR_INS, VAR_DEL, VAR_SV, VAR_TYPE_COUNT };
+
+static const char *var_type_names[VAR_TYPE_COUNT] = {"SNP", "INS", "DEL", "SV"};
+static const char bases[4] = {'A', 'C', 'G', 'T'};
+
+struct gen_opt {
+    const char *prefix;
+    int chroms;
+    uint64_t length;
+    int n_runs;
+    uint64_t n_length;
+    double repeat_frac;
+    double density;       /** Records per kb. */
+    int mix[VAR_TYPE_COUNT];
+    double multi_frac;
+    uint64_t sv_min;
+    uint64_t sv_max;
+    double mei_frac;
+    int soft_mask;
+    uint64_t seed;
+};
+
+struct gen_counts {
+    uint64_t bases;
+    uint64_t masked;
+    uint64_t repeat;
+    uint64_t records[VAR_TYPE_COUNT];
+    uint64_t multi;
+};
+
+struct repeat_family {
+    char *seq;
+    uint64_t len;
+};
+
+// ---------------------------------------------------------------------------
+// random numbers
+// ---------------------------------------------------------------------------
+
+static uint64_t rng_state;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rng_next(void) {
+    return splitmix64(&rng_state);
+}
+
+/**
+ * Uniform in [lo, hi].
+ */
+static uint64_t rng_range(uint64_t lo, uint64_t hi) {
+    return lo + rng_next() % (hi - lo + 1);
+}
+
+/**
+ * Uniform in [0, 1).
+ */
+static double rng_unit(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Geometric-like length in [1, max] with the given mean, short ones dominate.
+ */
+static uint64_t rng_length(double mean, uint64_t max) {
+    uint64_t len = 1 + (uint64_t)(-log(1.0 - rng_unit()) * (mean - 1));
+    return len < max ? len : max;
+}
+
+/**
+ * Log-uniform length in [lo, hi], as SV lengths spread over orders of magnitude.
+ */
+static uint64_t rng_log_length(uint64_t lo, uint64_t hi) {
+    return (uint64_t)exp(log((double)lo) + rng_unit() * (log((double)hi) - log((double)lo)));
+}
+
+static char rng_base(void) {
+    return bases[rng_next() & 3];
+}
+
+static char other_base(char base) {
+    char b;
+    do {
+        b = rng_base();
+    } while (b == toupper(base));
+    return b;
+}
+
+// ---------------------------------------------------------------------------
+// reference
+// ---------------------------------------------------------------------------
+
+static void init_families(struct repeat_family *families) {
+    for (int i=0; i<REPEAT_FAMILIES; i++) {
+        // a few long LINE-like families, the rest SINE-like
+        families[i].len = i < 4 ? rng_range(2000, 6000) : rng_range(150, 400);
+        families[i].seq = (char *)malloc(families[i].len);
+        for (uint64_t j=0; j<families[i].len; j++) {
+            families[i].seq[j] = rng_base();
+        }
+    }
+}
+
+static uint64_t chrom_length(const struct gen_opt *opt, int index) {
+    if (opt->chroms == 1) {
+        return opt->length;
+    }
+    return opt->length - (opt->length / 2) * index / (opt->chroms - 1);
+}
+
+/**
+ * Fills `seq` with unique segments, repeat copies and tandem repeats until
+ * the repeats cover `repeat_frac` of it, then adds the N runs.
+ */
+static void fill_chrom(const struct gen_opt *opt, const struct repeat_family *families, char *seq, uint64_t len, struct gen_counts *counts) {
+
+    uint64_t pos = 0, repeat_bases = 0;
+
+    while (pos < len) {
+        if (repeat_bases < opt->repeat_frac * pos) {
+            uint64_t start = pos;
+            if (rng_unit() < 0.8) { // interspersed copy, diverged and possibly truncated
+                const struct repeat_family *family = &(families[rng_next() % REPEAT_FAMILIES]);
+                double divergence = 0.02 + 0.18 * rng_unit();
+                uint64_t offset = rng_unit() < 0.5 ? rng_next() % family->len : 0;
+                for (uint64_t j=offset; j<family->len && pos<len; j++) {
+                    seq[pos++] = rng_unit() < divergence ? rng_base() : family->seq[j];
+                }
+            } else { // tandem repeat
+                uint64_t unit = rng_range(1, 50);
+                uint64_t total = rng_range(50, 2000);
+                for (uint64_t j=0; j<unit && pos<len; j++) {
+                    seq[pos++] = rng_base();
+                }
+                for (uint64_t j=unit; j<total && pos<len; j++, pos++) {
+                    seq[pos] = rng_unit() < 0.01 ? rng_base() : seq[pos-unit];
+                }
+            }
+            if (opt->soft_mask) {
+                for (uint64_t j=start; j<pos; j++) {
+                    seq[j] = tolower(seq[j]);
+                }
+            }
+            repeat_bases += pos - start;
+        } else {
+            uint64_t end = pos + rng_range(200, 4000);
+            for (; pos<len && pos<end; pos++) {
+                seq[pos] = rng_base();
+            }
+        }
+    }
+
+    uint64_t n_length = opt->n_length < len / 10 ? opt->n_length : len / 10;
+    for (int i=0; i<opt->n_runs && n_length; i++) {
+        uint64_t run = rng_range(n_length / 2 + 1, n_length + n_length / 2);
+        uint64_t start = rng_next() % len;
+        for (uint64_t j=start; j<start+run && j<len; j++) {
+            seq[j] = 'N';
+        }
+    }
+
+    for (uint64_t j=0; j<len; j++) {
+        if (seq[j] == 'N') {
+            counts->masked++;
+        }
+    }
+    counts->bases += len;
+    counts->repeat += repeat_bases;
+}
+
+static void write_chrom(FILE *fa, FILE *fai, const char *name, const char *seq, uint64_t len, uint64_t *offset) {
+    int header = fprintf(fa, ">%s\n", name);
+    *offset += header;
+    fprintf(fai, "%s\t%lu\t%lu\t%d\t%d\n", name, len, *offset, FASTA_LINE_WIDTH, FASTA_LINE_WIDTH + 1);
+
+    for (uint64_t i=0; i<len; i+=FASTA_LINE_WIDTH) {
+        uint64_t line = len - i < FASTA_LINE_WIDTH ? len - i : FASTA_LINE_WIDTH;
+        fwrite(seq + i, 1, line, fa);
+        fputc('\n', fa);
+        *offset += line + 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// variants
+// ---------------------------------------------------------------------------
+
+static int has_n(const char *seq, uint64_t start, uint64_t end) {
+    return memchr(seq + start, 'N', end - start) != NULL;
+}
+
+static void append_ref(char *dst, const char *seq, uint64_t start, uint64_t end) {
+    size_t len = strlen(dst);
+    for (uint64_t i=start; i<end; i++) {
+        dst[len++] = toupper(seq[i]);
+    }
+    dst[len] = '\0';
+}
+
+static void append_random(char *dst, uint64_t count) {
+    size_t len = strlen(dst);
+    for (uint64_t i=0; i<count; i++) {
+        dst[len++] = rng_base();
+    }
+    dst[len] = '\0';
+}
+
+static enum var_type pick_type(const struct gen_opt *opt) {
+    int total = 0;
+    for (int i=0; i<VAR_TYPE_COUNT; i++) {
+        total += opt->mix[i];
+    }
+    int r = (int)(rng_next() % total);
+    for (int i=0; i<VAR_TYPE_COUNT; i++) {
+        if (r < opt->mix[i]) {
+            return (enum var_type)i;
+        }
+        r -= opt->mix[i];
+    }
+    return VAR_SNP;
+}
+
+/**
+ * Builds one record at `pos`, returns the end of the REF span or 0 if the
+ * record would reach an N or the end of the chromosome.
+ */
+static uint64_t make_record(const struct gen_opt *opt, const struct repeat_family *families, const char *seq, uint64_t len, uint64_t pos, enum var_type type,
+                            char *ref, char *alts[MAX_ALLELES], int *alt_count) {
+
+    uint64_t ref_len = 1;
+    int alleles = rng_unit() < opt->multi_frac ? (int)rng_range(2, MAX_ALLELES) : 1;
+    int sv_kind = 0;
+
+    if (type == VAR_DEL) {
+        ref_len = 1 + rng_length(4, SMALL_INDEL_MAX);
+    } else if (type == VAR_SV) {
+        sv_kind = (int)(rng_next() % 3); // 0: insertion, 1: deletion, 2: replacement
+        if (sv_kind != 0) {
+            ref_len = 1 + rng_log_length(opt->sv_min, opt->sv_max);
+        }
+    }
+
+    if (pos + ref_len > len || has_n(seq, pos, pos + ref_len)) {
+        return 0;
+    }
+
+    ref[0] = '\0';
+    append_ref(ref, seq, pos, pos + ref_len);
+
+    *alt_count = 0;
+    for (int a=0; a<alleles; a++) {
+        char *alt = alts[*alt_count];
+        alt[0] = ref[0];
+        alt[1] = '\0';
+
+        if (type == VAR_SNP) {
+            alt[0] = other_base(ref[0]);
+        } else if (type == VAR_INS) {
+            append_random(alt, rng_length(4, SMALL_INDEL_MAX));
+        } else if (type == VAR_DEL) {
+            // the first allele deletes the whole span, the others part of it
+            if (a) {
+                append_ref(alt, seq, pos + 1, pos + 1 + rng_range(1, ref_len - 1));
+            }
+        } else if (sv_kind == 0 && rng_unit() < opt->mei_frac) {
+            const struct repeat_family *family = &(families[rng_next() % REPEAT_FAMILIES]);
+            strncat(alt, family->seq, family->len);
+        } else if (sv_kind == 1) {
+            if (a) {
+                append_ref(alt, seq, pos + 1, pos + 1 + rng_range(1, ref_len - 1));
+            }
+        } else {
+            append_random(alt, rng_log_length(opt->sv_min, opt->sv_max));
+        }
+
+        int duplicate = strcmp(alt, ref) == 0;
+        for (int b=0; b<*alt_count && !duplicate; b++) {
+            duplicate = strcmp(alt, alts[b]) == 0;
+        }
+        if (!duplicate) {
+            (*alt_count)++;
+        }
+    }
+
+    return *alt_count ? pos + ref_len : 0;
+}
+
+static void write_variants(const struct gen_opt *opt, const struct repeat_family *families, FILE *vcf, const char *name, const char *seq, uint64_t len,
+                           char *ref, char *alts[MAX_ALLELES], struct gen_counts *counts) {
+
+    double mean_gap = 1000.0 / opt->density;
+    uint64_t pos = 0;
+
+    while (1) {
+        pos += 1 + (uint64_t)(-log(1.0 - rng_unit()) * mean_gap);
+        if (pos >= len) {
+            break;
+        }
+
+        enum var_type type = pick_type(opt);
+        int alt_count;
+        uint64_t end = make_record(opt, families, seq, len, pos, type, ref, alts, &alt_count);
+        if (end == 0) {
+            continue;
+        }
+
+        uint64_t id = 0;
+        for (int i=0; i<VAR_TYPE_COUNT; i++) {
+            id += counts->records[i];
+        }
+        fprintf(vcf, "%s\t%lu\tvar%lu\t%s\t", name, pos + 1, id + 1, ref);
+        for (int a=0; a<alt_count; a++) {
+            fprintf(vcf, a ? ",%s" : "%s", alts[a]);
+        }
+        fprintf(vcf, "\t60\tPASS\tTYPE=%s\n", var_type_names[type]);
+
+        counts->records[type]++;
+        counts->multi += alt_count > 1;
+        pos = end; // the next record starts after the REF span
+    }
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s -o prefix [options]\n", name);
+    fprintf(stderr, "\t--prefix | -o         Prefix of the output files (.fa, .fa.fai, .vcf).\n");
+    fprintf(stderr, "\t--chroms | -c         Number of chromosomes. [Default: 4]\n");
+    fprintf(stderr, "\t--length | -l         Length of the first chromosome, the last one is half. [Default: 2000000]\n");
+    fprintf(stderr, "\t--n-runs | -n         Runs of N per chromosome. [Default: 2]\n");
+    fprintf(stderr, "\t--n-length            Mean length of a run of N. [Default: 10000]\n");
+    fprintf(stderr, "\t--repeat | -r         Fraction of the sequence in repeats. [Default: 0.45]\n");
+    fprintf(stderr, "\t--soft-mask           Write the repeats in lowercase. [Default: No]\n");
+    fprintf(stderr, "\t--density | -d        Records per kb. [Default: 1.0]\n");
+    fprintf(stderr, "\t--mix | -x            Weights of SNP,INS,DEL,SV records. [Default: 70,12,12,6]\n");
+    fprintf(stderr, "\t--multi | -m          Fraction of multi-allelic records. [Default: 0.05]\n");
+    fprintf(stderr, "\t--sv-min              Minimum SV length. [Default: 50]\n");
+    fprintf(stderr, "\t--sv-max              Maximum SV length. [Default: 10000]\n");
+    fprintf(stderr, "\t--mei                 Fraction of SV insertions copying a repeat family. [Default: 0.3]\n");
+    fprintf(stderr, "\t--seed | -s           Seed. [Default: 42]\n");
+}
+
+int main(int argc, char *argv[]) {
+
+    struct gen_opt opt = {
+        .prefix = NULL,
+        .chroms = 4,
+        .length = 2000000,
+        .n_runs = 2,
+        .n_length = 10000,
+        .repeat_frac = 0.45,
+        .density = 1.0,
+        .mix = {70, 12, 12, 6},
+        .multi_frac = 0.05,
+        .sv_min = 50,
+        .sv_max = 10000,
+        .mei_frac = 0.3,
+        .soft_mask = 0,
+        .seed = 42
+    };
+
+    struct option long_options[] = {
+        {"prefix", required_argument, NULL, 'o'},
+        {"chroms", required_argument, NULL, 'c'},
+        {"length", required_argument, NULL, 'l'},
+        {"n-runs", required_argument, NULL, 'n'},
+        {"n-length", required_argument, NULL, 1},
+        {"repeat", required_argument, NULL, 'r'},
+        {"soft-mask", no_argument, NULL, 2},
+        {"density", required_argument, NULL, 'd'},
+        {"mix", required_argument, NULL, 'x'},
+        {"multi", required_argument, NULL, 'm'},
+        {"sv-min", required_argument, NULL, 3},
+        {"sv-max", required_argument, NULL, 4},
+        {"mei", required_argument, NULL, 5},
+        {"seed", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "o:c:l:n:r:d:x:m:s:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'o': opt.prefix = optarg; break;
+        case 'c': opt.chroms = atoi(optarg); break;
+        case 'l': opt.length = strtoull(optarg, NULL, 10); break;
+        case 'n': opt.n_runs = atoi(optarg); break;
+        case 1:   opt.n_length = strtoull(optarg, NULL, 10); break;
+        case 'r': opt.repeat_frac = atof(optarg); break;
+        case 2:   opt.soft_mask = 1; break;
+        case 'd': opt.density = atof(optarg); break;
+        case 'x':
+            if (sscanf(optarg, "%d,%d,%d,%d", &opt.mix[VAR_SNP], &opt.mix[VAR_INS], &opt.mix[VAR_DEL], &opt.mix[VAR_SV]) != 4) {
+                fprintf(stderr, "[ERROR] --mix expects four comma separated weights, got %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'm': opt.multi_frac = atof(optarg); break;
+        case 3:   opt.sv_min = strtoull(optarg, NULL, 10); break;
+        case 4:   opt.sv_max = strtoull(optarg, NULL, 10); break;
+        case 5:   opt.mei_frac = atof(optarg); break;
+        case 's': opt.seed = strtoull(optarg, NULL, 10); break;
+        default:
+            print_usage(argv[0]);
+            return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    int mix_total = opt.mix[VAR_SNP] + opt.mix[VAR_INS] + opt.mix[VAR_DEL] + opt.mix[VAR_SV];
+    if (opt.prefix == NULL || opt.chroms < 1 || opt.length < 1000 || opt.density <= 0 || mix_total <= 0 ||
+        opt.mix[VAR_SNP] < 0 || opt.mix[VAR_INS] < 0 || opt.mix[VAR_DEL] < 0 || opt.mix[VAR_SV] < 0 ||
+        opt.sv_min < 2 || opt.sv_max < opt.sv_min) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t path_len = strlen(opt.prefix) + 8;
+    char *fa_path = (char *)malloc(path_len), *fai_path = (char *)malloc(path_len), *vcf_path = (char *)malloc(path_len);
+    snprintf(fa_path, path_len, "%s.fa", opt.prefix);
+    snprintf(fai_path, path_len, "%s.fa.fai", opt.prefix);
+    snprintf(vcf_path, path_len, "%s.vcf", opt.prefix);
+
+    FILE *fa = fopen(fa_path, "w"), *fai = fopen(fai_path, "w"), *vcf = fopen(vcf_path, "w");
+    if (fa == NULL || fai == NULL || vcf == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't open the output files with prefix %s\n", opt.prefix);
+        return EXIT_FAILURE;
+    }
+
+    rng_state = opt.seed;
+    struct repeat_family families[REPEAT_FAMILIES];
+    init_families(families);
+
+    fprintf(vcf, "##fileformat=VCFv4.2\n");
+    fprintf(vcf, "##source=gen_synthetic seed=%lu\n", opt.seed);
+    fprintf(vcf, "##INFO=<ID=TYPE,Number=1,Type=String,Description=\"Type of the record: SNP, INS, DEL or SV\">\n");
+    for (int i=0; i<opt.chroms; i++) {
+        fprintf(vcf, "##contig=<ID=chr%d,length=%lu>\n", i + 1, chrom_length(&opt, i));
+    }
+    fprintf(vcf, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n");
+
+    // one allele can be as long as the longest SV or repeat family plus the anchor
+    size_t allele_capacity = (opt.sv_max > 6000 ? opt.sv_max : 6000) + 2;
+    char *ref = (char *)malloc(allele_capacity);
+    char *alts[MAX_ALLELES];
+    for (int a=0; a<MAX_ALLELES; a++) {
+        alts[a] = (char *)malloc(allele_capacity);
+    }
+
+    struct gen_counts counts;
+    memset(&counts, 0, sizeof(counts));
+    uint64_t offset = 0;
+    char name[32];
+
+    for (int i=0; i<opt.chroms; i++) {
+        uint64_t len = chrom_length(&opt, i);
+        char *seq = (char *)malloc(len);
+        if (seq == NULL) {
+            fprintf(stderr, "[ERROR] Couldn't allocate %lu bases\n", len);
+            return EXIT_FAILURE;
+        }
+        snprintf(name, sizeof(name), "chr%d", i + 1);
+
+        fill_chrom(&opt, families, seq, len, &counts);
+        write_chrom(fa, fai, name, seq, len, &offset);
+        write_variants(&opt, families, vcf, name, seq, len, ref, alts, &counts);
+
+        free(seq);
+    }
+
+    fclose(fa);
+    fclose(fai);
+    fclose(vcf);
+
+    uint64_t records = 0;
+    for (int i=0; i<VAR_TYPE_COUNT; i++) {
+        records += counts.records[i];
+    }
+    printf("chroms\tbases\tmasked\trepeat\trecords\tsnp\tins\tdel\tsv\tmulti\n");
+    printf("%d\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n", opt.chroms, counts.bases, counts.masked, counts.repeat, records,
+           counts.records[VAR_SNP], counts.records[VAR_INS], counts.records[VAR_DEL], counts.records[VAR_SV], counts.multi);
+
+    for (int i=0; i<REPEAT_FAMILIES; i++) {
+        free(families[i].seq);
+    }
+    for (int a=0; a<MAX_ALLELES; a++) {
+        free(alts[a]);
+    }
+    free(ref);
+    free(fa_path);
+    free(fai_path);
+    free(vcf_path);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#!/bin/bash
+# End-to-end benchmark on synthetic data.
+#
+# Generates a reference and a VCF with bin/bench/gen_synthetic (once per
+# data set), runs `-vg` and `-vgx` over every thread count and LCP level and
+# prints one CSV row per run, also kept in $OUT_DIR/results.csv. Wall time and
+# peak memory come from the `--stats-json` report of each run.
+#
+# Usage: bench/run_e2e.sh [out_dir] [gen_synthetic options...]
+#   e.g. bench/run_e2e.sh /tmp/lcpan-bench -c 8 -l 10000000 --mix 60,15,15,10
+#
+# Environment:
+#   MODES="vg vgx"  THREADS="1 2 4 8"  LEVELS="4"  REPEAT=1
+#   LCPAN=bin/lcpan  GEN=bin/bench/gen_synthetic
+#   BGZIP=false  (true: bgzip and tabix the VCF, needs both tools)
+#   KEEP=false   (true: keep the graphs of every run)
+
+set -e
+
+MODES=${MODES:-"vg vgx"}
+THREADS=${THREADS:-"1 2 4 8"}
+LEVELS=${LEVELS:-"4"}
+REPEAT=${REPEAT:-1}
+LCPAN=${LCPAN:-bin/lcpan}
+GEN=${GEN:-bin/bench/gen_synthetic}
+BGZIP=${BGZIP:-false}
+KEEP=${KEEP:-false}
+
+OUT_DIR=${1:-bin/bench/e2e}
+shift || true
+
+for bin in "$LCPAN" "$GEN"; do
+    if [ ! -x "$bin" ]; then
+        echo "[ERROR] $bin not found, run \`make\` and \`make bench\` first" >&2
+        exit 1
+    fi
+done
+
+mkdir -p "$OUT_DIR"
+
+# the data set is named after the generator options, so it is reused
+DATA_ID=$(echo "syn $*" | cksum | cut -d' ' -f1)
+DATA="$OUT_DIR/syn-$DATA_ID"
+if [ ! -f "$DATA.vcf" ]; then
+    echo "[INFO] Generating $DATA ($*)" >&2
+    "$GEN" -o "$DATA" "$@" > "$DATA.summary"
+fi
+
+VCF="$DATA.vcf"
+if [ "$BGZIP" = "true" ]; then
+    if [ ! -f "$DATA.vcf.gz.tbi" ]; then
+        bgzip -c "$DATA.vcf" > "$DATA.vcf.gz"
+        tabix -p vcf "$DATA.vcf.gz"
+    fi
+    VCF="$DATA.vcf.gz"
+fi
+
+BASES=$(awk '{sum += $2} END {print sum}' "$DATA.fa.fai")
+VARIANTS=$(grep -vc '^#' "$DATA.vcf")
+
+# json_value FILE KEY: value of a top level number in the stats report
+json_value() {
+    sed -n "s/^  \"$2\": \([0-9]*\),\{0,1\}$/\1/p" "$1"
+}
+
+RESULTS="$OUT_DIR/results.csv"
+echo "mode,level,threads,run,bases,variants,wall_sec,variants_per_sec,bases_per_sec,peak_rss_kb" | tee "$RESULTS"
+
+for mode in $MODES; do
+    for level in $LEVELS; do
+        for thread in $THREADS; do
+            for run in $(seq 1 "$REPEAT"); do
+                RUN_DIR="$OUT_DIR/run-$mode-l$level-t$thread"
+                rm -rf "$RUN_DIR"
+                mkdir -p "$RUN_DIR"
+
+                if ! "$LCPAN" -$mode -r "$DATA.fa" -v "$VCF" -p "$RUN_DIR/out" -l "$level" -t "$thread" \
+                        --stats-json "$RUN_DIR/stats.json" > "$RUN_DIR/stdout" 2> "$RUN_DIR/stderr"; then
+                    echo "[ERROR] -$mode level $level thread $thread failed, see $RUN_DIR/stderr" >&2
+                    exit 1
+                fi
+
+                WALL_NS=$(json_value "$RUN_DIR/stats.json" wall_ns)
+                PEAK_RSS=$(json_value "$RUN_DIR/stats.json" peak_rss_kb)
+                awk -v mode="$mode" -v level="$level" -v thread="$thread" -v run="$run" -v bases="$BASES" -v variants="$VARIANTS" \
+                    -v wall_ns="$WALL_NS" -v rss="$PEAK_RSS" 'BEGIN {
+                        sec = wall_ns / 1e9
+                        printf "%s,%d,%d,%d,%d,%d,%.3f,%.0f,%.0f,%d\n", mode, level, thread, run, bases, variants, sec, variants / sec, bases / sec, rss
+                    }' | tee -a "$RESULTS"
+
+                if [ "$KEEP" != "true" ]; then
+                    rm -f "$RUN_DIR"/out.*
+                fi
+            done
+        done
+    done
+done
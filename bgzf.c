@@ -0,0 +1,429 @@
+#include "bgzf.h"
+
+#define BGZF_PLAIN_BUFFER_SIZE 1048576
+
+static inline uint32_t read_le16(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * BGZF block header is a gzip header with FEXTRA flag and a single 'BC'
+ * subfield that stores the size of the block minus one.
+ */
+static inline int is_bgzf_header(const uint8_t *header) {
+    return header[0] == 31 && header[1] == 139 && header[2] == 8 && (header[3] & 4) &&
+           read_le16(header + 10) == 6 && header[12] == 'B' && header[13] == 'C' && read_le16(header + 14) == 2;
+}
+
+int bgzf_is_compressed(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    uint8_t magic[2] = {0, 0};
+    size_t n = fread(magic, 1, 2, file);
+    fclose(file);
+    return n == 2 && magic[0] == 31 && magic[1] == 139;
+}
+
+// ------------------------------------------------------------------------------------
+//      BATCHES
+// ------------------------------------------------------------------------------------
+
+/**
+ * Allocates a batch of `blocks` blocks.
+ *
+ * @return 1 on success, 0 if memory allocation fails (the batch can still be freed).
+ */
+static int batch_init(struct bgzf_batch *batch, int blocks) {
+    batch->count = 0;
+    batch->raw = (uint8_t *)malloc((uint64_t)blocks * BGZF_MAX_BLOCK_SIZE);
+    batch->raw_size = 0;
+    batch->raw_offsets = (uint64_t *)malloc(blocks * sizeof(uint64_t));
+    batch->addresses = (uint64_t *)malloc(blocks * sizeof(uint64_t));
+    batch->data = (char *)malloc((uint64_t)blocks * BGZF_MAX_BLOCK_SIZE);
+    batch->sizes = (uint32_t *)malloc(blocks * sizeof(uint32_t));
+    batch->error = 0;
+    tpool_group_init(&batch->group);
+    batch->tasks = (struct bgzf_task *)malloc(blocks * sizeof(struct bgzf_task));
+    return batch->raw != NULL && batch->raw_offsets != NULL && batch->addresses != NULL &&
+           batch->data != NULL && batch->sizes != NULL && batch->tasks != NULL;
+}
+
+static void batch_free(struct bgzf_batch *batch) {
+    free(batch->raw);
+    free(batch->raw_offsets);
+    free(batch->addresses);
+    free(batch->data);
+    free(batch->sizes);
+    free(batch->tasks);
+}
+
+/**
+ * Reads a single compressed block into the batch.
+ *
+ * @return Size of the block, 0 at the end of file, -1 on error.
+ */
+static int64_t read_raw_block(FILE *file, struct bgzf_batch *batch, uint64_t address) {
+    uint8_t *block = batch->raw + batch->raw_size;
+
+    size_t n = fread(block, 1, BGZF_BLOCK_HEADER_SIZE, file);
+    if (n == 0) {
+        return 0;
+    }
+    if (n != BGZF_BLOCK_HEADER_SIZE || !is_bgzf_header(block)) {
+        return -1;
+    }
+
+    uint64_t block_size = read_le16(block + 16) + 1;
+    if (block_size < BGZF_BLOCK_HEADER_SIZE + BGZF_BLOCK_FOOTER_SIZE) {
+        return -1;
+    }
+    if (fread(block + BGZF_BLOCK_HEADER_SIZE, 1, block_size - BGZF_BLOCK_HEADER_SIZE, file) != block_size - BGZF_BLOCK_HEADER_SIZE) {
+        return -1;
+    }
+
+    batch->raw_offsets[batch->count] = batch->raw_size;
+    batch->addresses[batch->count] = address;
+    batch->raw_size += block_size;
+    batch->count++;
+    stats_add_read(block_size);
+
+    return (int64_t)block_size;
+}
+
+static int inflate_block(z_stream *zs, struct bgzf_batch *batch, int index) {
+    uint8_t *block = batch->raw + batch->raw_offsets[index];
+    uint64_t block_size = read_le16(block + 16) + 1;
+    uint32_t inflated_size = read_le32(block + block_size - 4);
+
+    if (inflated_size > BGZF_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+
+    inflateReset(zs);
+    zs->next_in = block + BGZF_BLOCK_HEADER_SIZE;
+    zs->avail_in = block_size - BGZF_BLOCK_HEADER_SIZE - BGZF_BLOCK_FOOTER_SIZE;
+    zs->next_out = (Bytef *)(batch->data + (uint64_t)index * BGZF_MAX_BLOCK_SIZE);
+    zs->avail_out = BGZF_MAX_BLOCK_SIZE;
+
+    int ret = inflate(zs, Z_FINISH);
+    if (ret != Z_STREAM_END || zs->total_out != inflated_size) {
+        return 0;
+    }
+
+    batch->sizes[index] = inflated_size;
+    return 1;
+}
+
+static void inflate_blocks(struct bgzf_batch *batch, int first, int last) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        batch->error = 1;
+        return;
+    }
+    for (int i=first; i<last; i++) {
+        if (!inflate_block(&zs, batch, i)) {
+            batch->error = 1;
+            batch->sizes[i] = 0;
+        }
+    }
+    inflateEnd(&zs);
+}
+
+static void inflate_task(void *arg) {
+    struct bgzf_task *task = (struct bgzf_task *)arg;
+    inflate_blocks(task->batch, task->first, task->last);
+}
+
+/**
+ * Reads the next compressed blocks into the batch and starts inflating them.
+ * Inflating is done in the background if there is a thread pool.
+ */
+static void batch_load(bgzf_file_t *fp, struct bgzf_batch *batch) {
+    batch->count = 0;
+    batch->raw_size = 0;
+    batch->error = 0;
+
+    while (!fp->eof && batch->count < fp->batch_blocks) {
+        int64_t size = read_raw_block(fp->file, batch, (uint64_t)ftello(fp->file));
+        if (size <= 0) {
+            batch->error = size < 0;
+            fp->eof = 1;
+        }
+    }
+
+    if (batch->count == 0) {
+        return;
+    }
+
+    if (fp->tm == NULL) {
+        inflate_blocks(batch, 0, batch->count);
+        return;
+    }
+
+    int task_count = fp->thread_number * 2 < batch->count ? fp->thread_number * 2 : batch->count;
+    for (int i=0; i<task_count; i++) {
+        batch->tasks[i].batch = batch;
+        batch->tasks[i].first = (int)((int64_t)batch->count * i / task_count);
+        batch->tasks[i].last = (int)((int64_t)batch->count * (i + 1) / task_count);
+        tpool_spawn(fp->tm, &batch->group, inflate_task, &(batch->tasks[i]));
+    }
+}
+
+/**
+ * Moves to the next inflated block. When current batch is consumed, switches
+ * to the prefetched batch and reloads the consumed one.
+ *
+ * @return 1 if a block is available, 0 at the end of file.
+ */
+static int next_block(bgzf_file_t *fp) {
+    while (1) {
+        struct bgzf_batch *batch = &(fp->batches[fp->current]);
+
+        if (fp->block + 1 < batch->count) {
+            fp->block++;
+            fp->buffer = batch->data + (uint64_t)fp->block * BGZF_MAX_BLOCK_SIZE;
+            fp->buffer_size = batch->sizes[fp->block];
+            fp->buffer_pos = 0;
+            if (fp->buffer_size == 0) {
+                continue; // empty block (e.g., EOF marker)
+            }
+            return 1;
+        }
+
+        struct bgzf_batch *next = &(fp->batches[1 - fp->current]);
+        tpool_group_wait(fp->tm, &next->group);
+        if (next->error) {
+            fprintf(stderr, "[ERROR] Corrupted or truncated BGZF file.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (next->count == 0) {
+            return 0;
+        }
+
+        batch_load(fp, batch); // prefetch while `next` is consumed
+        fp->current = 1 - fp->current;
+        fp->block = -1;
+    }
+}
+
+// ------------------------------------------------------------------------------------
+//      READER
+// ------------------------------------------------------------------------------------
+
+bgzf_file_t *bgzf_open(const char *path, int thread_number) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    uint8_t header[BGZF_BLOCK_HEADER_SIZE];
+    size_t n = fread(header, 1, BGZF_BLOCK_HEADER_SIZE, file);
+    rewind(file);
+
+    bgzf_file_t *fp = (bgzf_file_t *)calloc(1, sizeof(bgzf_file_t));
+    if (fp == NULL) {
+        fclose(file);
+        return NULL;
+    }
+    fp->thread_number = thread_number < 1 ? 1 : thread_number;
+
+    if (n == BGZF_BLOCK_HEADER_SIZE && is_bgzf_header(header)) {
+        fp->format = BGZF_BGZF;
+        fp->file = file;
+        fp->tm = fp->thread_number > 1 ? tpool_create(fp->thread_number) : NULL;
+        fp->batch_blocks = fp->thread_number > 1 ? BGZF_BATCH_BLOCKS : 1; // read-ahead only pays off with inflating threads
+        int batch_0 = batch_init(&(fp->batches[0]), fp->batch_blocks);
+        int batch_1 = batch_init(&(fp->batches[1]), fp->batch_blocks);
+        if (!batch_0 || !batch_1) {
+            bgzf_close(fp);
+            return NULL;
+        }
+        batch_load(fp, &(fp->batches[0]));
+        fp->current = 1; // batches[1] is empty, hence, first block is taken from batches[0]
+        fp->block = -1;
+    } else if (2 <= n && header[0] == 31 && header[1] == 139) {
+        fclose(file);
+        fp->format = BGZF_GZIP;
+        fp->gz = gzopen(path, "rb");
+        if (fp->gz == NULL) {
+            free(fp);
+            return NULL;
+        }
+        gzbuffer(fp->gz, BGZF_PLAIN_BUFFER_SIZE);
+        fp->plain_buffer = (char *)malloc(BGZF_PLAIN_BUFFER_SIZE);
+    } else {
+        fp->format = BGZF_PLAIN;
+        fp->file = file;
+        fp->plain_buffer = (char *)malloc(BGZF_PLAIN_BUFFER_SIZE);
+    }
+    if (fp->format != BGZF_BGZF && fp->plain_buffer == NULL) {
+        bgzf_close(fp);
+        return NULL;
+    }
+
+    return fp;
+}
+
+void bgzf_close(bgzf_file_t *fp) {
+    if (fp == NULL) {
+        return;
+    }
+    if (fp->format == BGZF_BGZF) {
+        tpool_group_wait(fp->tm, &(fp->batches[0].group));
+        tpool_group_wait(fp->tm, &(fp->batches[1].group));
+        tpool_destroy(fp->tm);
+        batch_free(&(fp->batches[0]));
+        batch_free(&(fp->batches[1]));
+    }
+    if (fp->file != NULL) {
+        fclose(fp->file);
+    }
+    if (fp->gz != NULL) {
+        stats_add_read((uint64_t)gzoffset(fp->gz)); // compressed bytes consumed
+        gzclose(fp->gz);
+    }
+    free(fp->plain_buffer);
+    free(fp);
+}
+
+/**
+ * Refills the buffer with the next uncompressed data.
+ *
+ * @return 1 if there is data, 0 at the end of file, -1 on error.
+ */
+static int fill_buffer(bgzf_file_t *fp) {
+    if (fp->format == BGZF_BGZF) {
+        return next_block(fp);
+    }
+
+    int64_t n;
+    if (fp->format == BGZF_GZIP) {
+        n = gzread(fp->gz, fp->plain_buffer, BGZF_PLAIN_BUFFER_SIZE);
+    } else {
+        n = (int64_t)fread(fp->plain_buffer, 1, BGZF_PLAIN_BUFFER_SIZE, fp->file);
+        stats_add_read((uint64_t)n);
+    }
+    if (n < 0) {
+        return -1;
+    }
+
+    fp->buffer = fp->plain_buffer;
+    fp->buffer_size = (uint64_t)n;
+    fp->buffer_pos = 0;
+    return n > 0;
+}
+
+int bgzf_seek(bgzf_file_t *fp, uint64_t voffset) {
+    if (fp->format != BGZF_BGZF) {
+        return -1;
+    }
+
+    tpool_group_wait(fp->tm, &(fp->batches[0].group));
+    tpool_group_wait(fp->tm, &(fp->batches[1].group));
+
+    if (fseeko(fp->file, (off_t)(voffset >> 16), SEEK_SET) != 0) {
+        return -1;
+    }
+    fp->eof = 0;
+    fp->batches[0].count = 0;
+    fp->batches[1].count = 0;
+    batch_load(fp, &(fp->batches[0]));
+    fp->current = 1;
+    fp->block = -1;
+    fp->buffer_size = 0;
+    fp->buffer_pos = 0;
+
+    uint64_t offset = voffset & 0xFFFF;
+    if (offset == 0) {
+        return 0;
+    }
+    if (next_block(fp) != 1 || fp->buffer_size < offset) {
+        return -1;
+    }
+    fp->buffer_pos = offset;
+    return 0;
+}
+
+int64_t bgzf_read(bgzf_file_t *fp, void *buf, uint64_t len) {
+    char *out = (char *)buf;
+    uint64_t total = 0;
+
+    while (total < len) {
+        if (fp->buffer_pos == fp->buffer_size) {
+            // large reads of uncompressed files skip the intermediate buffer
+            if (fp->format == BGZF_PLAIN && BGZF_PLAIN_BUFFER_SIZE <= len - total) {
+                size_t n = fread(out + total, 1, len - total, fp->file);
+                stats_add_read(n);
+                total += n;
+                if (n == 0) break;
+                continue;
+            }
+            int ret = fill_buffer(fp);
+            if (ret < 0) return -1;
+            if (ret == 0) break;
+        }
+
+        uint64_t size = fp->buffer_size - fp->buffer_pos;
+        if (len - total < size) {
+            size = len - total;
+        }
+        memcpy(out + total, fp->buffer + fp->buffer_pos, size);
+        fp->buffer_pos += size;
+        total += size;
+    }
+
+    return (int64_t)total;
+}
+
+int64_t bgzf_getline(bgzf_file_t *fp, char **line, uint64_t *capacity) {
+    uint64_t len = 0;
+    int found = 0;
+
+    if (*line == NULL || *capacity == 0) {
+        *capacity = 256;
+        *line = (char *)malloc(*capacity);
+    }
+
+    while (!found) {
+        if (fp->buffer_pos == fp->buffer_size) {
+            int ret = fill_buffer(fp);
+            if (ret < 0) return -1;
+            if (ret == 0) break;
+        }
+
+        const char *start = fp->buffer + fp->buffer_pos;
+        uint64_t available = fp->buffer_size - fp->buffer_pos;
+        const char *newline = (const char *)memchr(start, '\n', available);
+        uint64_t size = newline ? (uint64_t)(newline - start) : available;
+
+        if (*capacity <= len + size) {
+            while (*capacity <= len + size) {
+                *capacity *= 2;
+            }
+            char *temp = (char *)realloc(*line, *capacity);
+            if (temp == NULL) {
+                return -1;
+            }
+            *line = temp;
+        }
+
+        memcpy(*line + len, start, size);
+        len += size;
+        fp->buffer_pos += size + (newline != NULL);
+        found = newline != NULL;
+    }
+
+    if (!found && len == 0) {
+        return -1;
+    }
+
+    (*line)[len] = '\0';
+    return (int64_t)len;
+}
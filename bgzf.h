@@ -0,0 +1,120 @@
+/**
+ * @file bgzf.h
+ * @brief Buffered reader for plain, gzip and BGZF compressed files.
+ *
+ * BGZF files (bgzip output) are a series of independent gzip members of at
+ * most 64 KB of data each. The reader loads batches of compressed blocks and
+ * inflates the blocks of a batch in parallel on a thread pool, while the
+ * previous batch is consumed. Plain gzip files are inflated serially with
+ * zlib and uncompressed files are read as they are.
+ */
+
+#ifndef __BGZF_H__
+#define __BGZF_H__
+
+#include "mpmc.h"
+#include "tpool.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define BGZF_MAX_BLOCK_SIZE 65536
+#define BGZF_BLOCK_HEADER_SIZE 18
+#define BGZF_BLOCK_FOOTER_SIZE 8
+#define BGZF_BATCH_BLOCKS 256
+
+typedef enum {
+    BGZF_PLAIN,
+    BGZF_GZIP,
+    BGZF_BGZF
+} bgzf_format_t;
+
+struct bgzf_batch;
+
+struct bgzf_task {
+    struct bgzf_batch *batch; /** Batch of the blocks. */
+    int first;                /** Index of the first block to be inflated. */
+    int last;                 /** Index after the last block to be inflated. */
+};
+
+struct bgzf_batch {
+    int count;                /** Number of blocks in the batch. */
+    uint8_t *raw;             /** Compressed blocks, back to back. */
+    uint64_t raw_size;        /** Used size of raw. */
+    uint64_t *raw_offsets;    /** Offset of each block in raw. */
+    uint64_t *addresses;      /** Offset of each block in file. */
+    char *data;               /** Inflated blocks, BGZF_MAX_BLOCK_SIZE bytes per block. */
+    uint32_t *sizes;          /** Inflated size of each block. */
+    int error;                /** Set if any block fails to inflate. */
+    struct tpool_group group; /** Inflating tasks that are not finished. */
+    struct bgzf_task *tasks;  /** Inflating tasks of the batch. */
+};
+
+typedef struct {
+    bgzf_format_t format;          /** Format of the file. */
+    FILE *file;                    /** File for plain and BGZF formats. */
+    gzFile gz;                     /** zlib handle for plain gzip format. */
+    int thread_number;             /** Number of inflating threads. */
+    int batch_blocks;              /** Number of blocks loaded per batch. */
+    struct tpool *tm;              /** Thread pool inflating blocks, NULL if single threaded. */
+    struct bgzf_batch batches[2];  /** Consumed and prefetched batches. */
+    int current;                   /** Index of the consumed batch. */
+    int block;                     /** Index of the consumed block in current batch. */
+    int eof;                       /** Set when there is no more block to load. */
+    char *buffer;                  /** Data being consumed. */
+    uint64_t buffer_size;          /** Size of the data being consumed. */
+    uint64_t buffer_pos;           /** Position in the data being consumed. */
+    char *plain_buffer;            /** Read buffer for plain and gzip formats. */
+} bgzf_file_t;
+
+/**
+ * @brief Opens a file for reading, detecting whether it is plain, gzip or BGZF.
+ *
+ * @param path          Path to the file.
+ * @param thread_number Number of threads inflating BGZF blocks.
+ * @return The reader, or NULL if the file cannot be opened or memory allocation fails.
+ */
+bgzf_file_t *bgzf_open(const char *path, int thread_number);
+
+/**
+ * @brief Closes the reader and frees its resources.
+ */
+void bgzf_close(bgzf_file_t *fp);
+
+/**
+ * @brief Reads up to `len` bytes of uncompressed data.
+ *
+ * @return Number of bytes read, 0 at the end of file, -1 on error.
+ */
+int64_t bgzf_read(bgzf_file_t *fp, void *buf, uint64_t len);
+
+/**
+ * @brief Reads a line (without the newline) into a buffer grown as needed.
+ *
+ * @param fp       The reader.
+ * @param line     Pointer to a malloc'ed buffer, reallocated if the line does not fit.
+ * @param capacity Pointer to the capacity of the buffer.
+ * @return Length of the line, -1 at the end of file or on error.
+ */
+int64_t bgzf_getline(bgzf_file_t *fp, char **line, uint64_t *capacity);
+
+/**
+ * @brief Moves a BGZF reader to a virtual offset (as stored in tabix/CSI indexes).
+ *
+ * @param fp      The reader.
+ * @param voffset Offset of the block in the file << 16 | offset in the uncompressed block.
+ * @return 0 on success, -1 if the file is not BGZF or the offset is invalid.
+ */
+int bgzf_seek(bgzf_file_t *fp, uint64_t voffset);
+
+/**
+ * @brief Checks whether the file starts with gzip magic bytes.
+ *
+ * @return 1 if the file is gzip (or BGZF) compressed, 0 otherwise.
+ */
+int bgzf_is_compressed(const char *path);
+
+#endif
@@ -0,0 +1,101 @@
+#include "core_table.h"
+
+/**
+ * Checks whether every core lies within 4 Gbp of the first core of its block.
+ */
+static int blocks_fit(const struct simple_core *cores, uint64_t size, int shift) {
+    for (uint64_t i=0; i<size; i++) {
+        uint64_t block_start = cores[(i >> shift) << shift].start;
+        if (cores[i].start < block_start || cores[i].end < cores[i].start || UINT32_MAX < cores[i].end - block_start) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void compact_chr_cores(struct chr *chrom) {
+    struct core_table *table = &(chrom->table);
+    const struct simple_core *cores = chrom->cores;
+    uint64_t size = (uint64_t)chrom->cores_size;
+
+    memset(table, 0, sizeof(struct core_table));
+    if (size == 0) {
+        return;
+    }
+
+    table->id_base = cores[0].id;
+    for (uint64_t i=1; i<size; i++) {
+        if (cores[i].id != table->id_base + i) {
+            fprintf(stderr, "REF: Core ids of %s are not consecutive.\n", chrom->seq_name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // blocks are shrunk only if a gap of 4 Gbp falls into a block
+    int shift = CORE_TABLE_MAX_SHIFT;
+    while (0 < shift && !blocks_fit(cores, size, shift)) {
+        shift--;
+    }
+    if (shift == 0 && !blocks_fit(cores, size, 0)) {
+        fprintf(stderr, "REF: A core of %s is too long to be compacted.\n", chrom->seq_name);
+        exit(EXIT_FAILURE);
+    }
+    table->block_shift = shift;
+
+    uint64_t block_count = ((size - 1) >> shift) + 1;
+    table->block_starts = (uint64_t *)malloc(block_count * sizeof(uint64_t));
+    table->starts = (uint32_t *)malloc(size * sizeof(uint32_t));
+    table->ends = (uint32_t *)malloc(size * sizeof(uint32_t));
+    if (table->block_starts == NULL || table->starts == NULL || table->ends == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to core table.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint64_t b=0; b<block_count; b++) {
+        table->block_starts[b] = cores[b << shift].start;
+    }
+    for (uint64_t i=0; i<size; i++) {
+        uint64_t block_start = table->block_starts[i >> shift];
+        table->starts[i] = (uint32_t)(cores[i].start - block_start);
+        table->ends[i] = (uint32_t)(cores[i].end - block_start);
+    }
+}
+
+void free_core_table(struct core_table *table) {
+    free(table->block_starts);
+    free(table->starts);
+    free(table->ends);
+    memset(table, 0, sizeof(struct core_table));
+}
+
+uint64_t core_table_bytes(const struct core_table *table, int cores_size) {
+    if (table->starts == NULL) {
+        return 0;
+    }
+    uint64_t block_count = (((uint64_t)cores_size - 1) >> table->block_shift) + 1;
+    return block_count * sizeof(uint64_t) + (uint64_t)cores_size * 2 * sizeof(uint32_t);
+}
+
+void compact_ref_cores(struct ref_seq *seqs, int verbose) {
+    uint64_t before = 0, after = 0;
+
+    for (int i=0; i<seqs->size; i++) {
+        struct chr *chrom = &(seqs->chrs[i]);
+        if (chrom->cores == NULL || chrom->table.starts != NULL) {
+            continue;
+        }
+
+        compact_chr_cores(chrom);
+
+        int in_map = seqs->map != NULL && seqs->map <= (char *)chrom->cores && (char *)chrom->cores < seqs->map + seqs->map_size;
+        if (!in_map) {
+            free(chrom->cores);
+        }
+        chrom->cores = NULL;
+
+        before += (uint64_t)chrom->cores_size * sizeof(struct simple_core);
+        after += core_table_bytes(&(chrom->table), chrom->cores_size);
+    }
+
+    (void)(verbose && printf("[INFO] Cores compacted from %.2f MB to %.2f MB.\n", before / 1048576.0, after / 1048576.0));
+}
@@ -0,0 +1,71 @@
+/**
+ * @file core_table.h
+ * @brief Compact structure-of-arrays storage of the LCP cores of a chromosome.
+ *
+ * In `-vg` and `-vgx` modes the cores of a chromosome have consecutive ids,
+ * so only the id of the first core is kept. Cores are grouped into blocks of
+ * up to 2^CORE_TABLE_MAX_SHIFT cores. The start of the first core of a block
+ * is stored once, and the start and end of every core are 32-bit offsets from
+ * it in two separate arrays. A core takes 8 bytes instead of 24.
+ */
+
+#ifndef __CORE_TABLE_H__
+#define __CORE_TABLE_H__
+
+#include "struct_def.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CORE_TABLE_MAX_SHIFT 8
+
+/**
+ * @brief Compacts the cores of every chromosome and releases the core arrays.
+ *
+ * Core arrays that point into a mapped index are not freed, only dropped.
+ *
+ * @param seqs    The reference sequences with (refined) cores.
+ * @param verbose Prints the memory used before and after compaction if set.
+ */
+void compact_ref_cores(struct ref_seq *seqs, int verbose);
+
+/**
+ * @brief Builds `chrom->table` from `chrom->cores`.
+ *
+ * `chrom->cores` is left untouched. Exits if the ids of the cores are not
+ * consecutive or if a core is longer than 4 Gbp.
+ */
+void compact_chr_cores(struct chr *chrom);
+
+/**
+ * @brief Frees the core table, if any.
+ */
+void free_core_table(struct core_table *table);
+
+/**
+ * @brief Number of bytes used by the core table.
+ */
+uint64_t core_table_bytes(const struct core_table *table, int cores_size);
+
+/**
+ * @brief Start index of the `index`th core of a compacted chromosome.
+ */
+static inline uint64_t core_start(const struct chr *chrom, uint64_t index) {
+    return chrom->table.block_starts[index >> chrom->table.block_shift] + chrom->table.starts[index];
+}
+
+/**
+ * @brief End index of the `index`th core of a compacted chromosome.
+ */
+static inline uint64_t core_end(const struct chr *chrom, uint64_t index) {
+    return chrom->table.block_starts[index >> chrom->table.block_shift] + chrom->table.ends[index];
+}
+
+/**
+ * @brief Id of the `index`th core of a compacted chromosome.
+ */
+static inline uint64_t core_id(const struct chr *chrom, uint64_t index) {
+    return chrom->table.id_base + index;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "dedup.h"
+
+static inline uint64_t alt_hash(const char *alt, uint64_t alt_len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (uint64_t i=0; i<alt_len; i++) {
+        h = (h ^ (unsigned char)alt[i]) * 1099511628211ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+void dedup_window_init(struct dedup_window *window) {
+    window->chrom_index = -1;
+    window->pos = 0;
+    window->alleles = NULL;
+    window->size = 0;
+    window->capacity = 0;
+    window->arena = NULL;
+    window->arena_size = 0;
+    window->arena_capacity = 0;
+    window->merged = 0;
+}
+
+void dedup_window_free(struct dedup_window *window) {
+    free(window->alleles);
+    free(window->arena);
+    window->alleles = NULL;
+    window->arena = NULL;
+    window->size = 0;
+    window->capacity = 0;
+    window->arena_size = 0;
+    window->arena_capacity = 0;
+}
+
+int dedup_window_add(struct dedup_window *window, int chrom_index, uint64_t pos, uint64_t ref_len, const char *alt, uint64_t alt_len) {
+
+    if (window->chrom_index != chrom_index || window->pos != pos) {
+        window->chrom_index = chrom_index;
+        window->pos = pos;
+        window->size = 0;
+        window->arena_size = 0;
+    }
+
+    uint64_t hash = alt_hash(alt, alt_len);
+    for (int i=0; i<window->size; i++) {
+        const struct dedup_allele *allele = &(window->alleles[i]);
+        if (allele->hash == hash && allele->ref_len == ref_len && allele->alt_len == alt_len &&
+            memcmp(window->arena + allele->alt_offset, alt, alt_len) == 0) {
+            window->merged++;
+            return 0;
+        }
+    }
+
+    if (window->size == DEDUP_WINDOW_ALLELES || DEDUP_WINDOW_BYTES < window->arena_size + alt_len) {
+        return 1;
+    }
+
+    if (window->size == window->capacity) {
+        int capacity = window->capacity ? 2 * window->capacity : 16;
+        struct dedup_allele *alleles = (struct dedup_allele *)realloc(window->alleles, capacity * sizeof(struct dedup_allele));
+        if (alleles == NULL) {
+            return 1;
+        }
+        window->alleles = alleles;
+        window->capacity = capacity;
+    }
+    if (window->arena_capacity < window->arena_size + alt_len) {
+        uint64_t capacity = 2 * (window->arena_size + alt_len);
+        char *arena = (char *)realloc(window->arena, capacity);
+        if (arena == NULL) {
+            return 1;
+        }
+        window->arena = arena;
+        window->arena_capacity = capacity;
+    }
+
+    memcpy(window->arena + window->arena_size, alt, alt_len);
+    window->alleles[window->size++] = (struct dedup_allele){hash, ref_len, alt_len, window->arena_size};
+    window->arena_size += alt_len;
+
+    return 1;
+}
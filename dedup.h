@@ -0,0 +1,70 @@
+/**
+ * @file dedup.h
+ * @brief Detection of identical alleles at the same locus (`--dedup`).
+ *
+ * Split multi-sample VCFs and concatenated call sets carry the same ALT
+ * allele at the same position more than once, and each copy would become its
+ * own segment with parallel links. A window holds the alleles of the current
+ * chromosome and position, keyed by the length of the REF span and a hash of
+ * the ALT sequence. As the VCF is sorted, the window is emptied when the
+ * position changes, so its memory depends only on the number of alleles at one
+ * position, and it is capped at DEDUP_WINDOW_ALLELES alleles and
+ * DEDUP_WINDOW_BYTES bytes of ALT sequence.
+ */
+
+#ifndef __DEDUP_H__
+#define __DEDUP_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEDUP_WINDOW_ALLELES 1024
+#define DEDUP_WINDOW_BYTES 1048576
+
+struct dedup_allele {
+    uint64_t hash;       /** Hash of the ALT sequence. */
+    uint64_t ref_len;    /** Length of the REF span. */
+    uint64_t alt_len;    /** Length of the ALT sequence. */
+    uint64_t alt_offset; /** Offset of the ALT sequence in the arena. */
+};
+
+struct dedup_window {
+    int chrom_index;               /** Chromosome of the alleles in the window. */
+    uint64_t pos;                  /** Position of the alleles in the window. */
+    struct dedup_allele *alleles;
+    int size;
+    int capacity;
+    char *arena;                   /** ALT sequences of the alleles. */
+    uint64_t arena_size;
+    uint64_t arena_capacity;
+    uint64_t merged;               /** Number of duplicate alleles found. */
+};
+
+/**
+ * @brief Initializes an empty window.
+ */
+void dedup_window_init(struct dedup_window *window);
+
+/**
+ * @brief Frees the window.
+ */
+void dedup_window_free(struct dedup_window *window);
+
+/**
+ * @brief Adds an allele to the window.
+ *
+ * Alleles of an earlier position are dropped first. If the window is full
+ * the allele is not stored and is reported as new, so it is kept in the graph.
+ *
+ * @param window      The window.
+ * @param chrom_index Chromosome of the allele.
+ * @param pos         0-based position of the allele.
+ * @param ref_len     Length of the REF span.
+ * @param alt         ALT sequence.
+ * @param alt_len     Length of the ALT sequence.
+ * @return 1 if the allele is new, 0 if the same allele is already in the window.
+ */
+int dedup_window_add(struct dedup_window *window, int chrom_index, uint64_t pos, uint64_t ref_len, const char *alt, uint64_t alt_len);
+
+#endif
@@ -56,147 +56,382 @@ static inline uint64_t MurmurHash3_32(const void *key, int len) {
     return (uint64_t)h1;
 }
 
+static inline int in_map(const struct ref_seq *seqs, const void *ptr) {
+    return seqs->map != NULL && (const char *)ptr >= seqs->map && (const char *)ptr < seqs->map + seqs->map_size;
+}
+
+static inline uint64_t chr_name_hash(const char *name) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++) {
+        h = (h ^ *c) * 1099511628211ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+void build_chr_name_table(struct ref_seq *seqs) {
+    uint64_t table_size = 16;
+    while (table_size < (uint64_t)seqs->size * 2) {
+        table_size *= 2;
+    }
+
+    seqs->name_table = (int *)malloc(table_size * sizeof(int));
+    if (seqs->name_table == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to chromosome name table.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(seqs->name_table, -1, table_size * sizeof(int));
+    seqs->name_table_mask = table_size - 1;
+
+    for (int i=0; i<seqs->size; i++) {
+        uint64_t slot = chr_name_hash(seqs->chrs[i].seq_name) & seqs->name_table_mask;
+        while (seqs->name_table[slot] != -1) {
+            if (strcmp(seqs->chrs[seqs->name_table[slot]].seq_name, seqs->chrs[i].seq_name) == 0) {
+                break; // duplicate name, the first one is kept
+            }
+            slot = (slot + 1) & seqs->name_table_mask;
+        }
+        if (seqs->name_table[slot] == -1) {
+            seqs->name_table[slot] = i;
+        }
+    }
+}
+
+int find_chr(const struct ref_seq *seqs, const char *name) {
+    uint64_t slot = chr_name_hash(name) & seqs->name_table_mask;
+    while (seqs->name_table[slot] != -1) {
+        int index = seqs->name_table[slot];
+        if (strcmp(seqs->chrs[index].seq_name, name) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & seqs->name_table_mask;
+    }
+    return -1;
+}
+
+void free_chr_data(struct ref_seq *seqs, int chr_idx) {
+    struct chr *chrom = &(seqs->chrs[chr_idx]);
+
+    if (!in_map(seqs, chrom->seq)) {
+        free(chrom->seq);
+    }
+    chrom->seq = NULL;
+    free_packed_seq(&(chrom->packed));
+    if (chrom->cores_size && !in_map(seqs, chrom->cores)) {
+        free(chrom->cores);
+    }
+    chrom->cores = NULL;
+    if (!in_map(seqs, chrom->table.starts)) {
+        free_core_table(&(chrom->table));
+    } else {
+        memset(&(chrom->table), 0, sizeof(struct core_table));
+    }
+
+    path_ids_free(&(chrom->ids));
+    chrom->cores_size = 0;
+}
+
 void free_ref_seq(struct ref_seq *seqs) {
 	if (seqs->size) {
 		for (int i=0; i<seqs->size; i++) {
 			free(seqs->chrs[i].seq_name);
-			free(seqs->chrs[i].seq);
-            if (seqs->chrs[i].cores_size) {
-			    free(seqs->chrs[i].cores);
-            }
-            
-            if (seqs->chrs[i].ids) {
-                for (int j=0; j<seqs->chrs[i].cores_size; j++) {
-                    if (seqs->chrs[i].ids[j] != NULL) free(seqs->chrs[i].ids[j]);
-                }
-                free(seqs->chrs[i].ids);
-            }
+            free_chr_data(seqs, i);
 		}
 		free(seqs->chrs);
 		seqs->size = 0;
 	}
+    free(seqs->name_table);
+    seqs->name_table = NULL;
+    if (seqs->map != NULL) {
+        munmap(seqs->map, seqs->map_size);
+        seqs->map = NULL;
+        seqs->map_size = 0;
+    }
 }
 
-void vgx_process_chrom(char *sequence, uint64_t seq_size, int lcp_level, int skip_masked, struct chr *chrom, uint64_t *core_id_index, int thread_number) {
-    uint64_t id = *core_id_index;
-
-    uint64_t estimated_core_size = (uint64_t)(seq_size / pow(1.5, lcp_level));
-    uint64_t estimated_core_length = (uint64_t)(3 * pow(2, lcp_level-1));
-    chrom->cores_size = 0;
+/**
+ * Splits [start, end) into fixed length pieces. Used for masked runs and for
+ * the runs where LCP could not find any core.
+ */
+static void split_run(struct ref_run *run, uint64_t start, uint64_t end, uint64_t core_length) {
+    uint64_t count = (end - start + core_length - 1) / core_length;
+    run->cores = (struct simple_core *)malloc(count * sizeof(struct simple_core));
+    if (run->cores == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to cores of a run.\n");
+        exit(EXIT_FAILURE);
+    }
+    run->cores_size = 0;
 
-    if (estimated_core_size == 0) {
-        chrom->cores = NULL;
-        return;
+    uint64_t i = start;
+    while (i+core_length < end) {
+        run->cores[run->cores_size++] = (struct simple_core){0, i, i+core_length};
+        i += core_length;
     }
-    
-    chrom->cores = (struct simple_core*)malloc(estimated_core_size * sizeof(struct simple_core));
+    run->cores[run->cores_size++] = (struct simple_core){0, i, end};
+}
 
-    uint64_t index = 0;
-    uint64_t last_core_index = 0;
+/**
+ * Finds the runs of valid (ACGT) and masked characters of a chromosome. The
+ * masked runs are split right away as they do not need LCP.
+ */
+static void find_runs(void *arg) {
+    struct ref_chrom_task *task = (struct ref_chrom_task *)arg;
+    const char *sequence = task->chrom->seq;
+    uint64_t seq_size = task->chrom->seq_size;
 
     int valid_chars[256] = {0};
     valid_chars['A'] = valid_chars['C'] = valid_chars['T'] = valid_chars['G'] = 1;
     valid_chars['a'] = valid_chars['c'] = valid_chars['t'] = valid_chars['g'] = 1;
 
+    task->runs_size = 0;
+    task->runs_capacity = 16;
+    task->runs = (struct ref_run *)malloc(task->runs_capacity * sizeof(struct ref_run));
+    if (task->runs == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to runs of a chromosome.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t index = 0;
+
     while (index < seq_size) {
-        {
-            uint64_t temp_index = index;
-            
-            while (index < seq_size && !valid_chars[(unsigned char)sequence[index]]) {
-                index++;
-            }
+        uint64_t start = index;
+        int is_valid = valid_chars[(unsigned char)sequence[index]];
 
-            if (!skip_masked) {
-                if (temp_index != index) {
-                    uint64_t i = temp_index;
-                    while (i+estimated_core_length < index) {
-                        chrom->cores[last_core_index].id = id;
-                        chrom->cores[last_core_index].start = i;
-                        chrom->cores[last_core_index].end = i+estimated_core_length;
-                        id++;
-                        last_core_index++;
-                        i += estimated_core_length;
-                    }
-                    chrom->cores[last_core_index].id = id;
-                    chrom->cores[last_core_index].start = i;
-                    chrom->cores[last_core_index].end = index;
-                    id++;
-                    last_core_index++;
-                }
+        while (index < seq_size && valid_chars[(unsigned char)sequence[index]] == is_valid) {
+            index++;
+        }
+
+        if (!is_valid && task->skip_masked) {
+            continue;
+        }
+
+        if (task->runs_size == task->runs_capacity) {
+            task->runs_capacity *= 2;
+            struct ref_run *runs = (struct ref_run *)realloc(task->runs, task->runs_capacity * sizeof(struct ref_run));
+            if (runs == NULL) {
+                fprintf(stderr, "REF: Couldn't allocate memory to runs of a chromosome.\n");
+                exit(EXIT_FAILURE);
             }
+            task->runs = runs;
         }
 
-        if (index == seq_size)
-            break;
+        struct ref_run *run = &(task->runs[task->runs_size++]);
+        run->start = start;
+        run->end = index;
+        run->is_valid = is_valid;
+        run->cores = NULL;
+        run->cores_size = 0;
 
-        uint64_t end = index;
-        
-        while (end < seq_size && valid_chars[(unsigned char)sequence[end]]) {
-            end++;
+        if (!is_valid) {
+            split_run(run, start, index, task->estimated_core_length);
         }
+    }
+}
 
-        struct lps str;
-        init_lps_offset(&str, sequence+index, end-index, index);
-        lps_deepen_parallel(&str, lcp_level, thread_number);
-
-        if (str.size) {
-            if (str.cores[0].start != index) {
-                chrom->cores[last_core_index].id = id;
-                chrom->cores[last_core_index].start = index;
-                chrom->cores[last_core_index].end = str.cores[0].start;
-                id++;
-                last_core_index++;                
-            }
+/**
+ * Computes LCP cores of a single run of valid characters. Cores do not get
+ * ids here; they are assigned after all runs are processed.
+ */
+static void process_run(struct ref_chrom_task *task, struct ref_run *run, int thread_number) {
+    uint64_t index = run->start;
+    uint64_t end = run->end;
+
+    struct lps str;
+    init_lps_offset(&str, task->chrom->seq+index, end-index, index);
+    if (thread_number > 1) {
+        lps_deepen_parallel(&str, task->lcp_level, thread_number);
+    } else {
+        lps_deepen(&str, task->lcp_level);
+    }
 
-            for (int i=0; i<str.size; i++) {
-                chrom->cores[last_core_index].id = id;
-                chrom->cores[last_core_index].start = str.cores[i].start;
-                chrom->cores[last_core_index].end = str.cores[i].end;
-                id++;
-                last_core_index++;
-            }
-    
-            if (str.cores[str.size-1].end != end) {
-                chrom->cores[last_core_index].id = id;
-                chrom->cores[last_core_index].start = str.cores[str.size-1].end;
-                chrom->cores[last_core_index].end = end;
-                id++;
-                last_core_index++;                
-            }
-        } else {
-            uint64_t i = index;
-            while (i+estimated_core_length < end) {
-                chrom->cores[last_core_index].id = id;
-                chrom->cores[last_core_index].start = i;
-                chrom->cores[last_core_index].end = i+estimated_core_length;
-                id++;
-                last_core_index++;
-                i += estimated_core_length;
-            }
+    if (str.size) {
+        run->cores = (struct simple_core *)malloc((str.size + 2) * sizeof(struct simple_core));
+        if (run->cores == NULL) {
+            fprintf(stderr, "REF: Couldn't allocate memory to cores of a run.\n");
+            exit(EXIT_FAILURE);
+        }
+        run->cores_size = 0;
+
+        if (str.cores[0].start != index) {
+            run->cores[run->cores_size++] = (struct simple_core){0, index, str.cores[0].start};
+        }
+
+        for (int i=0; i<str.size; i++) {
+            run->cores[run->cores_size++] = (struct simple_core){0, str.cores[i].start, str.cores[i].end};
+        }
+
+        if (str.cores[str.size-1].end != end) {
+            run->cores[run->cores_size++] = (struct simple_core){0, str.cores[str.size-1].end, end};
+        }
+    } else {
+        split_run(run, index, end, task->estimated_core_length);
+    }
+
+    free_lps(&str);
+}
+
+static void process_runs(void *arg) {
+    struct ref_run_task *task = (struct ref_run_task *)arg;
+    for (int i=task->first_run; i<task->last_run; i++) {
+        if (task->chrom_task->runs[i].is_valid) {
+            process_run(task->chrom_task, &(task->chrom_task->runs[i]), task->thread_hint);
+        }
+    }
+}
+
+/**
+ * Concatenates the cores of the runs into chromosome's core array and gives
+ * them ids starting from the chromosome's id base.
+ */
+static void assemble_chrom(void *arg) {
+    struct ref_chrom_task *task = (struct ref_chrom_task *)arg;
+    struct chr *chrom = task->chrom;
+
+    chrom->cores_size = (int)task->cores_size;
+    chrom->cores = task->cores_size ? (struct simple_core *)malloc(task->cores_size * sizeof(struct simple_core)) : NULL;
+    if (task->cores_size && chrom->cores == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to cores of %s.\n", chrom->seq_name);
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t id = task->id_base;
+    uint64_t last_core_index = 0;
+
+    for (int i=0; i<task->runs_size; i++) {
+        struct ref_run *run = &(task->runs[i]);
+        for (uint64_t j=0; j<run->cores_size; j++) {
+            chrom->cores[last_core_index] = run->cores[j];
             chrom->cores[last_core_index].id = id;
-            chrom->cores[last_core_index].start = i;
-            chrom->cores[last_core_index].end = end;
             id++;
             last_core_index++;
         }
+        free(run->cores);
+    }
+
+    free(task->runs);
+}
+
+static int compare_run_tasks(const void *a, const void *b) {
+    const struct ref_run_task *x = (const struct ref_run_task *)a;
+    const struct ref_run_task *y = (const struct ref_run_task *)b;
+    return (x->length < y->length) - (x->length > y->length);
+}
+
+void vgx_process_ref(struct ref_seq *seqs, int lcp_level, int skip_masked, uint64_t *core_id_index, int thread_number) {
+
+    struct ref_chrom_task *chrom_tasks = (struct ref_chrom_task *)malloc(seqs->size * sizeof(struct ref_chrom_task));
+    if (chrom_tasks == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to chromosome tasks.\n");
+        exit(EXIT_FAILURE);
+    }
+    struct tpool *tm = tpool_create(thread_number);
+
+    // find valid and masked runs of every chromosome in parallel
+    for (int i=0; i<seqs->size; i++) {
+        struct ref_chrom_task *task = &(chrom_tasks[i]);
+        task->chrom = &(seqs->chrs[i]);
+        task->lcp_level = lcp_level;
+        task->skip_masked = skip_masked;
+        task->estimated_core_length = (uint64_t)(3 * pow(2, lcp_level-1));
+        task->runs_size = 0;
+        task->runs = NULL;
+        task->cores_size = 0;
+        task->id_base = 0;
+
+        // too short chromosomes have no cores at all
+        if ((uint64_t)(seqs->chrs[i].seq_size / pow(1.5, lcp_level)) != 0) {
+            tpool_add_work(tm, find_runs, task);
+        }
+    }
+    tpool_wait(tm);
 
-        index = end;
-        free_lps(&str); 
+    // group runs into tasks: every large run on its own, small runs of a chromosome together
+    int run_tasks_size = 0, run_tasks_capacity = seqs->size;
+    struct ref_run_task *run_tasks = (struct ref_run_task *)malloc(run_tasks_capacity * sizeof(struct ref_run_task));
+    if (run_tasks == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to run tasks.\n");
+        exit(EXIT_FAILURE);
     }
+    uint64_t total_length = 0;
 
-    chrom->cores_size = last_core_index;
+    for (int i=0; i<seqs->size; i++) {
+        struct ref_chrom_task *task = &(chrom_tasks[i]);
+        int first_small = -1;
+        uint64_t small_length = 0;
 
-    if (chrom->cores_size) {
-        struct simple_core *temp = (struct simple_core*)realloc(chrom->cores, chrom->cores_size * sizeof(struct simple_core));
-        if (temp != NULL) {
-            chrom->cores = temp;
+        for (int j=0; j<=task->runs_size; j++) {
+            int is_last = j == task->runs_size;
+            uint64_t length = is_last ? 0 : task->runs[j].end - task->runs[j].start;
+            int is_large = !is_last && task->runs[j].is_valid && REF_TASK_MIN_LENGTH <= length;
+
+            if (!is_last && task->runs[j].is_valid && !is_large) {
+                if (first_small == -1) first_small = j;
+                small_length += length;
+            }
+
+            if ((is_large || is_last) && first_small != -1) {
+                if (run_tasks_size == run_tasks_capacity) {
+                    run_tasks_capacity *= 2;
+                    struct ref_run_task *temp = (struct ref_run_task *)realloc(run_tasks, run_tasks_capacity * sizeof(struct ref_run_task));
+                    if (temp == NULL) {
+                        fprintf(stderr, "REF: Couldn't allocate memory to run tasks.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    run_tasks = temp;
+                }
+                run_tasks[run_tasks_size++] = (struct ref_run_task){task, first_small, j, small_length, 1};
+                total_length += small_length;
+                first_small = -1;
+                small_length = 0;
+            }
+
+            if (is_large) {
+                if (run_tasks_size == run_tasks_capacity) {
+                    run_tasks_capacity *= 2;
+                    struct ref_run_task *temp = (struct ref_run_task *)realloc(run_tasks, run_tasks_capacity * sizeof(struct ref_run_task));
+                    if (temp == NULL) {
+                        fprintf(stderr, "REF: Couldn't allocate memory to run tasks.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    run_tasks = temp;
+                }
+                run_tasks[run_tasks_size++] = (struct ref_run_task){task, j, j+1, length, 1};
+                total_length += length;
+            }
         }
-    } else {
-        free(chrom->cores);
-        chrom->cores = NULL;
     }
 
+    // longest first, so that the long chromosomes do not start last. large runs 
+    // get a share of threads proportional to their length for parallel deepening
+    qsort(run_tasks, run_tasks_size, sizeof(struct ref_run_task), compare_run_tasks);
+    for (int i=0; i<run_tasks_size; i++) {
+        if (total_length) {
+            int share = (int)((double)thread_number * run_tasks[i].length / total_length);
+            run_tasks[i].thread_hint = share > 1 ? share : 1;
+        }
+        tpool_add_work(tm, process_runs, &(run_tasks[i]));
+    }
+    tpool_wait(tm);
+
+    // assign ids deterministically: prefix sum over core counts in chromosome order
+    uint64_t id = *core_id_index;
+    for (int i=0; i<seqs->size; i++) {
+        struct ref_chrom_task *task = &(chrom_tasks[i]);
+        for (int j=0; j<task->runs_size; j++) {
+            task->cores_size += task->runs[j].cores_size;
+        }
+        task->id_base = id;
+        id += task->cores_size;
+    }
     *core_id_index = id;
+
+    for (int i=0; i<seqs->size; i++) {
+        tpool_add_work(tm, assemble_chrom, &(chrom_tasks[i]));
+    }
+    tpool_wait(tm);
+
+    tpool_destroy(tm);
+    free(run_tasks);
+    free(chrom_tasks);
 }
 
 void ldbg_process_chrom(char *sequence, uint64_t seq_size, int lcp_level, struct chr *chrom) {
@@ -209,6 +444,10 @@ void ldbg_process_chrom(char *sequence, uint64_t seq_size, int lcp_level, struct
     }
     
     chrom->cores = (struct simple_core*)malloc(estimated_core_size * sizeof(struct simple_core));
+    if (chrom->cores == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to cores of %s.\n", chrom->seq_name);
+        exit(EXIT_FAILURE);
+    }
 
     uint64_t index = 0;
     uint64_t last_core_index = 0;
@@ -247,9 +486,9 @@ void ldbg_process_chrom(char *sequence, uint64_t seq_size, int lcp_level, struct
     }
 }
 
-void read_fasta(struct opt_arg *args, struct ref_seq *seqs) {
+void read_fai(struct opt_arg *args, struct ref_seq *seqs) {
 
-    printf("[INFO] Processing reference...\n");
+    uint64_t start = stats_now();
 
     // read index (fai) file to get chromosome count and allocate space for chromosomes for later processing
     int line_size = 1024;
@@ -272,6 +511,9 @@ void read_fasta(struct opt_arg *args, struct ref_seq *seqs) {
     }
 
     seqs->size = chrom_index;
+    seqs->map = NULL;
+    seqs->map_size = 0;
+    seqs->name_table = NULL;
     seqs->chrs = (struct chr *)malloc(chrom_index*sizeof(struct chr));
     if (seqs->chrs == NULL) {
         fprintf(stderr, "REF: Couldn't allocate memory to ref sequences\n");
@@ -282,129 +524,257 @@ void read_fasta(struct opt_arg *args, struct ref_seq *seqs) {
     chrom_index = 0;
     uint64_t global_index = 0;
 
-    time_t main_start;
-    time(&main_start);
-
     while (fgets(line, sizeof(line), idx) != NULL) {
-        char *name, *length;
+        char *name, *length, *offset, *line_bases, *line_width;
+        struct chr *chrom = &(seqs->chrs[chrom_index]);
+        stats_add_read(strlen(line));
         
         // assign name
         char *saveptr;
         name = strtok_r(line, "\t", &saveptr);
-        seqs->chrs[chrom_index].global_index = global_index;
+        chrom->global_index = global_index;
         uint64_t name_len = strlen(name);
-        seqs->chrs[chrom_index].seq_name = (char *)malloc(name_len+1);
-        memcpy(seqs->chrs[chrom_index].seq_name, name, name_len);
-        seqs->chrs[chrom_index].seq_name[name_len] = '\0';
+        chrom->seq_name = (char *)malloc(name_len+1);
+        if (chrom->seq_name == NULL) {
+            fprintf(stderr, "REF: Couldn't allocate memory to chromosome name.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(chrom->seq_name, name, name_len);
+        chrom->seq_name[name_len] = '\0';
 
         // assign size and allocate in memory
         length = strtok_r(NULL, "\t", &saveptr);
-        seqs->chrs[chrom_index].seq_size = strtol(length, NULL, 10);
-        global_index += seqs->chrs[chrom_index].seq_size;
-
-        seqs->chrs[chrom_index].seq = (char *)malloc(seqs->chrs[chrom_index].seq_size+1);
-        if (seqs->chrs[chrom_index].seq == NULL) {
+        chrom->seq_size = strtoull(length, NULL, 10);
+        global_index += chrom->seq_size;
+
+        // layout of the sequence in FASTA file (OFFSET, LINEBASES, LINEWIDTH)
+        offset     = strtok_r(NULL, "\t", &saveptr);
+        line_bases = strtok_r(NULL, "\t", &saveptr);
+        line_width = strtok_r(NULL, "\t\n", &saveptr);
+        chrom->fa_offset  = offset     ? strtoull(offset, NULL, 10) : 0;
+        chrom->line_bases = line_bases ? (int)strtol(line_bases, NULL, 10) : 0;
+        chrom->line_width = line_width ? (int)strtol(line_width, NULL, 10) : 0;
+
+        chrom->seq = (char *)malloc(chrom->seq_size+1);
+        if (chrom->seq == NULL) {
             fprintf(stderr, "REF: Couldn't allocate memory to chromosome string.\n");
             exit(EXIT_FAILURE);
         }
-        seqs->chrs[chrom_index].seq[seqs->chrs[chrom_index].seq_size] = '\0';
-        seqs->chrs[chrom_index].ids = NULL;
+        chrom->seq[chrom->seq_size] = '\0';
+        memset(&(chrom->packed), 0, sizeof(chrom->packed));
+        memset(&(chrom->table), 0, sizeof(chrom->table));
+        chrom->cores_size = 0;
+        chrom->cores = NULL;
+        memset(&(chrom->ids), 0, sizeof(chrom->ids));
         chrom_index++;
     }
 
     fclose(idx);
 
-    // move to read reference file
-    FILE *ref = fopen(args->fasta_path, "r");
+    build_chr_name_table(seqs);
+
+    stats_add_time(STATS_FAI_PARSE, stats_now() - start);
+}
+
+int load_fasta_mmap(struct opt_arg *args, struct ref_seq *seqs) {
+
+    // line layout is required to compute positions of the bases in the file
+    for (int i=0; i<seqs->size; i++) {
+        if (seqs->chrs[i].line_bases <= 0 || seqs->chrs[i].line_width <= seqs->chrs[i].line_bases) {
+            return 0;
+        }
+    }
+
+    int fd = open(args->fasta_path, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    uint64_t file_size = (uint64_t)st.st_size;
+    const char *map = (const char *)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    madvise((void *)map, file_size, MADV_SEQUENTIAL);
+
+    // compressed files are inflated by the stream reader
+    if (2 <= file_size && (uint8_t)map[0] == 31 && (uint8_t)map[1] == 139) {
+        munmap((void *)map, file_size);
+        return 0;
+    }
+
+    // validate layout before touching any buffer so that fallback path starts from scratch
+    for (int i=0; i<seqs->size; i++) {
+        const struct chr *chrom = &(seqs->chrs[i]);
+        uint64_t line_count = chrom->seq_size ? (chrom->seq_size - 1) / chrom->line_bases : 0;
+        uint64_t last_bases = chrom->seq_size - line_count * chrom->line_bases;
+        if (chrom->fa_offset + line_count * chrom->line_width + last_bases > file_size) {
+            fprintf(stderr, "REF: Index does not match FASTA layout for %s, falling back to stream reading.\n", chrom->seq_name);
+            munmap((void *)map, file_size);
+            return 0;
+        }
+    }
+
+    // compact the newlines out of the mapped pages, one memcpy per line
+    for (int i=0; i<seqs->size; i++) {
+        struct chr *chrom = &(seqs->chrs[i]);
+        const char *src = map + chrom->fa_offset;
+        char *dst = chrom->seq;
+        uint64_t line_bases = (uint64_t)chrom->line_bases;
+        uint64_t line_width = (uint64_t)chrom->line_width;
+        uint64_t remaining = (uint64_t)chrom->seq_size;
+
+        while (line_bases < remaining) {
+            memcpy(dst, src, line_bases);
+            dst += line_bases;
+            src += line_width;
+            remaining -= line_bases;
+        }
+        memcpy(dst, src, remaining);
+    }
+
+    munmap((void *)map, file_size);
+    stats_add_read(file_size);
+
+    return 1;
+}
+
+void load_fasta_stream(struct opt_arg *args, struct ref_seq *seqs) {
+
+    bgzf_file_t *ref = bgzf_open(args->fasta_path, args->thread_number);
     if (ref == NULL) {
         fprintf(stderr, "REF: Couldn't open file %s\n", args->fasta_path);
         exit(EXIT_FAILURE);
     }
 
+    uint64_t buffer_size = 1048576;
+    char *buffer = (char *)malloc(buffer_size);
+    if (buffer == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to read buffer.\n");
+        exit(EXIT_FAILURE);
+    }
+
     // make necesarry declaretions and initialization
     uint64_t sequence_size = 0;
-    int index = 0;
+    int index = -1;
+    int in_header = 0;
+    int line_start = 1;
+    int64_t n;
+
+    // process reference file chunk by chunk, lines may span chunk boundaries
+    while ((n = bgzf_read(ref, buffer, buffer_size)) > 0) {
+        const char *curr = buffer;
+        const char *end = buffer + n;
+
+        while (curr < end) {
+            if (in_header) {
+                const char *newline = (const char *)memchr(curr, '\n', end - curr);
+                if (newline == NULL) {
+                    curr = end;
+                } else {
+                    curr = newline + 1;
+                    in_header = 0;
+                    line_start = 1;
+                }
+                continue;
+            }
 
-    // process reference file
-    while (fgets(line, line_size, ref)) {
+            if (line_start && *curr == '>') {
+                sequence_size = 0;
+                index++;
+                in_header = 1;
+                continue;
+            }
 
-        line[strcspn(line, "\n")] = '\0';
+            const char *newline = (const char *)memchr(curr, '\n', end - curr);
+            const char *line_end = newline ? newline : end;
 
-        if (line[0] == '>') {
-            if (sequence_size != 0) {
-                if (args->program == VG || args->program == VGX) {
-                    vgx_process_chrom(seqs->chrs[index].seq, sequence_size, args->lcp_level, args->skip_masked, &(seqs->chrs[index]), &(args->core_id_index), args->thread_number);
-                } else if (args->program == LDBG) {
-                    ldbg_process_chrom(seqs->chrs[index].seq, sequence_size, args->lcp_level, &(seqs->chrs[index]));
+            if (0 <= index && index < seqs->size) {
+                uint64_t line_len = line_end - curr;
+                if (line_len && line_end[-1] == '\r') {
+                    line_len--;
                 }
-                sequence_size = 0;
-                index++;
+                if (sequence_size + line_len > seqs->chrs[index].seq_size) {
+                    line_len = seqs->chrs[index].seq_size - sequence_size;
+                }
+                memcpy(seqs->chrs[index].seq + sequence_size, curr, line_len);
+                sequence_size += line_len;
             }
-        } else {
-            uint64_t line_len = strlen(line);
-            memcpy(seqs->chrs[index].seq + sequence_size, line, line_len);
-            sequence_size += line_len;
+
+            line_start = newline != NULL;
+            curr = newline ? newline + 1 : end;
         }
     }
 
-    if (sequence_size != 0) {
-        if (args->program == VG || args->program == VGX) {
-            vgx_process_chrom(seqs->chrs[index].seq, sequence_size, args->lcp_level, args->skip_masked, &(seqs->chrs[index]), &(args->core_id_index), args->thread_number);
-        } else if (args->program == LDBG) {
-            ldbg_process_chrom(seqs->chrs[index].seq, sequence_size, args->lcp_level, &(seqs->chrs[index]));
-        }
-        index++;
+    if (n < 0) {
+        fprintf(stderr, "REF: Couldn't read file %s\n", args->fasta_path);
+        exit(EXIT_FAILURE);
     }
 
-    fclose(ref);
+    free(buffer);
+    bgzf_close(ref);
+}
+
+void read_fasta(struct opt_arg *args, struct ref_seq *seqs) {
+
+    printf("[INFO] Processing reference...\n");
 
-    time_t main_end;
-    time(&main_end);
+    read_fai(args, seqs);
 
-    printf("[INFO] Reference processing completed in %0.2f sec.\n", difftime(main_end, main_start));
+    uint64_t main_start = stats_now();
+
+    if (!load_fasta_mmap(args, seqs)) {
+        load_fasta_stream(args, seqs);
+    }
+
+    uint64_t lcp_start = stats_now();
+    stats_add_time(STATS_FASTA_READ, lcp_start - main_start);
+
+    if (args->program == VG || args->program == VGX) {
+        vgx_process_ref(seqs, args->lcp_level, args->skip_masked, &(args->core_id_index), args->thread_number);
+    } else if (args->program == LDBG) {
+        for (int i=0; i<seqs->size; i++) {
+            ldbg_process_chrom(seqs->chrs[i].seq, seqs->chrs[i].seq_size, args->lcp_level, &(seqs->chrs[i]));
+        }
+    }
+
+    uint64_t main_end = stats_now();
+    stats_add_time(STATS_LCP_DEEPENING, main_end - lcp_start);
+
+    printf("[INFO] Reference processing completed in %0.2f sec.\n", (main_end - main_start) / 1e9);
 }
 
-void print_ref_seqs(const struct ref_seq *seqs, int is_rgfa, FILE *out) {
+void print_ref_seqs(const struct ref_seq *seqs, int is_rgfa, gfa_stream_t *stream) {
 
     printf("[INFO] Printing reference...\n");
 
-    fprintf(out, "H\tVN:Z:1.1\n");
+    gfa_put_cstr(stream, "H\tVN:Z:1.1\n");
 
 	// iterate through each chromosome
 	for (int i=0; i<seqs->size; i++) {
 		if (seqs->chrs[i].cores_size) {
-            const char *seq_name = seqs->chrs[i].seq_name;
-            const char *seq = seqs->chrs[i].seq;
+            const struct chr *chrom = &(seqs->chrs[i]);
             
-            {
-                const struct simple_core *curr_core = &(seqs->chrs[i].cores[0]);
-                uint64_t start = curr_core->start;
-                print_seq(curr_core->id, seq+start, (int)(curr_core->end - start), seq_name, start, 0, is_rgfa, out);
-            }
+            print_ref_seq(core_id(chrom, 0), chrom, core_start(chrom, 0), core_end(chrom, 0), is_rgfa, stream);
             
-            for (int j=1; j<seqs->chrs[i].cores_size; j++) {
-                const struct simple_core *curr_core = &(seqs->chrs[i].cores[j]);
-                const struct simple_core *prev_core = &(seqs->chrs[i].cores[j-1]);
-                uint64_t curr_start = curr_core->start;
-                int seq_len = (int)(curr_core->end - curr_start);
-                int overlap = (int)(prev_core->end - curr_start);
+            for (int j=1; j<chrom->cores_size; j++) {
+                uint64_t curr_start = core_start(chrom, j);
+                uint64_t prev_end = core_end(chrom, j-1);
                 
                 // there might be graps ('N') in genome, hence
-                if (overlap < 0) {
-                    overlap = 0;
-                }
-
-                print_seq(curr_core->id, seq+curr_start, seq_len, seq_name, curr_start, 0, is_rgfa, out);
-                print_link(prev_core->id, '+', curr_core->id, '+', overlap, out);
-            }
+                uint64_t overlap = curr_start < prev_end ? prev_end - curr_start : 0;
 
-            // Print Path (P)
-            fprintf(out, "P\t%s\t", seq_name);
-            fprintf(out, "%lu+", seqs->chrs[i].cores[0].id);
-            for (int j=1; j<seqs->chrs[i].cores_size; j++) {
-                fprintf(out, ",%lu+", seqs->chrs[i].cores[j].id);
+                print_ref_seq(core_id(chrom, j), chrom, curr_start, core_end(chrom, j), is_rgfa, stream);
+                print_link(core_id(chrom, j-1), '+', core_id(chrom, j), '+', overlap, stream);
+                gfa_stream_sync(stream, GFA_STREAM_FLUSH_SIZE);
             }
-            fprintf(out, "\t*\n");
         }
 	}
 }
\ No newline at end of file
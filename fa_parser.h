@@ -4,9 +4,57 @@
 #include "struct_def.h"
 #include "lps.h"
 #include "utils.h"
+#include "tpool.h"
+#include "bgzf.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define REF_TASK_MIN_LENGTH 1048576
+
+struct ref_run {
+    uint64_t start;            /** Start index of the run in chromosome. */
+    uint64_t end;              /** End index of the run in chromosome. */
+    int is_valid;              /** 1 if run has only valid chars (ACGT), 0 if it is masked. */
+    uint64_t cores_size;       /** Number of cores found in the run. */
+    struct simple_core *cores; /** Cores of the run (ids are assigned after all runs are processed). */
+};
+
+struct ref_chrom_task {
+    struct chr *chrom;              /** Chromosome to be processed. */
+    int lcp_level;                  /** The LCP level to be used. */
+    int skip_masked;                /** Boolean argument to decide whether masked runs have cores. */
+    uint64_t estimated_core_length; /** Length of the pieces masked runs are split into. */
+    int runs_size;                  /** Number of runs. */
+    int runs_capacity;              /** Capacity of runs array. */
+    struct ref_run *runs;           /** Valid and masked runs of the chromosome in order. */
+    uint64_t cores_size;            /** Total number of cores in the chromosome. */
+    uint64_t id_base;               /** Id of the first core in the chromosome. */
+};
+
+struct ref_run_task {
+    struct ref_chrom_task *chrom_task; /** Chromosome the runs belong to. */
+    int first_run;                     /** Index of the first run to be processed. */
+    int last_run;                      /** Index after the last run to be processed. */
+    uint64_t length;                   /** Total length of valid runs in the task. */
+    int thread_hint;                   /** Number of threads to deepen with. */
+};
+
+/**
+ * @brief Frees the sequence, the cores and the ids of a chromosome.
+ *
+ * Only the name and the size of the chromosome are kept, its `cores_size`
+ * becomes 0. Parts that point into a mapped FASTA or index are dropped
+ * without being freed.
+ *
+ * @param seqs    The reference sequences.
+ * @param chr_idx Index of the chromosome.
+ */
+void free_chr_data(struct ref_seq *seqs, int chr_idx);
 
 /**
  * @brief Frees memory allocated for the ref_seq structure.
@@ -15,6 +63,78 @@
  */
 void free_ref_seq(struct ref_seq *seqs);
 
+/**
+ * @brief Reads the FASTA index (fai) file and allocates chromosome buffers.
+ *
+ * Every chromosome gets its name, size, global index and FASTA layout
+ * (OFFSET, LINEBASES, LINEWIDTH) from the index. The `seq` buffers are
+ * allocated with `seq_size+1` bytes but are not filled.
+ *
+ * @param args A pointer to the `opt_arg` structure containing the fai path.
+ * @param seqs A pointer to the `ref_seq` structure to be initialized.
+ */
+void read_fai(struct opt_arg *args, struct ref_seq *seqs);
+
+/**
+ * @brief Builds the open-addressing table of chromosome names.
+ *
+ * Called by `read_fai`. The table is read-only afterwards, hence it can be
+ * shared by all threads without locking.
+ *
+ * @param seqs A pointer to the `ref_seq` structure with chromosome names.
+ */
+void build_chr_name_table(struct ref_seq *seqs);
+
+/**
+ * @brief Finds the chromosome with the given name.
+ *
+ * @param seqs A pointer to the `ref_seq` structure.
+ * @param name Name of the chromosome.
+ * @return Index of the chromosome in `seqs->chrs`, -1 if not found.
+ */
+int find_chr(const struct ref_seq *seqs, const char *name);
+
+/**
+ * @brief Fills chromosome sequences by memory mapping the FASTA file.
+ *
+ * Uses the offsets and line widths from the fai to copy each line of bases
+ * directly from the mapped pages into `chr.seq`, skipping newlines without
+ * any per-line stdio calls.
+ *
+ * @param args A pointer to the `opt_arg` structure containing the FASTA path.
+ * @param seqs A pointer to the `ref_seq` structure initialized by `read_fai`.
+ * @return 1 on success, 0 if the file cannot be mapped or the index lacks
+ *         line layout or the file is compressed (caller should fall back to
+ *         `load_fasta_stream`).
+ */
+int load_fasta_mmap(struct opt_arg *args, struct ref_seq *seqs);
+
+/**
+ * @brief Fills chromosome sequences by streaming the FASTA file.
+ *
+ * Reads plain, gzip or BGZF compressed FASTA files. BGZF blocks are inflated
+ * in parallel with `args->thread_number` threads.
+ *
+ * @param args A pointer to the `opt_arg` structure containing the FASTA path.
+ * @param seqs A pointer to the `ref_seq` structure initialized by `read_fai`.
+ */
+void load_fasta_stream(struct opt_arg *args, struct ref_seq *seqs);
+
+/**
+ * @brief Computes LCP cores of all chromosomes in parallel.
+ *
+ * Valid (N-free) runs of the chromosomes are processed as tasks on a thread
+ * pool, longest first. Core ids are then assigned in a prefix-sum pass in
+ * chromosome order, so the ids are the same as a serial run would give.
+ *
+ * @param seqs          Reference sequences with filled `seq` buffers.
+ * @param lcp_level     The LCP level to be used.
+ * @param skip_masked   Boolean argument to decide whether masked runs have cores.
+ * @param core_id_index Pointer to the global id index. Updated to the next free id.
+ * @param thread_number Number of threads.
+ */
+void vgx_process_ref(struct ref_seq *seqs, int lcp_level, int skip_masked, uint64_t *core_id_index, int thread_number);
+
 /**
  * @brief Reads a FASTA file and processes sequences using the LCP.
  *
@@ -35,15 +155,15 @@ void read_fasta(struct opt_arg *args, struct ref_seq *seqs);
  *
  * This function outputs the reference sequences and their Locally Consistent
  * Parsing (LCP) cores in rGFA/GFA format. The cores are printed as segments and
- * links, depending on the provided options.
+ * links, depending on the provided options. Paths are printed by `print_path`.
  *
  * @param seqs       A pointer to the `ref_seq` structure containing the reference
  *                   sequences and their processed LCP cores.
  * @param is_rgfa    A flag indicating whether to print in rGFA format (1 for rGFA,
  *                   0 for GFA).
- * @param out        A file pointer to the output file where the formatted segments
- *                   and links will be written.
+ * @param stream     The output stream where the formatted segments and links will
+ *                   be written. It is synced after each record.
  */
-void print_ref_seqs(const struct ref_seq *seqs, int is_rgfa, FILE *out);
+void print_ref_seqs(const struct ref_seq *seqs, int is_rgfa, gfa_stream_t *stream);
 
 #endif
\ No newline at end of file
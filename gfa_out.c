@@ -0,0 +1,101 @@
+#include "gfa_out.h"
+
+const char gfa_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+void gfa_file_open(gfa_file_t *file, const char *path) {
+    file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file->fd == -1) {
+        fprintf(stderr, "[ERROR] Couldn't open output file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&file->offset, 0);
+}
+
+void gfa_file_close(gfa_file_t *file) {
+    if (close(file->fd) == -1) {
+        perror("[ERROR] Couldn't close output file");
+        exit(EXIT_FAILURE);
+    }
+    file->fd = -1;
+}
+
+void gfa_file_append(gfa_file_t *file, const char *data, uint64_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    uint64_t start = stats_now();
+    uint64_t offset = atomic_fetch_add_explicit(&file->offset, size, memory_order_relaxed);
+    stats_add_written(size);
+
+    while (size) {
+        ssize_t written = pwrite(file->fd, data, size, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("[ERROR] Couldn't write output file");
+            exit(EXIT_FAILURE);
+        }
+        data += written;
+        offset += written;
+        size -= written;
+    }
+
+    stats_add_time(STATS_EMIT, stats_now() - start);
+}
+
+void gfa_stream_open(gfa_stream_t *stream, gfa_file_t *file) {
+    gfa_stream_open_capacity(stream, file, GFA_STREAM_FLUSH_SIZE + 65536);
+}
+
+void gfa_stream_open_capacity(gfa_stream_t *stream, gfa_file_t *file, uint64_t capacity) {
+    stream->capacity = capacity ? capacity : 1;
+    stream->size = 0;
+    stream->file = file;
+    stream->data = (char *)malloc(stream->capacity);
+    if (stream->data == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't create output stream\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void gfa_stream_grow(gfa_stream_t *stream, uint64_t len) {
+    uint64_t capacity = stream->capacity * 2;
+    while (capacity - stream->size < len) {
+        capacity *= 2;
+    }
+
+    char *data = (char *)realloc(stream->data, capacity);
+    if (data == NULL) {
+        fprintf(stderr, "[ERROR] Memory reallocation failed for output stream\n");
+        exit(EXIT_FAILURE);
+    }
+    stream->data = data;
+    stream->capacity = capacity;
+}
+
+void gfa_stream_sync(gfa_stream_t *stream, uint64_t threshold) {
+    if (stream->size < threshold) {
+        return;
+    }
+
+    gfa_file_append(stream->file, stream->data, stream->size);
+    stream->size = 0; // reuse the buffer
+}
+
+void gfa_stream_close(gfa_stream_t *stream) {
+    gfa_file_append(stream->file, stream->data, stream->size);
+    free(stream->data);
+    stream->data = NULL;
+    stream->size = 0;
+    stream->capacity = 0;
+}
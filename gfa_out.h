@@ -0,0 +1,141 @@
+/**
+ * @file gfa_out.h
+ * @brief Parallel writing of a single rGFA/GFA file.
+ *
+ * Each thread renders its records into its own memory buffer. Integers are
+ * converted with a digit-pair table and sequences are copied with `memcpy`,
+ * so no format string is parsed and no stdio lock is taken per record.
+ * When the buffer grows beyond GFA_STREAM_FLUSH_SIZE at a record boundary,
+ * a region of the final file is reserved by atomically advancing the file's
+ * end offset and the buffer is written there with `pwrite`. Hence, threads
+ * never wait for each other to write and the records of a buffer are never
+ * interleaved with the records of another thread.
+ */
+
+#ifndef __GFA_OUT_H__
+#define __GFA_OUT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "stats.h"
+
+#define GFA_STREAM_FLUSH_SIZE 4194304
+
+typedef struct {
+    int fd;                     /** Descriptor of the final GFA file. */
+    _Atomic uint64_t offset;    /** End of the reserved part of the file. */
+} gfa_file_t;
+
+typedef struct {
+    char *data;                 /** Rendered records. */
+    uint64_t size;              /** Number of bytes in the buffer. */
+    uint64_t capacity;          /** Allocated size of the buffer. */
+    gfa_file_t *file;           /** File the buffer is written to. */
+} gfa_stream_t;
+
+/** "00" "01" ... "99", used to convert two decimal digits at a time. */
+extern const char gfa_digit_pairs[200];
+
+/**
+ * @brief Creates (truncates) the final GFA file. Exits on failure.
+ */
+void gfa_file_open(gfa_file_t *file, const char *path);
+
+/**
+ * @brief Closes the final GFA file. All streams should be closed before.
+ */
+void gfa_file_close(gfa_file_t *file);
+
+/**
+ * @brief Reserves `size` bytes at the end of the file and writes `data` there.
+ *
+ * `data` should consist of complete records. Exits on failure.
+ */
+void gfa_file_append(gfa_file_t *file, const char *data, uint64_t size);
+
+/**
+ * @brief Opens a buffer whose content is appended to `file`.
+ */
+void gfa_stream_open(gfa_stream_t *stream, gfa_file_t *file);
+
+/**
+ * @brief Opens a buffer of `capacity` bytes (at least 1) whose content is appended to `file`.
+ */
+void gfa_stream_open_capacity(gfa_stream_t *stream, gfa_file_t *file, uint64_t capacity);
+
+/**
+ * @brief Grows the buffer so that `len` more bytes fit. Exits on failure.
+ */
+void gfa_stream_grow(gfa_stream_t *stream, uint64_t len);
+
+/**
+ * @brief Appends the stream's buffer to the file if it holds at least `threshold` bytes.
+ *
+ * Should be called only at record boundaries.
+ */
+void gfa_stream_sync(gfa_stream_t *stream, uint64_t threshold);
+
+/**
+ * @brief Appends the remaining records to the file and closes the stream.
+ */
+void gfa_stream_close(gfa_stream_t *stream);
+
+static inline char *gfa_stream_reserve(gfa_stream_t *stream, uint64_t len) {
+    if (stream->capacity - stream->size < len) {
+        gfa_stream_grow(stream, len);
+    }
+    return stream->data + stream->size;
+}
+
+static inline void gfa_put_char(gfa_stream_t *stream, char c) {
+    *gfa_stream_reserve(stream, 1) = c;
+    stream->size++;
+}
+
+static inline void gfa_put_str(gfa_stream_t *stream, const char *str, uint64_t len) {
+    memcpy(gfa_stream_reserve(stream, len), str, len);
+    stream->size += len;
+}
+
+static inline void gfa_put_cstr(gfa_stream_t *stream, const char *str) {
+    gfa_put_str(stream, str, strlen(str));
+}
+
+static inline void gfa_put_u64(gfa_stream_t *stream, uint64_t value) {
+    int len = 1;
+    for (uint64_t v = value; v >= 10; v /= 10) {
+        len++;
+    }
+
+    char *dst = gfa_stream_reserve(stream, len) + len;
+    while (value >= 100) {
+        const char *pair = gfa_digit_pairs + (value % 100) * 2;
+        value /= 100;
+        *--dst = pair[1];
+        *--dst = pair[0];
+    }
+    if (value >= 10) {
+        *--dst = gfa_digit_pairs[value * 2 + 1];
+        *--dst = gfa_digit_pairs[value * 2];
+    } else {
+        *--dst = (char)('0' + value);
+    }
+    stream->size += len;
+}
+
+static inline void gfa_put_i64(gfa_stream_t *stream, int64_t value) {
+    if (value < 0) {
+        gfa_put_char(stream, '-');
+        gfa_put_u64(stream, (uint64_t)0 - (uint64_t)value);
+    } else {
+        gfa_put_u64(stream, (uint64_t)value);
+    }
+}
+
+#endif
@@ -18,12 +18,16 @@
 #include "utils.h"
 #include "opt_parser.h"
 #include "fa_parser.h"
+#include "ref_index.h"
 #include "vg.h"
 #include "vgx.h"
 #include "ldbg.h"
+#include "stats.h"
 
 int main(int argc, char* argv[]) {
 
+    uint64_t main_start = stats_now();
+
     struct opt_arg args;
     parse_opts(argc, argv, &args);
 
@@ -31,29 +35,57 @@ int main(int argc, char* argv[]) {
 
     struct ref_seq seqs; // sequence processed from fasta file
 
-    read_fasta(&args, &seqs);
+    int index_loaded = args.load_index_path != NULL && load_ref_index(&args, &seqs);
+    if (!index_loaded) {
+        read_fasta(&args, &seqs);
+        if (args.program == VG || args.program == VGX) {
+            uint64_t refine_start = stats_now();
+            refine_seqs(&seqs, args.no_overlap);
+            compact_ref_cores(&seqs, args.verbose);
+            stats_add_time(STATS_REFINE, stats_now() - refine_start);
+        }
+    }
 
-    FILE *gfa_out;
+    if (args.program == VG || args.program == VGX) {
+        if (args.save_index_path != NULL) {
+            if (index_loaded && strcmp(args.save_index_path, args.load_index_path) == 0) {
+                printf("[INFO] Reference index is loaded from %s, not saved again.\n", args.save_index_path);
+            } else {
+                save_ref_index(&args, &seqs);
+            }
+        }
+        if (args.pack_seq) {
+            uint64_t pack_start = stats_now();
+            pack_ref_seqs(&seqs, args.verbose);
+            stats_add_time(STATS_PACK, stats_now() - pack_start);
+        }
+    }
+
+    gfa_file_t gfa_out;
+    gfa_stream_t ref_out;
 
     switch (args.program) {
     
     case VG:
-        refine_seqs(&seqs, args.no_overlap);
-        vg_read_vcf(&args, &seqs);
+        gfa_file_open(&gfa_out, args.gfa_path);
+        vg_read_vcf(&args, &seqs, &gfa_out);
+        gfa_file_close(&gfa_out);
         break;
     case VGX:
-        refine_seqs(&seqs, args.no_overlap);
-        gfa_out = fopen(args.gfa_path, "w");
-        if (gfa_out == NULL) {
-            fprintf(stderr, "Couldn't open output file %s\n", args.gfa_path);
-            exit(EXIT_FAILURE);
-        }
-        print_ref_seqs(&seqs, args.is_rgfa, gfa_out);
-        vgx_read_vcf(&args, &seqs);
+        gfa_file_open(&gfa_out, args.gfa_path);
+        uint64_t print_start = stats_now();
+        gfa_stream_open(&ref_out, &gfa_out);
+        print_ref_seqs(&seqs, args.is_rgfa, &ref_out);
+        gfa_stream_close(&ref_out);
+        uint64_t path_start = stats_now();
+        stats_add_time(STATS_REF_PRINT, path_start - print_start);
+        print_path(&seqs, &gfa_out, args.thread_number);
+        stats_add_time(STATS_PATH_PRINT, stats_now() - path_start);
+        vgx_read_vcf(&args, &seqs, &gfa_out);
         (void)(args.verbose && printf("[INFO] Total number of bubbles created: %d\n", args.bubble_count));
         (void)(args.verbose && printf("[INFO] Total number of invalid lines in the vcf file: %d\n", args.invalid_line_count));
         (void)(args.verbose && printf("[INFO] Total number of failed variations: %d\n", args.failed_var_count));
-        fclose(gfa_out);
+        gfa_file_close(&gfa_out);
         break;
     // case LDBG:
     //     gfa_out = fopen(args.gfa_path, "w");
@@ -68,6 +100,14 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Invalid program mode provided.\n");
     }
     
+    if (args.stats_json_path != NULL) {
+        const char *program = args.program == VG ? "vg" : args.program == VGX ? "vgx" : "ldbg";
+        if (!stats_write_json(args.stats_json_path, program, args.thread_number, args.lcp_level, stats_now() - main_start)) {
+            fprintf(stderr, "[WARN] Couldn't write stats file %s\n", args.stats_json_path);
+        }
+    }
+    stats_free();
+
     free_opt_arg(&args);
     free_ref_seq(&seqs);
 
@@ -1,6 +1,7 @@
 # Pipeline for experiments (VG)
 
 ## NOTE: It is assumed that you have `human_v38.fa` reference genome and `hprc-v1.0-pggb.grch38.1-22+X.vcf` HPRC variant calls files. 
+## NOTE: lcpan reads bgzipped (or gzipped) VCF/FASTA directly, the uncompressed VCF is only needed by the other tools.
 ## NOTE: You can get HPRC data from:
 ##          https://s3-us-west-2.amazonaws.com/human-pangenomics/index.html?prefix=pangenomes/freeze/freeze1/pggb/vcfs/
 ## NOTE: Pacbio-HiFi reads can be found at:
@@ -57,7 +58,6 @@ ALIGN=true
 AKHAL={akhal:-}
 GRAPHALIGNER={GraphAligner:-}
 LCPAN={lcpan:-}
-LCPANMERGE={lcpan-merge.sh:-}
 
 FASTA={human_v38.fa:-}
 FAI={human_v38.fa.fai:-}
@@ -234,6 +234,32 @@ parse_2files() {
     echo "" >> $out
 }
 
+parse_1file() {
+    # it gets the first /bin/time -v result and ignores the rest (construct)
+    local file=$1
+    local log=$2
+    local out=$3
+
+    echo "$file stats:" >> $out
+
+    mapfile -t times < <(grep "Elapsed (wall clock) time" "$log" | awk '{print $8}')
+    mapfile -t rams  < <(grep "Maximum resident set size (kbytes)" "$log" | awk '{print $6}')
+
+    if (( ${#times[@]} < 1 || ${#rams[@]} < 1 )); then
+        echo "Could not parse $log" >> $out; return
+    fi
+
+    local exec_time=$(time_to_seconds "${times[0]}")
+    local max_ram_gb=$(echo "scale=2; ${rams[0]}/(1024*1024)" | bc -l)
+    local file_gb=$(file_size "$file")
+
+    echo "Execution time (s): $exec_time" >> $out
+    echo "Total runtime (s): $exec_time" >> $out
+    echo "Max RAM usage (GB): $max_ram_gb" >> $out
+    echo "File size (GB): $file_gb" >> $out
+    echo "" >> $out
+}
+
 summarize_stats() {
     local in="$1"
     local out="$2"
@@ -366,13 +392,12 @@ if [ "$LCPAN_RGFA" = "true" ]; then
             -p hg38.pggb.lcpan.l${l} \
             -l ${l} \
             --verbose > hg38.pggb.lcpan.l${l}.out 2>&1; \
-        /bin/time -v bash ${LCPANMERGE} hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
     done
     parallel --env AKHAL "/bin/time -v ${AKHAL} parse hg38.pggb.lcpan.l{}.rgfa >> hg38.pggb.lcpan.l{}.out 2>&1" ::: 4 5 6 7
     parallel --env AKHAL "${AKHAL} stats hg38.pggb.lcpan.l{}.rgfa >> hg38.pggb.lcpan.l{}.out 2>&1" ::: 4 5 6 7
 
     for l in 4 5 6 7; do
-        parse_2files "hg38.pggb.lcpan.l${l}.rgfa" "hg38.pggb.lcpan.l${l}.out" "stats.txt"
+        parse_1file "hg38.pggb.lcpan.l${l}.rgfa" "hg38.pggb.lcpan.l${l}.out" "stats.txt"
     done
 
     rm -f *.log
@@ -401,13 +426,12 @@ if [ "$LCPAN_GFA" = "true" ]; then
             -l ${l} \
             --verbose \
             --gfa > hg38.pggb.lcpan.l${l}.out 2>&1; \
-        /bin/time -v bash ${LCPANMERGE} hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
     done
     parallel --env AKHAL "/bin/time -v ${AKHAL} parse hg38.pggb.lcpan.l{}.gfa >> hg38.pggb.lcpan.l{}.out 2>&1" ::: 4 5 6 7
     parallel --env AKHAL "${AKHAL} stats hg38.pggb.lcpan.l{}.gfa >> hg38.pggb.lcpan.l{}.out 2>&1" ::: 4 5 6 7
 
     for l in 4 5 6 7; do
-        parse_2files "hg38.pggb.lcpan.l${l}.gfa" "hg38.pggb.lcpan.l${l}.out" "stats.txt"
+        parse_1file "hg38.pggb.lcpan.l${l}.gfa" "hg38.pggb.lcpan.l${l}.out" "stats.txt"
     done
 
     rm -f *.log
@@ -446,10 +470,9 @@ if [ "$LCPAN_THD" = "true" ]; then
                 --gfa \
                 --verbose > "$out" 2>&1
 
-            /bin/time -v bash "${LCPANMERGE}" "hg38.pggb.lcpan.t${t}.r${r}.log" >> "$out" 2>&1
             /bin/time -v "${AKHAL}" parse "hg38.pggb.lcpan.t${t}.r${r}.gfa" >> "$out" 2>&1
 
-            parse_2files "hg38.pggb.lcpan.t${t}.r${r}.gfa" "$out" "stats.t${t}.txt"
+            parse_1file "hg38.pggb.lcpan.t${t}.r${r}.gfa" "$out" "stats.t${t}.txt"
         done
 
         summarize_stats "stats.t${t}.txt" "summary.t${t}.txt"
@@ -624,7 +647,6 @@ if [ "$ALIGN_LIMITED" = "true" ]; then
     if [ ! -f "$PREFIX.pggb.lcpan.gfa" ]; then
         echo "LCPan graph construction for alignment started ..."
         /bin/time -v ${LCPAN} -vg -r "$PREFIX.fa" -v $SUB_HPRC -p "$PREFIX.pggb.lcpan" --gfa --verbose > "$PREFIX.pggb.lcpan.out" 2>&1
-        /bin/time -v bash ${LCPANMERGE} "$PREFIX.pggb.lcpan.log" >> "$PREFIX.pggb.lcpan.out" 2>&1
         ${AKHAL} stats "$PREFIX.pggb.lcpan.gfa" >> "$PREFIX.pggb.lcpan.out" 2>&1
         rm -f $PREFIX.pggb.lcpan.log
     else
@@ -707,7 +729,6 @@ if [ "$ALIGN" = "true" ]; then
     if [ ! -f "$PREFIX.pggb.lcpan.gfa" ]; then
         echo "LCPan graph construction for alignment started ..."
         /bin/time -v ${LCPAN} -vg -r $FASTA -v $HPRC -p "$PREFIX.pggb.lcpan" --gfa --verbose > "$PREFIX.pggb.lcpan.out" 2>&1
-        /bin/time -v bash ${LCPANMERGE} "$PREFIX.pggb.lcpan.log" >> "$PREFIX.pggb.lcpan.out" 2>&1
         ${AKHAL} stats "$PREFIX.pggb.lcpan.gfa" >> "$PREFIX.pggb.lcpan.out" 2>&1
         rm -f $PREFIX.pggb.lcpan.log
     else
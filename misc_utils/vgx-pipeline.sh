@@ -36,7 +36,6 @@
 ##
 ## The required data and program executables structure should be as follows:
 ##          ├── lcpan
-##          ├── lcpan-merge.sh
 ##          ├── hg38.chr22.fa
 ##          ├── hg38.chr22.fa.fai
 ##          ├── hg38.fa
@@ -64,7 +63,6 @@ for t in 1 2 4 8 16; do \
         -t $t \
         --gfa \
         --verbose > hg38.pggb.lcpan.t${t}.out 2>&1; \
-    /bin/time -v bash ../lcpan-merge.sh hg38.pggb.lcpan.t${t}.log >> hg38.pggb.lcpan.t${t}.out 2>&1; \
 done
 stat --format="%s %n" *.gfa 2>/dev/null | tee sizes.txt > /dev/null && rm -f *.gfa;
 
@@ -84,7 +82,6 @@ for l in 4 5 6 7; do \
         -p hg38.pggb.lcpan.l${l} \
         -l ${l} \
         --verbose > hg38.pggb.lcpan.l${l}.out 2>&1; \
-    /bin/time -v bash ../lcpan-merge.sh hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
 done
 stat --format="%s %n" *.rgfa 2>/dev/null | tee sizes.txt > /dev/null && rm -f *.rgfa;
 
@@ -105,7 +102,6 @@ for l in 4 5 6 7; do \
         -l ${l} \
         -s \
         --verbose > hg38.pggb.lcpan.l${l}.out 2>&1; \
-    /bin/time -v bash ../lcpan-merge.sh hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
 done
 stat --format="%s %n" *.rgfa 2>/dev/null | tee sizes.txt > /dev/null && rm -f *.rgfa;
 
@@ -126,7 +122,6 @@ for l in 4 5 6 7; do \
         -l ${l} \
         --verbose \
         --gfa > hg38.pggb.lcpan.l${l}.out 2>&1; \
-    /bin/time -v bash ../lcpan-merge.sh hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
 done
 stat --format="%s %n" *.gfa 2>/dev/null | tee sizes.txt > /dev/null && rm -f *.gfa;
 
@@ -148,7 +143,6 @@ for l in 4 5 6 7; do \
         -s \
         --verbose \
         --gfa > hg38.pggb.lcpan.l${l}.out 2>&1; \
-    /bin/time -v bash ../lcpan-merge.sh hg38.pggb.lcpan.l${l}.log >> hg38.pggb.lcpan.l${l}.out 2>&1; \
 done
 stat --format="%s %n" *.gfa 2>/dev/null | tee sizes.txt > /dev/null && rm -f *.gfa;
 
@@ -167,7 +161,6 @@ cd alignment-chr22
 
 #### Create nov-gfa LCPan graph
 /bin/time -v ../lcpan -vgx -r ../hg38.chr22.fa -v ../pggb.chr22.vcf -p hg38.chr22.pggb.lcpan --gfa --verbose > hg38.chr22.pggb.lcpan.out 2>&1;
-/bin/time -v bash ../lcpan-merge.sh hg38.chr22.pggb.lcpan.log >> hg38.chr22.pggb.lcpan.out 2>&1;
 
 #### Align HiFi reads of (hg002.chr22)
 echo "HiFi"
@@ -0,0 +1,187 @@
+#include "mpmc.h"
+
+#include <limits.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/**
+ * Spinning only helps when the other side runs on another core.
+ */
+static int spin_count = -1;
+
+int mpmc_init(mpmc_ring_t *ring, uint64_t capacity) {
+    if (spin_count == -1) {
+        spin_count = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? MPMC_SPIN_COUNT : 0;
+    }
+
+    uint64_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    ring->cells = (mpmc_cell_t *)malloc(size * sizeof(mpmc_cell_t));
+    if (ring->cells == NULL) {
+        return 0;
+    }
+    ring->mask = size - 1;
+    for (uint64_t i=0; i<size; i++) {
+        atomic_init(&(ring->cells[i].seq), i);
+        ring->cells[i].data = NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return 1;
+}
+
+void mpmc_free(mpmc_ring_t *ring) {
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+void ec_init(eventcount_t *ec) {
+    atomic_init(&ec->epoch, 0);
+    atomic_init(&ec->waiters, 0);
+#ifndef __linux__
+    pthread_mutex_init(&ec->mutex, NULL);
+    pthread_cond_init(&ec->cond, NULL);
+#endif
+}
+
+void ec_destroy(eventcount_t *ec) {
+#ifndef __linux__
+    pthread_mutex_destroy(&ec->mutex);
+    pthread_cond_destroy(&ec->cond);
+#else
+    (void)ec;
+#endif
+}
+
+uint32_t ec_prepare(eventcount_t *ec) {
+    atomic_fetch_add_explicit(&ec->waiters, 1, memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&ec->epoch, memory_order_seq_cst);
+}
+
+void ec_cancel(eventcount_t *ec) {
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+void ec_wait(eventcount_t *ec, uint32_t key) {
+#ifdef __linux__
+    // returns at once if epoch is already changed
+    while (atomic_load_explicit(&ec->epoch, memory_order_acquire) == key) {
+        syscall(SYS_futex, (uint32_t *)&ec->epoch, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+    }
+#else
+    pthread_mutex_lock(&ec->mutex);
+    while (atomic_load_explicit(&ec->epoch, memory_order_acquire) == key) {
+        pthread_cond_wait(&ec->cond, &ec->mutex);
+    }
+    pthread_mutex_unlock(&ec->mutex);
+#endif
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+static inline void ec_wake(eventcount_t *ec, int count) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ec->waiters, memory_order_relaxed) == 0) {
+        return;
+    }
+#ifdef __linux__
+    atomic_fetch_add_explicit(&ec->epoch, 1, memory_order_seq_cst);
+    syscall(SYS_futex, (uint32_t *)&ec->epoch, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&ec->mutex);
+    atomic_fetch_add_explicit(&ec->epoch, 1, memory_order_seq_cst);
+    if (count == 1) {
+        pthread_cond_signal(&ec->cond);
+    } else {
+        pthread_cond_broadcast(&ec->cond);
+    }
+    pthread_mutex_unlock(&ec->mutex);
+#endif
+}
+
+void ec_notify(eventcount_t *ec) {
+    ec_wake(ec, INT_MAX);
+}
+
+void ec_notify_one(eventcount_t *ec) {
+    ec_wake(ec, 1);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+void mpmc_push(mpmc_ring_t *ring, void *data, eventcount_t *not_full, eventcount_t *not_empty) {
+    for (int spin=0; spin<spin_count; spin++) {
+        if (mpmc_try_push(ring, data)) {
+            ec_notify_one(not_empty);
+            return;
+        }
+        cpu_relax();
+    }
+    while (!mpmc_try_push(ring, data)) {
+        uint32_t key = ec_prepare(not_full);
+        if (mpmc_try_push(ring, data)) {
+            ec_cancel(not_full);
+            break;
+        }
+        ec_wait(not_full, key);
+    }
+    ec_notify_one(not_empty);
+}
+
+void *mpmc_pop(mpmc_ring_t *ring, eventcount_t *not_full, eventcount_t *not_empty, const int *exit_signal) {
+    void *data = NULL;
+    for (int spin=0; spin<spin_count; spin++) {
+        if (mpmc_try_pop(ring, &data)) {
+            goto popped;
+        }
+        cpu_relax();
+    }
+    while (!mpmc_try_pop(ring, &data)) {
+        if (__atomic_load_n(exit_signal, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        uint32_t key = ec_prepare(not_empty);
+        if (mpmc_try_pop(ring, &data)) {
+            ec_cancel(not_empty);
+            break;
+        }
+        if (__atomic_load_n(exit_signal, __ATOMIC_ACQUIRE)) {
+            ec_cancel(not_empty);
+            return NULL;
+        }
+        ec_wait(not_empty, key);
+    }
+popped:
+    // a single slot is freed, but the thread waiting for the ring to be empty must see it
+    if (mpmc_size(ring) == 0) {
+        ec_notify(not_full);
+    } else {
+        ec_notify_one(not_full);
+    }
+    return data;
+}
+
+void mpmc_wait_empty(mpmc_ring_t *ring, eventcount_t *not_full) {
+    while (mpmc_size(ring) > 0) {
+        uint32_t key = ec_prepare(not_full);
+        if (mpmc_size(ring) == 0) {
+            ec_cancel(not_full);
+            break;
+        }
+        ec_wait(not_full, key);
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file mpmc.h
+ * @brief Lock-free bounded multi-producer multi-consumer ring buffer.
+ *
+ * The ring stores `void *` items in a power-of-two sized array of cells.
+ * Every cell has a sequence number that tells whether it is ready to be
+ * written (sequence == position) or read (sequence == position+1), so
+ * producers and consumers only contend on their own position counter.
+ *
+ * Blocking operations sleep on event counts when the ring is empty or
+ * full. An event count lets a thread announce that it is about to sleep,
+ * re-check the ring and only then wait, so no wakeup is lost and no lock
+ * is taken when nobody is waiting.
+ */
+
+#ifndef __MPMC_H__
+#define __MPMC_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define MPMC_CACHE_LINE 64
+#define MPMC_SPIN_COUNT 64
+
+typedef struct {
+    _Atomic uint64_t seq; /** Sequence number of the cell. */
+    void *data;           /** Stored item. */
+} mpmc_cell_t;
+
+typedef struct {
+    _Alignas(MPMC_CACHE_LINE) _Atomic uint64_t head; /** Position to push. */
+    _Alignas(MPMC_CACHE_LINE) _Atomic uint64_t tail; /** Position to pop. */
+    _Alignas(MPMC_CACHE_LINE) mpmc_cell_t *cells;    /** Cells of the ring. */
+    uint64_t mask;                                   /** Capacity-1 (capacity is a power of two). */
+} mpmc_ring_t;
+
+typedef struct {
+    _Atomic uint32_t epoch;   /** Incremented on every notification while there are waiters. */
+    _Atomic uint32_t waiters; /** Number of threads that are about to sleep or sleeping. */
+#ifndef __linux__
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+} eventcount_t;
+
+/**
+ * Initializes the ring with at least `capacity` cells (rounded up to a power of two).
+ *
+ * @return 1 on success, 0 if memory allocation fails.
+ */
+int mpmc_init(mpmc_ring_t *ring, uint64_t capacity);
+
+/**
+ * Frees the cells of the ring. Items left in the ring are not freed.
+ */
+void mpmc_free(mpmc_ring_t *ring);
+
+void ec_init(eventcount_t *ec);
+void ec_destroy(eventcount_t *ec);
+
+/**
+ * Announces that the caller is about to wait. The returned key is passed to
+ * `ec_wait`. The caller must re-check its condition after this call and
+ * call `ec_cancel` if it does not need to wait anymore.
+ */
+uint32_t ec_prepare(eventcount_t *ec);
+void ec_cancel(eventcount_t *ec);
+void ec_wait(eventcount_t *ec, uint32_t key);
+
+/**
+ * Wakes up all waiters. Costs a single load if nobody is waiting.
+ */
+void ec_notify(eventcount_t *ec);
+
+/**
+ * Wakes up one waiter. Costs a single load if nobody is waiting.
+ */
+void ec_notify_one(eventcount_t *ec);
+
+/**
+ * Pushes an item, blocking while the ring is full.
+ */
+void mpmc_push(mpmc_ring_t *ring, void *data, eventcount_t *not_full, eventcount_t *not_empty);
+
+/**
+ * Pops an item, blocking while the ring is empty. Returns NULL once the ring
+ * is empty and `*exit_signal` is set.
+ */
+void *mpmc_pop(mpmc_ring_t *ring, eventcount_t *not_full, eventcount_t *not_empty, const int *exit_signal);
+
+/**
+ * Blocks until every item pushed to the ring has been popped.
+ */
+void mpmc_wait_empty(mpmc_ring_t *ring, eventcount_t *not_full);
+
+static inline int mpmc_try_push(mpmc_ring_t *ring, void *data) {
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (1) {
+        mpmc_cell_t *cell = &(ring->cells[pos & ring->mask]);
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                cell->data = data;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // full
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+static inline int mpmc_try_pop(mpmc_ring_t *ring, void **data) {
+    uint64_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (1) {
+        mpmc_cell_t *cell = &(ring->cells[pos & ring->mask]);
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                *data = cell->data;
+                atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // empty
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Approximate number of items in the ring (exact when there is no concurrent operation).
+ */
+static inline uint64_t mpmc_size(mpmc_ring_t *ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head > tail ? head - tail : 0;
+}
+
+#endif
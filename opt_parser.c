@@ -41,6 +41,14 @@ void printOptions() {
     fprintf(stderr, "\t--no-overlap | -s   Allow Overlap. [Default: No]\n");
     fprintf(stderr, "\t--skip-masked       Skip Masked Chars (N). [Default: No]\n");
     fprintf(stderr, "\t--tload-factor      Number of elements that can be stored at pool at once. [Defautl: %d]\n", THREAD_POOL_FACTOR);
+    fprintf(stderr, "\t--save-index        Save processed reference (LCP cores) to the given index file.\n");
+    fprintf(stderr, "\t--load-index        Load processed reference from the given index file instead of processing it.\n");
+    fprintf(stderr, "\t--index-seq         Store sequences in the saved index. [Default: No]\n");
+    fprintf(stderr, "\t--pack-seq          Keep the reference 2-bit packed after processing. [Default: No]\n");
+    fprintf(stderr, "\t--stats-json        Write stage timings, thread times and counters of the run to the given file.\n");
+    fprintf(stderr, "\t--sv-cache          Memory budget in MB of the cache of LCP cores of long ALT alleles, 0 disables it. [Default: %d]\n", DEFAULT_SV_CACHE_MB);
+    fprintf(stderr, "\t--dedup             Merge identical ALT alleles at the same position into one node. [Default: No]\n");
+    fprintf(stderr, "\t--stream            Print the path of a chromosome and free it once all its segments are printed (-vg). [Default: No]\n");
     fprintf(stderr, "\t--verbose  Verbose  [Default: false]\n");
 }
 
@@ -114,6 +122,14 @@ void parse_opts(int argc, char* argv[], struct opt_arg *args) {
     args->prefix = NULL;
     args->tload_factor = THREAD_POOL_FACTOR;
     args->verbose = 0;
+    args->save_index_path = NULL;
+    args->load_index_path = NULL;
+    args->index_seq = 0;
+    args->pack_seq = 0;
+    args->stats_json_path = NULL;
+    args->sv_cache_mb = DEFAULT_SV_CACHE_MB;
+    args->dedup = 0;
+    args->stream_paths = 0;
 
     int long_index;
     struct option long_options[] = {
@@ -127,6 +143,14 @@ void parse_opts(int argc, char* argv[], struct opt_arg *args) {
         {"skip-masked", no_argument, NULL, 8},
         {"tload-factor", required_argument, NULL, 9},
         {"verbose", no_argument, NULL, 10},
+        {"save-index", required_argument, NULL, 11},
+        {"load-index", required_argument, NULL, 12},
+        {"index-seq", no_argument, NULL, 13},
+        {"pack-seq", no_argument, NULL, 14},
+        {"stats-json", required_argument, NULL, 15},
+        {"sv-cache", required_argument, NULL, 16},
+        {"dedup", no_argument, NULL, 17},
+        {"stream", no_argument, NULL, 18},
         {NULL, 0, NULL, 0}
     };
 
@@ -180,6 +204,30 @@ void parse_opts(int argc, char* argv[], struct opt_arg *args) {
         case 10:
             args->verbose = 1;
             break;
+        case 11:
+            args->save_index_path = optarg;
+            break;
+        case 12:
+            args->load_index_path = optarg;
+            break;
+        case 13:
+            args->index_seq = 1;
+            break;
+        case 14:
+            args->pack_seq = 1;
+            break;
+        case 15:
+            args->stats_json_path = optarg;
+            break;
+        case 16:
+            args->sv_cache_mb = strtoull(optarg, NULL, 10);
+            break;
+        case 17:
+            args->dedup = 1;
+            break;
+        case 18:
+            args->stream_paths = 1;
+            break;
         default:
             fprintf(stderr, "[ERROR] Invalid option %c\n", opt);
             printOptions();
@@ -0,0 +1,100 @@
+#include "path_ids.h"
+
+void path_ids_init(struct path_ids *ids, int chunk_count) {
+    ids->chunks = (struct path_id_chunk *)calloc(chunk_count, sizeof(struct path_id_chunk));
+    if (ids->chunks == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to path ids.\n");
+        exit(EXIT_FAILURE);
+    }
+    ids->chunk_count = chunk_count;
+    ids->offsets = NULL;
+    ids->ids = NULL;
+}
+
+uint64_t *path_ids_append(struct path_ids *ids, int chunk, int core_idx, int count) {
+    struct path_id_chunk *c = &(ids->chunks[chunk]);
+
+    if (c->capacity < c->size + 2 + count) {
+        uint64_t capacity = 2 * (c->size + 2 + count);
+        if (capacity < 256) capacity = 256;
+        uint64_t *data = (uint64_t *)realloc(c->data, capacity * sizeof(uint64_t));
+        if (data == NULL) {
+            fprintf(stderr, "[ERROR] Couldn't allocate memory to path ids.\n");
+            exit(EXIT_FAILURE);
+        }
+        c->data = data;
+        c->capacity = capacity;
+    }
+
+    c->data[c->size++] = (uint64_t)core_idx;
+    c->data[c->size++] = (uint64_t)count;
+    uint64_t *slots = c->data + c->size;
+    c->size += count;
+
+    return slots;
+}
+
+void path_ids_build(struct path_ids *ids, int cores_size) {
+    if (ids->chunks == NULL) {
+        return;
+    }
+
+    // count the ids of every core
+    uint64_t total = 0;
+    for (int i=0; i<ids->chunk_count; i++) {
+        const struct path_id_chunk *c = &(ids->chunks[i]);
+        for (uint64_t r=0; r<c->size; r+=2+c->data[r+1]) {
+            if (ids->offsets == NULL) {
+                ids->offsets = (uint32_t *)calloc((uint64_t)cores_size + 1, sizeof(uint32_t));
+                if (ids->offsets == NULL) {
+                    fprintf(stderr, "[ERROR] Couldn't allocate memory to path ids.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            ids->offsets[c->data[r] + 1] += (uint32_t)c->data[r+1];
+            total += c->data[r+1];
+        }
+    }
+
+    if (ids->offsets != NULL) {
+        if (UINT32_MAX < total) {
+            fprintf(stderr, "[ERROR] Too many sub-segments in a chromosome to print its path.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int j=0; j<cores_size; j++) {
+            ids->offsets[j+1] += ids->offsets[j];
+        }
+
+        // a core is split by a single worker, so records can be copied in any order
+        ids->ids = (uint64_t *)malloc((total ? total : 1) * sizeof(uint64_t));
+        if (ids->ids == NULL) {
+            fprintf(stderr, "[ERROR] Couldn't allocate memory to path ids.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i=0; i<ids->chunk_count; i++) {
+            const struct path_id_chunk *c = &(ids->chunks[i]);
+            for (uint64_t r=0; r<c->size; r+=2+c->data[r+1]) {
+                memcpy(ids->ids + ids->offsets[c->data[r]], c->data + r + 2, c->data[r+1] * sizeof(uint64_t));
+            }
+        }
+    }
+
+    for (int i=0; i<ids->chunk_count; i++) {
+        free(ids->chunks[i].data);
+    }
+    free(ids->chunks);
+    ids->chunks = NULL;
+    ids->chunk_count = 0;
+}
+
+void path_ids_free(struct path_ids *ids) {
+    if (ids->chunks != NULL) {
+        for (int i=0; i<ids->chunk_count; i++) {
+            free(ids->chunks[i].data);
+        }
+        free(ids->chunks);
+    }
+    free(ids->offsets);
+    free(ids->ids);
+    memset(ids, 0, sizeof(struct path_ids));
+}
@@ -0,0 +1,59 @@
+/**
+ * @file path_ids.h
+ * @brief Storage of the sub-segment ids that the path of a chromosome goes through.
+ *
+ * In `-vg` mode an LCP core with variations is split into sub-segments, and
+ * the path of the chromosome visits their ids before the id of the core
+ * itself. While the VCF is processed, every worker appends the ids of the
+ * cores it splits to its own chunk of the chromosome as `core index, id
+ * count, ids...` records, without locks and without an allocation per core.
+ * Once all buckets of the chromosome are done, the chunks are stitched into a
+ * CSR layout: one offsets array over the cores and one flat id array.
+ */
+
+#ifndef __PATH_IDS_H__
+#define __PATH_IDS_H__
+
+#include "struct_def.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Allocates one empty chunk per worker.
+ *
+ * @param ids         The ids of a chromosome.
+ * @param chunk_count Number of workers appending ids.
+ */
+void path_ids_init(struct path_ids *ids, int chunk_count);
+
+/**
+ * @brief Appends a record for the `core_idx`th core to the chunk of a worker.
+ *
+ * Exits if memory allocation fails.
+ *
+ * @param ids      The ids of a chromosome.
+ * @param chunk    Index of the worker's chunk.
+ * @param core_idx Index of the split core.
+ * @param count    Number of sub-segment ids before the id of the core.
+ * @return Pointer to `count` slots the ids are written to, valid until the next append to the chunk.
+ */
+uint64_t *path_ids_append(struct path_ids *ids, int chunk, int core_idx, int count);
+
+/**
+ * @brief Stitches the chunks into `offsets` and `ids`, and frees the chunks.
+ *
+ * Does nothing if the chunks are already stitched. `offsets` is left NULL if
+ * no core is split. Exits if a chromosome has more than 2^32 sub-segments.
+ *
+ * @param ids        The ids of a chromosome.
+ * @param cores_size Number of LCP cores of the chromosome.
+ */
+void path_ids_build(struct path_ids *ids, int cores_size);
+
+/**
+ * @brief Frees the chunks or the stitched arrays.
+ */
+void path_ids_free(struct path_ids *ids);
+
+#endif
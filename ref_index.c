@@ -0,0 +1,274 @@
+#include "ref_index.h"
+
+static inline uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static inline uint64_t block_count(const struct ref_index_chrom *chrom) {
+    return chrom->cores_size ? ((chrom->cores_size - 1) >> chrom->block_shift) + 1 : 0;
+}
+
+static inline uint64_t fnv1a(uint64_t h, const void *data, uint64_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (uint64_t i=0; i<len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t ref_index_checksum(const struct opt_arg *args) {
+    uint64_t h = 1469598103934665603ULL;
+
+    char buffer[65536];
+    FILE *idx = fopen(args->fasta_fai_path, "r");
+    if (idx == NULL) {
+        return 0;
+    }
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), idx)) > 0) {
+        h = fnv1a(h, buffer, len);
+    }
+    fclose(idx);
+
+    // size and modification time of the FASTA, so edits that keep the length (e.g. masking) are detected
+    struct stat st;
+    if (stat(args->fasta_path, &st) != 0) {
+        return 0;
+    }
+    uint64_t key[3] = {(uint64_t)st.st_size, (uint64_t)st.st_mtim.tv_sec, (uint64_t)st.st_mtim.tv_nsec};
+    h = fnv1a(h, key, sizeof(key));
+
+    return h;
+}
+
+void save_ref_index(const struct opt_arg *args, const struct ref_seq *seqs) {
+
+    uint64_t start = stats_now();
+
+    // written next to the target and renamed over it, so a mapped index is never truncated
+    size_t path_len = strlen(args->save_index_path);
+    char *tmp_path = (char *)malloc(path_len + 5);
+    if (tmp_path == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to index path.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(tmp_path, args->save_index_path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't open index file %s\n", tmp_path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ref_index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REF_INDEX_MAGIC, sizeof(header.magic));
+    header.version = REF_INDEX_VERSION;
+    header.flags = args->index_seq ? REF_INDEX_HAS_SEQ : 0;
+    header.fasta_checksum = ref_index_checksum(args);
+    header.lcp_level = args->lcp_level;
+    header.skip_masked = args->skip_masked;
+    header.no_overlap = args->no_overlap;
+    header.core_id_index = args->core_id_index;
+    header.chrom_count = seqs->size;
+    header.chrom_table_offset = align8(sizeof(header));
+
+    // compute layout: header, chromosome table, names, core tables and sequences
+    struct ref_index_chrom *table = (struct ref_index_chrom *)calloc(seqs->size, sizeof(struct ref_index_chrom));
+    if (table == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to index chromosome table.\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t offset = header.chrom_table_offset + seqs->size * sizeof(struct ref_index_chrom);
+
+    for (int i=0; i<seqs->size; i++) {
+        table[i].name_offset = offset;
+        table[i].name_len = strlen(seqs->chrs[i].seq_name);
+        table[i].global_index = seqs->chrs[i].global_index;
+        table[i].seq_size = seqs->chrs[i].seq_size;
+        table[i].cores_size = (uint64_t)seqs->chrs[i].cores_size;
+        table[i].id_base = seqs->chrs[i].table.id_base;
+        table[i].block_shift = (uint64_t)seqs->chrs[i].table.block_shift;
+        offset += table[i].name_len;
+    }
+    for (int i=0; i<seqs->size; i++) {
+        offset = align8(offset);
+        table[i].block_starts_offset = offset;
+        offset += block_count(&(table[i])) * sizeof(uint64_t);
+        offset = align8(offset);
+        table[i].starts_offset = offset;
+        offset += table[i].cores_size * sizeof(uint32_t);
+        offset = align8(offset);
+        table[i].ends_offset = offset;
+        offset += table[i].cores_size * sizeof(uint32_t);
+    }
+    if (args->index_seq) {
+        for (int i=0; i<seqs->size; i++) {
+            offset = align8(offset);
+            table[i].seq_offset = offset;
+            offset += table[i].seq_size + 1; // with null terminator
+        }
+    }
+
+    // write sections in the order of their offsets
+    static const char padding[8] = {0};
+    uint64_t written = 0;
+
+    written += fwrite(&header, 1, sizeof(header), out);
+    written += fwrite(padding, 1, header.chrom_table_offset - written, out);
+    written += fwrite(table, sizeof(struct ref_index_chrom), seqs->size, out) * sizeof(struct ref_index_chrom);
+    for (int i=0; i<seqs->size; i++) {
+        written += fwrite(seqs->chrs[i].seq_name, 1, table[i].name_len, out);
+    }
+    for (int i=0; i<seqs->size; i++) {
+        const struct core_table *cores = &(seqs->chrs[i].table);
+        written += fwrite(padding, 1, table[i].block_starts_offset - written, out);
+        written += fwrite(cores->block_starts, sizeof(uint64_t), block_count(&(table[i])), out) * sizeof(uint64_t);
+        written += fwrite(padding, 1, table[i].starts_offset - written, out);
+        written += fwrite(cores->starts, sizeof(uint32_t), table[i].cores_size, out) * sizeof(uint32_t);
+        written += fwrite(padding, 1, table[i].ends_offset - written, out);
+        written += fwrite(cores->ends, sizeof(uint32_t), table[i].cores_size, out) * sizeof(uint32_t);
+    }
+    if (args->index_seq) {
+        for (int i=0; i<seqs->size; i++) {
+            written += fwrite(padding, 1, table[i].seq_offset - written, out);
+            written += fwrite(seqs->chrs[i].seq, 1, table[i].seq_size + 1, out);
+        }
+    }
+
+    if (written != offset || fclose(out) != 0) {
+        fprintf(stderr, "[ERROR] Couldn't write index file %s\n", tmp_path);
+        remove(tmp_path);
+        exit(EXIT_FAILURE);
+    }
+    if (rename(tmp_path, args->save_index_path) != 0) {
+        fprintf(stderr, "[ERROR] Couldn't rename %s to %s\n", tmp_path, args->save_index_path);
+        remove(tmp_path);
+        exit(EXIT_FAILURE);
+    }
+
+    free(tmp_path);
+    free(table);
+
+    stats_add_written(written);
+    stats_add_time(STATS_INDEX_SAVE, stats_now() - start);
+
+    printf("[INFO] Reference index saved to %s\n", args->save_index_path);
+}
+
+int load_ref_index(struct opt_arg *args, struct ref_seq *seqs) {
+
+    uint64_t main_start = stats_now();
+
+    int fd = open(args->load_index_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "[WARN] Couldn't open index file %s, processing reference.\n", args->load_index_path);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (uint64_t)st.st_size < sizeof(struct ref_index_header)) {
+        fprintf(stderr, "[WARN] Invalid index file %s, processing reference.\n", args->load_index_path);
+        close(fd);
+        return 0;
+    }
+
+    // private mapping, sections are used in place and never written back to the file
+    uint64_t map_size = (uint64_t)st.st_size;
+    char *map = (char *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[WARN] Couldn't map index file %s, processing reference.\n", args->load_index_path);
+        return 0;
+    }
+
+    const struct ref_index_header *header = (const struct ref_index_header *)map;
+    const char *reason = NULL;
+
+    if (memcmp(header->magic, REF_INDEX_MAGIC, sizeof(header->magic)) != 0) {
+        reason = "not an lcpan index";
+    } else if (header->version != REF_INDEX_VERSION) {
+        reason = "unsupported version";
+    } else if (header->lcp_level != args->lcp_level || header->skip_masked != args->skip_masked || header->no_overlap != args->no_overlap) {
+        reason = "built with other parameters";
+    } else if (header->fasta_checksum != ref_index_checksum(args)) {
+        reason = "built from another reference";
+    } else if (header->chrom_table_offset + header->chrom_count * sizeof(struct ref_index_chrom) > map_size) {
+        reason = "truncated";
+    }
+
+    if (reason != NULL) {
+        fprintf(stderr, "[WARN] Index file %s is %s, processing reference.\n", args->load_index_path, reason);
+        munmap(map, map_size);
+        return 0;
+    }
+
+    read_fai(args, seqs);
+
+    const struct ref_index_chrom *table = (const struct ref_index_chrom *)(map + header->chrom_table_offset);
+    int has_seq = (header->flags & REF_INDEX_HAS_SEQ) != 0;
+
+    if ((uint64_t)seqs->size != header->chrom_count) {
+        reason = "truncated";
+    }
+    for (int i=0; reason == NULL && i<seqs->size; i++) {
+        if (CORE_TABLE_MAX_SHIFT < table[i].block_shift ||
+            table[i].block_starts_offset + block_count(&(table[i])) * sizeof(uint64_t) > map_size ||
+            table[i].starts_offset + table[i].cores_size * sizeof(uint32_t) > map_size ||
+            table[i].ends_offset + table[i].cores_size * sizeof(uint32_t) > map_size ||
+            (has_seq && table[i].seq_offset + table[i].seq_size + 1 > map_size) ||
+            table[i].seq_size != seqs->chrs[i].seq_size ||
+            table[i].name_len != strlen(seqs->chrs[i].seq_name) ||
+            table[i].name_offset + table[i].name_len > map_size ||
+            memcmp(map + table[i].name_offset, seqs->chrs[i].seq_name, table[i].name_len) != 0) {
+            reason = "truncated";
+        }
+    }
+
+    if (reason != NULL) {
+        fprintf(stderr, "[WARN] Index file %s is %s, processing reference.\n", args->load_index_path, reason);
+        free_ref_seq(seqs);
+        munmap(map, map_size);
+        return 0;
+    }
+
+    seqs->map = map;
+    seqs->map_size = map_size;
+
+    for (int i=0; i<seqs->size; i++) {
+        struct chr *chrom = &(seqs->chrs[i]);
+        chrom->cores_size = (int)table[i].cores_size;
+        if (table[i].cores_size) {
+            chrom->table.id_base = table[i].id_base;
+            chrom->table.block_shift = (int)table[i].block_shift;
+            chrom->table.block_starts = (uint64_t *)(map + table[i].block_starts_offset);
+            chrom->table.starts = (uint32_t *)(map + table[i].starts_offset);
+            chrom->table.ends = (uint32_t *)(map + table[i].ends_offset);
+        }
+        if (has_seq) {
+            free(chrom->seq);
+            chrom->seq = map + table[i].seq_offset;
+        }
+    }
+
+    stats_add_read(map_size);
+
+    if (!has_seq) {
+        uint64_t fasta_start = stats_now();
+        if (!load_fasta_mmap(args, seqs)) {
+            load_fasta_stream(args, seqs);
+        }
+        stats_add_time(STATS_FASTA_READ, stats_now() - fasta_start);
+    }
+
+    args->core_id_index = header->core_id_index;
+
+    uint64_t main_end = stats_now();
+    stats_add_time(STATS_INDEX_LOAD, main_end - main_start);
+
+    printf("[INFO] Reference index loaded in %0.2f sec.\n", (main_end - main_start) / 1e9);
+
+    return 1;
+}
@@ -0,0 +1,93 @@
+#ifndef __REF_INDEX_H__
+#define __REF_INDEX_H__
+
+#include "struct_def.h"
+#include "fa_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define REF_INDEX_MAGIC "LCPANIDX"
+#define REF_INDEX_VERSION 3
+
+#define REF_INDEX_HAS_SEQ 0x1
+
+/**
+ * Header of the index file. All offsets are in bytes from the beginning of
+ * the file and aligned to 8 bytes so that sections can be used in place
+ * after mapping the file.
+ */
+struct ref_index_header {
+    char magic[8];                /** REF_INDEX_MAGIC. */
+    uint32_t version;             /** REF_INDEX_VERSION. */
+    uint32_t flags;               /** REF_INDEX_HAS_SEQ if sequences are stored. */
+    uint64_t fasta_checksum;      /** Checksum of the FASTA the index is built from. */
+    int32_t lcp_level;            /** The LCP level used. */
+    int32_t skip_masked;          /** Boolean argument used to skip masked chars. */
+    int32_t no_overlap;           /** Boolean argument used to refine cores. */
+    int32_t reserved;             /** Padding. */
+    uint64_t core_id_index;       /** Next free id after the reference cores. */
+    uint64_t chrom_count;         /** Number of chromosomes. */
+    uint64_t chrom_table_offset;  /** Offset of `struct ref_index_chrom` array. */
+};
+
+struct ref_index_chrom {
+    uint64_t name_offset;   /** Offset of the chromosome name (not null terminated). */
+    uint64_t name_len;      /** Length of the chromosome name. */
+    uint64_t global_index;  /** Global start index of the chromosome. */
+    uint64_t seq_size;      /** Chromosome size. */
+    uint64_t cores_size;    /** Number of LCP cores. */
+    uint64_t id_base;       /** Id of the first core. */
+    uint64_t block_shift;   /** Log2 of the number of cores in a block. */
+    uint64_t block_starts_offset; /** Offset of the `uint64_t` block starts of the core table. */
+    uint64_t starts_offset; /** Offset of the `uint32_t` core starts. */
+    uint64_t ends_offset;   /** Offset of the `uint32_t` core ends. */
+    uint64_t seq_offset;    /** Offset of the sequence, 0 if not stored. */
+};
+
+/**
+ * @brief Computes the checksum that identifies the FASTA file of an index.
+ *
+ * The checksum covers the content of the fai file (names, sizes and layout of
+ * all chromosomes) and the size and modification time of the FASTA file, so
+ * it is computed without reading the reference and an index is not used for
+ * a reference that is masked or edited in place.
+ *
+ * @param args A pointer to the `opt_arg` structure containing FASTA paths.
+ * @return The checksum.
+ */
+uint64_t ref_index_checksum(const struct opt_arg *args);
+
+/**
+ * @brief Writes chromosome names, core tables and optionally sequences to an index file.
+ *
+ * The index is written to `<path>.tmp` and renamed to the index path, so an
+ * index that is mapped by `seqs` can be replaced safely.
+ *
+ * @param args A pointer to the `opt_arg` structure containing index path and
+ *             the parameters the cores are computed with.
+ * @param seqs A pointer to the processed (refined and compacted) reference sequences.
+ */
+void save_ref_index(const struct opt_arg *args, const struct ref_seq *seqs);
+
+/**
+ * @brief Maps an index file and initializes reference sequences from it.
+ *
+ * Core tables (and sequences if stored) are used directly from the mapped file.
+ * Sequences that are not in the index are read from the FASTA file. If the
+ * index does not match the FASTA or the parameters (LCP level, skip masked,
+ * no overlap), nothing is loaded.
+ *
+ * @param args A pointer to the `opt_arg` structure. `core_id_index` is set to
+ *             the next free id after the reference cores.
+ * @param seqs A pointer to the `ref_seq` structure to be initialized.
+ * @return 1 if the index is loaded, 0 otherwise.
+ */
+int load_ref_index(struct opt_arg *args, struct ref_seq *seqs);
+
+#endif
@@ -0,0 +1,209 @@
+#include "seq_pack.h"
+
+#define SEQ_RUN_MAX_LEN 0xFFFFFFFFu
+
+static const char seq_pack_bases[4] = {'A', 'C', 'G', 'T'};
+
+/** Decoded bases of every code byte, built once. */
+static char seq_unpack_table[256][4];
+static pthread_once_t seq_unpack_once = PTHREAD_ONCE_INIT;
+
+static void init_unpack_table(void) {
+    for (int b=0; b<256; b++) {
+        for (int k=0; k<4; k++) {
+            seq_unpack_table[b][k] = seq_pack_bases[(b >> (2 * k)) & 3];
+        }
+    }
+}
+
+static inline int pack_code(unsigned char c) {
+    switch (c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return -1;
+    }
+}
+
+static void add_run(struct seq_run **runs, int *size, int *capacity, uint64_t index, char base) {
+    if (*size) {
+        struct seq_run *last = &((*runs)[*size - 1]);
+        if (last->base == base && last->start + last->len == index && last->len < SEQ_RUN_MAX_LEN) {
+            last->len++;
+            return;
+        }
+    }
+
+    if (*size == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        struct seq_run *temp = (struct seq_run *)realloc(*runs, (uint64_t)*capacity * sizeof(struct seq_run));
+        if (temp == NULL) {
+            fprintf(stderr, "REF: Memory reallocation failed for packed sequence.\n");
+            exit(EXIT_FAILURE);
+        }
+        *runs = temp;
+    }
+
+    (*runs)[(*size)++] = (struct seq_run){index, 1, base};
+}
+
+static void shrink_runs(struct seq_run **runs, int size) {
+    if (size == 0) {
+        free(*runs);
+        *runs = NULL;
+        return;
+    }
+    struct seq_run *temp = (struct seq_run *)realloc(*runs, (uint64_t)size * sizeof(struct seq_run));
+    if (temp != NULL) {
+        *runs = temp;
+    }
+}
+
+void pack_chr(struct chr *chrom) {
+    struct packed_seq *packed = &(chrom->packed);
+    const unsigned char *seq = (const unsigned char *)chrom->seq;
+    uint64_t size = chrom->seq_size;
+
+    packed->codes = (uint8_t *)calloc(size / 4 + 1, sizeof(uint8_t));
+    if (packed->codes == NULL) {
+        fprintf(stderr, "REF: Couldn't allocate memory to packed sequence.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int base_capacity = 0, mask_capacity = 0;
+    packed->base_runs = NULL;
+    packed->base_run_size = 0;
+    packed->mask_runs = NULL;
+    packed->mask_run_size = 0;
+
+    for (uint64_t i=0; i<size; i++) {
+        unsigned char c = seq[i];
+        int code = pack_code(c);
+        if (0 <= code) {
+            packed->codes[i >> 2] |= (uint8_t)(code << ((i & 3) * 2));
+        } else {
+            char base = ('a' <= c && c <= 'z') ? (char)(c - 'a' + 'A') : (char)c;
+            add_run(&(packed->base_runs), &(packed->base_run_size), &base_capacity, i, base);
+        }
+        if ('a' <= c && c <= 'z') {
+            add_run(&(packed->mask_runs), &(packed->mask_run_size), &mask_capacity, i, 0);
+        }
+    }
+
+    shrink_runs(&(packed->base_runs), packed->base_run_size);
+    shrink_runs(&(packed->mask_runs), packed->mask_run_size);
+}
+
+/**
+ * Index of the first run that ends after `index`.
+ */
+static int first_run_after(const struct seq_run *runs, int size, uint64_t index) {
+    int low = 0, high = size;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (runs[mid].start + runs[mid].len <= index) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void unpack_seq(const struct packed_seq *packed, uint64_t start, uint64_t len, char *dst) {
+    pthread_once(&seq_unpack_once, init_unpack_table);
+
+    const uint8_t *codes = packed->codes;
+    uint64_t end = start + len;
+    uint64_t i = start;
+    char *out = dst;
+
+    // unaligned head, whole code bytes, tail
+    for (; i < end && (i & 3); i++) {
+        *out++ = seq_pack_bases[(codes[i >> 2] >> ((i & 3) * 2)) & 3];
+    }
+    for (; i + 4 <= end; i += 4, out += 4) {
+        memcpy(out, seq_unpack_table[codes[i >> 2]], 4);
+    }
+    for (; i < end; i++) {
+        *out++ = seq_pack_bases[(codes[i >> 2] >> ((i & 3) * 2)) & 3];
+    }
+
+    for (int r=first_run_after(packed->base_runs, packed->base_run_size, start); r<packed->base_run_size; r++) {
+        const struct seq_run *run = &(packed->base_runs[r]);
+        if (end <= run->start) break;
+        uint64_t s = run->start < start ? start : run->start;
+        uint64_t e = run->start + run->len < end ? run->start + run->len : end;
+        memset(dst + (s - start), run->base, e - s);
+    }
+
+    for (int r=first_run_after(packed->mask_runs, packed->mask_run_size, start); r<packed->mask_run_size; r++) {
+        const struct seq_run *run = &(packed->mask_runs[r]);
+        if (end <= run->start) break;
+        uint64_t s = run->start < start ? start : run->start;
+        uint64_t e = run->start + run->len < end ? run->start + run->len : end;
+        for (uint64_t k=s-start; k<e-start; k++) {
+            dst[k] |= 0x20; // lower-case
+        }
+    }
+}
+
+const char *chr_seq_slice(const struct chr *chrom, uint64_t start, uint64_t len, char **buf, uint64_t *capacity) {
+    if (chrom->packed.codes == NULL) {
+        return chrom->seq + start;
+    }
+
+    if (*capacity < len) {
+        uint64_t new_capacity = *capacity ? *capacity : 256;
+        while (new_capacity < len) new_capacity *= 2;
+        char *temp = (char *)realloc(*buf, new_capacity);
+        if (temp == NULL) {
+            fprintf(stderr, "REF: Memory reallocation failed for sequence slice.\n");
+            exit(EXIT_FAILURE);
+        }
+        *buf = temp;
+        *capacity = new_capacity;
+    }
+
+    unpack_seq(&(chrom->packed), start, len, *buf);
+    return *buf;
+}
+
+void free_packed_seq(struct packed_seq *packed) {
+    free(packed->codes);
+    free(packed->base_runs);
+    free(packed->mask_runs);
+    memset(packed, 0, sizeof(struct packed_seq));
+}
+
+uint64_t packed_seq_bytes(const struct packed_seq *packed, uint64_t seq_size) {
+    if (packed->codes == NULL) {
+        return 0;
+    }
+    return seq_size / 4 + 1 + ((uint64_t)packed->base_run_size + packed->mask_run_size) * sizeof(struct seq_run);
+}
+
+void pack_ref_seqs(struct ref_seq *seqs, int verbose) {
+    uint64_t before = 0, after = 0;
+
+    for (int i=0; i<seqs->size; i++) {
+        struct chr *chrom = &(seqs->chrs[i]);
+        if (chrom->seq == NULL || chrom->packed.codes != NULL) {
+            continue;
+        }
+
+        pack_chr(chrom);
+
+        int in_map = seqs->map != NULL && seqs->map <= chrom->seq && chrom->seq < seqs->map + seqs->map_size;
+        if (!in_map) {
+            free(chrom->seq);
+        }
+        chrom->seq = NULL;
+
+        before += chrom->seq_size + 1;
+        after += packed_seq_bytes(&(chrom->packed), chrom->seq_size);
+    }
+
+    (void)(verbose && printf("[INFO] Reference packed from %.2f MB to %.2f MB.\n", before / 1048576.0, after / 1048576.0));
+}
@@ -0,0 +1,61 @@
+/**
+ * @file seq_pack.h
+ * @brief 2-bit packed storage of the reference sequences.
+ *
+ * After the LCP cores are found, the reference is only needed to print
+ * segments. A packed chromosome keeps A/C/G/T as 2-bit codes, the runs of
+ * other bases (N and IUPAC codes) and the runs of soft-masked (lower-case)
+ * bases in sorted side tables. Slices are decoded on demand, byte for byte
+ * equal to the original sequence.
+ */
+
+#ifndef __SEQ_PACK_H__
+#define __SEQ_PACK_H__
+
+#include "struct_def.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * @brief Packs every chromosome of `seqs` and releases the unpacked sequences.
+ *
+ * Sequences that point into a mapped index are not freed, only dropped.
+ *
+ * @param seqs    The reference sequences.
+ * @param verbose Prints the memory used before and after packing if set.
+ */
+void pack_ref_seqs(struct ref_seq *seqs, int verbose);
+
+/**
+ * @brief Packs the sequence of a chromosome into `chrom->packed`.
+ *
+ * `chrom->seq` is left untouched.
+ */
+void pack_chr(struct chr *chrom);
+
+/**
+ * @brief Decodes `len` bases starting from `start` into `dst` (not null terminated).
+ */
+void unpack_seq(const struct packed_seq *packed, uint64_t start, uint64_t len, char *dst);
+
+/**
+ * @brief Returns `len` bases of the chromosome starting from `start`.
+ *
+ * Points into the sequence itself if the chromosome is not packed, otherwise
+ * decodes into `*buf`, which is grown as needed and owned by the caller.
+ */
+const char *chr_seq_slice(const struct chr *chrom, uint64_t start, uint64_t len, char **buf, uint64_t *capacity);
+
+/**
+ * @brief Frees the packed sequence, if any.
+ */
+void free_packed_seq(struct packed_seq *packed);
+
+/**
+ * @brief Number of bytes used by the packed sequence.
+ */
+uint64_t packed_seq_bytes(const struct packed_seq *packed, uint64_t seq_size);
+
+#endif
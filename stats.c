@@ -0,0 +1,169 @@
+#include "stats.h"
+
+static const char *stage_names[STATS_STAGE_COUNT] = {
+    "fai_parse",
+    "fasta_read",
+    "lcp_deepening",
+    "refine",
+    "index_load",
+    "index_save",
+    "pack",
+    "ref_print",
+    "vcf_read",
+    "queue_wait",
+    "emit",
+    "path_print"
+};
+
+static struct {
+    _Atomic uint64_t stages[STATS_STAGE_COUNT];
+    _Atomic uint64_t bytes_read;
+    _Atomic uint64_t bytes_written;
+    _Atomic uint64_t queue_high_water;
+    _Atomic uint64_t sv_cache_hits;
+    _Atomic uint64_t sv_cache_misses;
+    _Atomic uint64_t sv_cache_evictions;
+    _Atomic uint64_t sv_cache_bytes;
+    _Atomic uint64_t dedup_merged;
+    _Atomic uint64_t paths;
+    _Atomic uint64_t path_steps;
+    _Atomic uint64_t path_bytes;
+    pthread_mutex_t threads_mutex;
+    struct stats_thread *threads;
+    int threads_size;
+    int threads_capacity;
+} stats = {
+    .threads_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+void stats_add_time(stats_stage_t stage, uint64_t ns) {
+    atomic_fetch_add_explicit(&(stats.stages[stage]), ns, memory_order_relaxed);
+}
+
+uint64_t stats_get_time(stats_stage_t stage) {
+    return atomic_load_explicit(&(stats.stages[stage]), memory_order_relaxed);
+}
+
+void stats_add_read(uint64_t bytes) {
+    atomic_fetch_add_explicit(&stats.bytes_read, bytes, memory_order_relaxed);
+}
+
+void stats_add_written(uint64_t bytes) {
+    atomic_fetch_add_explicit(&stats.bytes_written, bytes, memory_order_relaxed);
+}
+
+void stats_queue_size(uint64_t size) {
+    uint64_t high = atomic_load_explicit(&stats.queue_high_water, memory_order_relaxed);
+    while (high < size && !atomic_compare_exchange_weak_explicit(&stats.queue_high_water, &high, size, memory_order_relaxed, memory_order_relaxed));
+}
+
+void stats_add_sv_cache(uint64_t hits, uint64_t misses, uint64_t evictions, uint64_t bytes) {
+    atomic_fetch_add_explicit(&stats.sv_cache_hits, hits, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.sv_cache_misses, misses, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.sv_cache_evictions, evictions, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.sv_cache_bytes, bytes, memory_order_relaxed);
+}
+
+void stats_add_dedup(uint64_t merged) {
+    atomic_fetch_add_explicit(&stats.dedup_merged, merged, memory_order_relaxed);
+}
+
+uint64_t stats_get_dedup(void) {
+    return atomic_load_explicit(&stats.dedup_merged, memory_order_relaxed);
+}
+
+void stats_add_path(uint64_t steps, uint64_t bytes) {
+    atomic_fetch_add_explicit(&stats.paths, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.path_steps, steps, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.path_bytes, bytes, memory_order_relaxed);
+}
+
+void stats_add_thread(const char *role, int id, uint64_t busy_ns, uint64_t idle_ns) {
+    pthread_mutex_lock(&stats.threads_mutex);
+    if (stats.threads_size == stats.threads_capacity) {
+        int capacity = stats.threads_capacity ? 2 * stats.threads_capacity : 16;
+        struct stats_thread *threads = (struct stats_thread *)realloc(stats.threads, capacity * sizeof(struct stats_thread));
+        if (threads == NULL) {
+            pthread_mutex_unlock(&stats.threads_mutex);
+            return;
+        }
+        stats.threads = threads;
+        stats.threads_capacity = capacity;
+    }
+    stats.threads[stats.threads_size++] = (struct stats_thread){role, id, busy_ns, idle_ns};
+    pthread_mutex_unlock(&stats.threads_mutex);
+}
+
+/**
+ * Peak resident set size of the process in kilobytes.
+ */
+static uint64_t peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return (uint64_t)usage.ru_maxrss;
+#endif
+}
+
+int stats_write_json(const char *path, const char *program, int threads, int lcp_level, uint64_t wall_ns) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        return 0;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"program\": \"%s\",\n", program);
+    fprintf(out, "  \"threads\": %d,\n", threads);
+    fprintf(out, "  \"lcp_level\": %d,\n", lcp_level);
+    fprintf(out, "  \"wall_ns\": %lu,\n", wall_ns);
+
+    fprintf(out, "  \"stages_ns\": {\n");
+    for (int i=0; i<STATS_STAGE_COUNT; i++) {
+        fprintf(out, "    \"%s\": %lu%s\n", stage_names[i], stats_get_time((stats_stage_t)i), i+1 < STATS_STAGE_COUNT ? "," : "");
+    }
+    fprintf(out, "  },\n");
+
+    fprintf(out, "  \"bytes_read\": %lu,\n", atomic_load_explicit(&stats.bytes_read, memory_order_relaxed));
+    fprintf(out, "  \"bytes_written\": %lu,\n", atomic_load_explicit(&stats.bytes_written, memory_order_relaxed));
+    fprintf(out, "  \"queue_high_water\": %lu,\n", atomic_load_explicit(&stats.queue_high_water, memory_order_relaxed));
+
+    uint64_t sv_hits = atomic_load_explicit(&stats.sv_cache_hits, memory_order_relaxed);
+    uint64_t sv_misses = atomic_load_explicit(&stats.sv_cache_misses, memory_order_relaxed);
+    fprintf(out, "  \"sv_cache\": {\"hits\": %lu, \"misses\": %lu, \"hit_rate\": %.4f, \"evictions\": %lu, \"bytes\": %lu},\n",
+            sv_hits, sv_misses, sv_hits + sv_misses ? (double)sv_hits / (sv_hits + sv_misses) : 0.0,
+            atomic_load_explicit(&stats.sv_cache_evictions, memory_order_relaxed),
+            atomic_load_explicit(&stats.sv_cache_bytes, memory_order_relaxed));
+    fprintf(out, "  \"dedup_merged\": %lu,\n", stats_get_dedup());
+    fprintf(out, "  \"paths\": {\"count\": %lu, \"steps\": %lu, \"bytes\": %lu},\n",
+            atomic_load_explicit(&stats.paths, memory_order_relaxed),
+            atomic_load_explicit(&stats.path_steps, memory_order_relaxed),
+            atomic_load_explicit(&stats.path_bytes, memory_order_relaxed));
+    fprintf(out, "  \"peak_rss_kb\": %lu,\n", peak_rss_kb());
+
+    pthread_mutex_lock(&stats.threads_mutex);
+    fprintf(out, "  \"thread_times\": [");
+    for (int i=0; i<stats.threads_size; i++) {
+        const struct stats_thread *thread = &(stats.threads[i]);
+        fprintf(out, "%s\n    {\"role\": \"%s\", \"id\": %d, \"busy_ns\": %lu, \"idle_ns\": %lu}", i ? "," : "",
+                thread->role, thread->id, thread->busy_ns, thread->idle_ns);
+    }
+    fprintf(out, "%s]\n", stats.threads_size ? "\n  " : "");
+    pthread_mutex_unlock(&stats.threads_mutex);
+
+    fprintf(out, "}\n");
+
+    return fclose(out) == 0;
+}
+
+void stats_free(void) {
+    pthread_mutex_lock(&stats.threads_mutex);
+    free(stats.threads);
+    stats.threads = NULL;
+    stats.threads_size = 0;
+    stats.threads_capacity = 0;
+    pthread_mutex_unlock(&stats.threads_mutex);
+}
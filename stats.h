@@ -0,0 +1,130 @@
+/**
+ * @file stats.h
+ * @brief Timings and counters of a run, reported with `--stats-json`.
+ *
+ * Stages are timed with the monotonic clock in nanoseconds. Stages that run
+ * on several threads at once (queue wait and emit) are the sums over the
+ * threads. Counters are updated with relaxed atomics and are cheap enough to
+ * be collected in every run; the report is written only if it is requested.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+
+typedef enum {
+    STATS_FAI_PARSE,     /** Reading the FASTA index. */
+    STATS_FASTA_READ,    /** Loading the sequences. */
+    STATS_LCP_DEEPENING, /** Finding the LCP cores of the reference. */
+    STATS_REFINE,        /** Refining and compacting the cores. */
+    STATS_INDEX_LOAD,    /** Loading the reference index, its FASTA index and sequences included. */
+    STATS_INDEX_SAVE,    /** Saving the reference index. */
+    STATS_PACK,          /** Packing the sequences. */
+    STATS_REF_PRINT,     /** Printing the reference graph (-vgx). */
+    STATS_VCF_READ,      /** Reading and processing the VCF until all workers finish. */
+    STATS_QUEUE_WAIT,    /** Time threads are blocked on the work queue, summed over threads. */
+    STATS_EMIT,          /** Time spent writing output buffers to the file, summed over threads. */
+    STATS_PATH_PRINT,    /** Building and printing the paths. */
+    STATS_STAGE_COUNT
+} stats_stage_t;
+
+struct stats_thread {
+    const char *role; /** Role of the thread, e.g. "worker". */
+    int id;           /** Id of the thread within its role. */
+    uint64_t busy_ns; /** Time spent working. */
+    uint64_t idle_ns; /** Time spent waiting for the queue. */
+};
+
+/**
+ * @brief Current time of the monotonic clock in nanoseconds.
+ */
+static inline uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Adds `ns` nanoseconds to the stage.
+ */
+void stats_add_time(stats_stage_t stage, uint64_t ns);
+
+/**
+ * @brief Total time of the stage in nanoseconds.
+ */
+uint64_t stats_get_time(stats_stage_t stage);
+
+/**
+ * @brief Counts bytes read from the input files.
+ */
+void stats_add_read(uint64_t bytes);
+
+/**
+ * @brief Counts bytes written to the output files.
+ */
+void stats_add_written(uint64_t bytes);
+
+/**
+ * @brief Records the number of items in the work queue, keeps the maximum.
+ */
+void stats_queue_size(uint64_t size);
+
+/**
+ * @brief Adds the counters of an SV allele cache (see sv_cache.h).
+ *
+ * @param hits      Alleles whose cores were found in the cache.
+ * @param misses    Alleles that were parsed.
+ * @param evictions Entries dropped to stay within the memory budget.
+ * @param bytes     Bytes held by the cache at the end.
+ */
+void stats_add_sv_cache(uint64_t hits, uint64_t misses, uint64_t evictions, uint64_t bytes);
+
+/**
+ * @brief Counts alleles skipped as duplicates (`--dedup`).
+ */
+void stats_add_dedup(uint64_t merged);
+
+/**
+ * @brief Number of alleles skipped as duplicates.
+ */
+uint64_t stats_get_dedup(void);
+
+/**
+ * @brief Counts a printed path (P line).
+ *
+ * @param steps Number of segments the path goes through.
+ * @param bytes Length of the P line.
+ */
+void stats_add_path(uint64_t steps, uint64_t bytes);
+
+/**
+ * @brief Records busy and idle time of a finished thread.
+ */
+void stats_add_thread(const char *role, int id, uint64_t busy_ns, uint64_t idle_ns);
+
+/**
+ * @brief Writes the report as a JSON object.
+ *
+ * @param path      Path to the report.
+ * @param program   Name of the program mode.
+ * @param threads   Number of threads given to the run.
+ * @param lcp_level LCP level of the run.
+ * @param wall_ns   Duration of the whole run.
+ * @return 1 on success, 0 if the file couldn't be written.
+ */
+int stats_write_json(const char *path, const char *program, int threads, int lcp_level, uint64_t wall_ns);
+
+/**
+ * @brief Frees the recorded threads.
+ */
+void stats_free(void);
+
+#endif
@@ -4,9 +4,16 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <pthread.h>
+#include "mpmc.h"
+#include "gfa_out.h"
+#include "sv_cache.h"
+#include "dedup.h"
 
 #define THREAD_POOL_FACTOR 2
 #define VG_BUCKET_BATCH 1024
+#define VG_BATCH_ELEMENTS 4096
+#define VG_BATCH_CORES 65536
+#define VGX_CHUNK_SIZE 4194304
 
 typedef enum {
     VG,
@@ -19,6 +26,9 @@ struct opt_arg {
 	char *fasta_fai_path;	/** Path to the input FASTA  index file. */
 	char *vcf_path;			/** Path to the input VCF file. */
 	char *gfa_path; 		/** Path to the output rGFA/GFA file. */
+	char *save_index_path;	/** Path to the reference index file to be saved. */
+	char *load_index_path;	/** Path to the reference index file to be loaded. */
+	char *stats_json_path;	/** Path to the run report, NULL if not requested. */
     char *prefix;           /** Prefix to the files */
     program_mode program;   /** Program mode. */
 	uint64_t core_id_index; /** Global id index for LCP cores. */
@@ -31,6 +41,11 @@ struct opt_arg {
     int no_overlap;         /** Boolean argument to decide whether allow overlap. */
     int skip_masked;        /** Boolean argument to decide whether include invalid chars (N) to the output. */
     int tload_factor;       /** Thread pool element storage capacity factor to the tread number. */
+    int index_seq;          /** Boolean argument to decide whether sequences are stored in the index. */
+    int pack_seq;           /** Boolean argument to decide whether sequences are kept 2-bit packed. */
+    uint64_t sv_cache_mb;   /** Memory budget of the SV allele cache in MB, 0 disables it. */
+    int dedup;              /** Boolean argument to decide whether identical alleles at the same locus are merged. */
+    int stream_paths;       /** Boolean argument to decide whether paths are printed and chromosomes freed as soon as they are done (-vg). */
     int verbose;            /** Verbose. */
 };
 
@@ -40,27 +55,75 @@ struct simple_core {
 	uint64_t end;   /** End index of core. */
 };
 
+struct core_table {
+    uint64_t id_base;       /** Id of the first core, the ids of the cores are consecutive. */
+    int block_shift;        /** Log2 of the number of cores in a block. */
+    uint64_t *block_starts; /** Start index of the first core of every block. */
+    uint32_t *starts;       /** Start index of every core relative to its block. */
+    uint32_t *ends;         /** End index of every core relative to its block. */
+};
+
+struct path_id_chunk {
+    uint64_t *data;         /** Records of `core index, id count, ids...` appended by a worker. */
+    uint64_t size;
+    uint64_t capacity;
+};
+
+struct path_ids {
+    struct path_id_chunk *chunks; /** One chunk per worker, NULL once stitched. */
+    int chunk_count;
+    uint32_t *offsets;      /** Sub-segment ids of core j are ids[offsets[j]..offsets[j+1]), NULL if no core is split. */
+    uint64_t *ids;          /** Sub-segment ids of all cores, in core order. */
+};
+
+struct seq_run {
+    uint64_t start; /** Start index of the run. */
+    uint32_t len;   /** Length of the run. */
+    char base;      /** Base repeated in the run (unused for mask runs). */
+};
+
+struct packed_seq {
+    uint8_t *codes;             /** 2-bit base codes (A, C, G, T), 4 bases per byte. */
+    struct seq_run *base_runs;  /** Runs of bases that are not A, C, G or T (mostly N). */
+    int base_run_size;          /** Number of runs in base_runs. */
+    struct seq_run *mask_runs;  /** Runs of soft-masked (lower-case) bases. */
+    int mask_run_size;          /** Number of runs in mask_runs. */
+};
+
 struct chr {
     char *seq_name;            /** Chromosome name */
     uint64_t global_index;     /** Global Start index (cumulative index from previous chrs). */
-    int seq_size;              /** Chromosome size */
-    char *seq;                 /** Chromosome Sequence */
+    uint64_t seq_size;         /** Chromosome size */
+    char *seq;                 /** Chromosome Sequence, NULL once packed. */
+    struct packed_seq packed;  /** Packed sequence (see seq_pack.h), codes is NULL if not packed. */
+    uint64_t fa_offset;        /** Byte offset of the first base in FASTA file (from .fai). */
+    int line_bases;            /** Bases per FASTA line (from .fai), 0 if unknown. */
+    int line_width;            /** Bytes per FASTA line including newline (from .fai), 0 if unknown. */
 	int cores_size;			   /** LCP cores count in cores arrat */
-	struct simple_core *cores; /** LCP (ordered) cores in the chromosome */ 
-    uint64_t **ids;            /** IDs of sub-segments splitted in the segment (needed for vg-path). */
+	struct simple_core *cores; /** LCP (ordered) cores in the chromosome, NULL once compacted. */ 
+    struct core_table table;   /** Compact cores (see core_table.h), starts is NULL if not compacted. */
+    struct path_ids ids;       /** IDs of sub-segments splitted in the cores (see path_ids.h, needed for vg-path). */
+    _Atomic int64_t path_refs; /** Buckets in flight, plus one until the producer leaves the chromosome (-vg --stream). */
 };
 
 struct ref_seq {
 	int size;         /** Number of chromosomes. */
 	struct chr *chrs; /** Array of chromosomes */
+	char *map;        /** Mapped index file that cores/sequences point into, NULL if not loaded from index. */
+	uint64_t map_size;/** Size of the mapped index file. */
+	int *name_table;  /** Open-addressing table of chromosome indices by name, -1 for empty slots. */
+	uint64_t name_table_mask; /** Size of name_table minus one (size is a power of two). */
+};
+
+struct line_chunk {
+    char *data;        /** Complete lines, each terminated by newline. */
+    uint64_t size;     /** Number of bytes used in data. */
+    uint64_t capacity; /** Capacity of data. */
 };
 
 struct line_queue {
-    char **lines; /** Queue to store lines extracted from VCF file for threads. */
-    int size;     /** The size of the queue. */
-    int capacity; /** Capacity of the queue. */
-    int front;    /** The index for the pushing point. */
-    int rear;     /** The index for the popping point. */
+    mpmc_ring_t ring;        /** Queue to store chunks of lines extracted from VCF file for threads. */
+    mpmc_ring_t free_chunks; /** Processed chunks to be refilled by the reader. */
 };
 
 typedef enum {
@@ -93,36 +156,72 @@ typedef struct {
 typedef struct {
     int chr_idx;                  /** Chromosome index. */
     int core_idx;                 /** LCP core index in chromosome. */
+    int span;                     /** Number of cores from core_idx, more than one only for a run of untouched cores. */
     
-    int capacity;                 /** Capacity of variation array. */
+    int capacity;                 /** Space left for the variations in the element slab of the batch. */
     int size;                     /** Size of variation array. */
     
     uint64_t prev_id;             /** previous segment's id. */
     uint64_t curr_id;             /** current segment's id. */
     
-    vg_element_t *items;          /** Pointer to variations array. */
+    vg_element_t *items;          /** Variations of the core, a slice of the element slab of the batch. */
 } vg_core_bucket_t;
 
 typedef struct {
-    vg_core_bucket_t *items[VG_BUCKET_BATCH];
-    int count;
+    vg_core_bucket_t items[VG_BUCKET_BATCH]; /** Buckets of consecutive LCP cores. */
+    int count;                               /** Number of filled buckets. */
+    int core_count;                          /** Number of cores the filled buckets cover. */
+    vg_element_t *elements;                  /** Variations of all buckets, stored back to back in bucket order. */
+    int element_capacity;                    /** Capacity of elements. */
 } vg_bucket_batch_t;
 
 typedef struct {
-    vg_bucket_batch_t **batch;  /** Queue to data of the variations to be processed. */
-    int size;                   /** The size of the queue. */
-    int capacity;               /** Capacity of the queue. */
-    int front;                  /** The index for the pushing point. */
-    int rear;                   /** The index for the popping point. */
+    mpmc_ring_t ring;           /** Queue to data (batches) of the variations to be processed. */
+    mpmc_ring_t free_batches;   /** Processed batches to be refilled by the producers. */
 } vg_work_queue_t;
 
 typedef struct {
-    pthread_mutex_t *mutex;
-    pthread_cond_t  *cond_not_full;
-    pthread_cond_t  *cond_not_empty;
-    int             *exit_signal;
+    eventcount_t *not_full;     /** Waited by producers when the queue is full. */
+    eventcount_t *not_empty;    /** Waited by consumers when the queue is empty. */
+    int          *exit_signal;  /** Set when no more data will be pushed. */
 } vg_queue_sync_t;
 
+typedef struct {
+    uint64_t id;                /** Id of the node that is linked to the core containing `end`. */
+    uint64_t end;               /** End position of the variation. */
+} vg_pending_end_t;
+
+typedef struct {
+    struct ref_seq *seqs;               /** Reference sequences. */
+    vg_work_queue_t *queue;             /** Queue that filled buckets are pushed to. */
+    vg_queue_sync_t *sync;              /** Synchronization of the queue. */
+    gfa_stream_t *out;                  /** Output of variation segments and unvaried chromosomes. */
+    int is_rgfa;                        /** Boolean argument to output rGFA or GFA. */
+    uint64_t core_id_index;             /** Next id to be given to a variation node. */
+    int chr_idx;                        /** Chromosome of the current bucket. */
+    int core_idx;                       /** LCP core of the current bucket. */
+    int chrom_index;                    /** Chromosome of the latest VCF record. */
+    struct chr *curr_chr;               /** Pointer to the chromosome `chr_idx`. */
+    vg_bucket_batch_t *batch;           /** Batch of buckets to be pushed. */
+    vg_core_bucket_t *bucket;           /** Bucket of the current LCP core. */
+    vg_pending_end_t *pending_var_ends; /** Variations ending in later cores, min-heap on end. */
+    int pending_var_ends_size;          /** Size of pending_var_ends. */
+    int pending_var_ends_capacity;      /** Capacity of pending_var_ends. */
+    int line_count;                     /** Number of processed VCF records. */
+    uint64_t wait_ns;                   /** Time blocked on the full queue. */
+    int dedup;                          /** Boolean argument to decide whether duplicate alleles are skipped. */
+    int stream_paths;                   /** Boolean argument to decide whether finished chromosomes are printed and freed. */
+    struct dedup_window dedup_window;   /** Alleles at the position of the latest record. */
+} vg_producer_t;
+
+typedef struct {
+    vg_producer_t producer;     /** State of the producer processing the shard. */
+    const char *vcf_path;       /** Path to the BGZF compressed VCF file. */
+    int chr_idx;                /** Chromosome of the shard. */
+    uint64_t begin;             /** Virtual offset of the first record of the chromosome. */
+    uint64_t end;               /** Virtual offset after the last record of the chromosome. */
+} vg_shard_t;
+
 struct t_arg {
     uint64_t core_id_index;
     int thread_id;
@@ -133,9 +232,19 @@ struct t_arg {
     int failed_var_count;
     int invalid_line_count;
     int bubble_count;
-    double exec_time;
-    FILE *out1;
-    FILE *out2;
+    int line_count;
+    uint64_t busy_ns;
+    uint64_t idle_ns;
+    FILE *out_log;
+    gfa_stream_t *stream;
+    char *ref_buf;
+    uint64_t ref_buf_capacity;
+    struct sv_cache *sv_cache;
+    struct sv_bound *sv_cores;
+    int sv_cores_capacity;
+    int dedup;
+    struct dedup_window dedup_window;
+    int stream_paths;
     void *queue;
     vg_queue_sync_t *sync;
     pthread_mutex_t *out_log_mutex;
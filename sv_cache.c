@@ -0,0 +1,254 @@
+#include "sv_cache.h"
+
+/**
+ * 64-bit hash of the allele, 8 bytes at a time.
+ */
+static inline uint64_t allele_hash(const char *seq, uint64_t len, int lcp_level) {
+    const uint64_t m = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = (len ^ ((uint64_t)lcp_level << 56)) * m;
+    uint64_t i = 0, word;
+    for (; i+8<=len; i+=8) {
+        memcpy(&word, seq+i, 8);
+        h = (h ^ word) * m;
+        h ^= h >> 29;
+    }
+    word = 0;
+    memcpy(&word, seq+i, len-i);
+    h = (h ^ word) * m;
+    // fmix64
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t entry_bytes(uint64_t seq_len, int size) {
+    return sizeof(struct sv_cache_entry) + (uint64_t)size * sizeof(struct sv_bound) + seq_len;
+}
+
+static inline void reserve_cores(struct sv_bound **cores, int *capacity, int size) {
+    if (*capacity < size) {
+        free(*cores);
+        *cores = (struct sv_bound *)malloc(2 * size * sizeof(struct sv_bound));
+        if (*cores == NULL) {
+            fprintf(stderr, "[ERROR] Couldn't allocate memory to SV cores.\n");
+            exit(EXIT_FAILURE);
+        }
+        *capacity = 2 * size;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// shard
+// ---------------------------------------------------------------------------
+
+static void lru_unlink(struct sv_cache_shard *shard, struct sv_cache_entry *entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else shard->lru_first = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else shard->lru_last = entry->lru_prev;
+}
+
+static void lru_push_front(struct sv_cache_shard *shard, struct sv_cache_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_first;
+    if (shard->lru_first) shard->lru_first->lru_prev = entry;
+    else shard->lru_last = entry;
+    shard->lru_first = entry;
+}
+
+static struct sv_cache_entry *shard_find(struct sv_cache_shard *shard, uint64_t hash, const char *seq, uint64_t seq_len, int lcp_level) {
+    struct sv_cache_entry *entry = shard->buckets[hash & shard->bucket_mask];
+    while (entry != NULL) {
+        if (entry->hash == hash && entry->seq_len == seq_len && entry->lcp_level == lcp_level && memcmp(entry->seq, seq, seq_len) == 0) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+static void shard_remove(struct sv_cache_shard *shard, struct sv_cache_entry *entry) {
+    struct sv_cache_entry **slot = &(shard->buckets[entry->hash & shard->bucket_mask]);
+    while (*slot != entry) {
+        slot = &((*slot)->next);
+    }
+    *slot = entry->next;
+    lru_unlink(shard, entry);
+    shard->entry_count--;
+    shard->bytes -= entry_bytes(entry->seq_len, entry->size);
+    free(entry);
+}
+
+/**
+ * Doubles the buckets once there are more entries than buckets. The shard
+ * keeps working with the old buckets if memory allocation fails.
+ */
+static void shard_grow(struct sv_cache_shard *shard) {
+    uint64_t bucket_count = 2 * (shard->bucket_mask + 1);
+    struct sv_cache_entry **buckets = (struct sv_cache_entry **)calloc(bucket_count, sizeof(struct sv_cache_entry *));
+    if (buckets == NULL) {
+        return;
+    }
+    for (uint64_t i=0; i<=shard->bucket_mask; i++) {
+        struct sv_cache_entry *entry = shard->buckets[i];
+        while (entry != NULL) {
+            struct sv_cache_entry *next = entry->next;
+            entry->next = buckets[entry->hash & (bucket_count - 1)];
+            buckets[entry->hash & (bucket_count - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucket_mask = bucket_count - 1;
+}
+
+static void shard_insert(struct sv_cache *cache, struct sv_cache_shard *shard, uint64_t hash, const char *seq, uint64_t seq_len, int lcp_level, const struct sv_bound *cores, int size) {
+    uint64_t bytes = entry_bytes(seq_len, size);
+    if (cache->shard_capacity < bytes || shard_find(shard, hash, seq, seq_len, lcp_level) != NULL) {
+        return; // too large to cache or added by another thread in the meantime
+    }
+
+    while (cache->shard_capacity < shard->bytes + bytes) {
+        shard_remove(shard, shard->lru_last);
+        shard->evictions++;
+    }
+
+    struct sv_cache_entry *entry = (struct sv_cache_entry *)malloc(bytes);
+    if (entry == NULL) {
+        return;
+    }
+    entry->hash = hash;
+    entry->seq_len = seq_len;
+    entry->lcp_level = lcp_level;
+    entry->size = size;
+    entry->cores = (struct sv_bound *)(entry + 1);
+    entry->seq = (char *)(entry->cores + size);
+    if (size) {
+        memcpy(entry->cores, cores, size * sizeof(struct sv_bound));
+    }
+    memcpy(entry->seq, seq, seq_len);
+
+    if (shard->bucket_mask < shard->entry_count) {
+        shard_grow(shard);
+    }
+    struct sv_cache_entry **slot = &(shard->buckets[hash & shard->bucket_mask]);
+    entry->next = *slot;
+    *slot = entry;
+    lru_push_front(shard, entry);
+    shard->entry_count++;
+    shard->bytes += bytes;
+}
+
+// ---------------------------------------------------------------------------
+// cache
+// ---------------------------------------------------------------------------
+
+struct sv_cache *sv_cache_create(uint64_t capacity) {
+    if (capacity < SV_CACHE_SHARDS) {
+        return NULL;
+    }
+    struct sv_cache *cache = (struct sv_cache *)malloc(sizeof(struct sv_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->shard_capacity = capacity / SV_CACHE_SHARDS;
+    for (int i=0; i<SV_CACHE_SHARDS; i++) {
+        struct sv_cache_shard *shard = &(cache->shards[i]);
+        pthread_mutex_init(&(shard->mutex), NULL);
+        shard->buckets = (struct sv_cache_entry **)calloc(SV_CACHE_MIN_BUCKETS, sizeof(struct sv_cache_entry *));
+        shard->bucket_mask = SV_CACHE_MIN_BUCKETS - 1;
+        shard->entry_count = 0;
+        shard->bytes = 0;
+        shard->lru_first = NULL;
+        shard->lru_last = NULL;
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->evictions = 0;
+        if (shard->buckets == NULL) {
+            for (int j=0; j<=i; j++) {
+                free(cache->shards[j].buckets);
+                pthread_mutex_destroy(&(cache->shards[j].mutex));
+            }
+            free(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void sv_cache_destroy(struct sv_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    uint64_t hits = 0, misses = 0, evictions = 0, bytes = 0;
+    for (int i=0; i<SV_CACHE_SHARDS; i++) {
+        struct sv_cache_shard *shard = &(cache->shards[i]);
+        hits += shard->hits;
+        misses += shard->misses;
+        evictions += shard->evictions;
+        bytes += shard->bytes;
+
+        struct sv_cache_entry *entry = shard->lru_first;
+        while (entry != NULL) {
+            struct sv_cache_entry *next = entry->lru_next;
+            free(entry);
+            entry = next;
+        }
+        free(shard->buckets);
+        pthread_mutex_destroy(&(shard->mutex));
+    }
+    free(cache);
+    stats_add_sv_cache(hits, misses, evictions, bytes);
+}
+
+int sv_cache_decompose(struct sv_cache *cache, const char *seq, uint64_t seq_len, int lcp_level, struct sv_bound **cores, int *capacity) {
+
+    uint64_t hash = 0;
+    struct sv_cache_shard *shard = NULL;
+
+    if (cache != NULL) {
+        hash = allele_hash(seq, seq_len, lcp_level);
+        shard = &(cache->shards[hash >> (64 - SV_CACHE_SHARD_BITS)]);
+
+        pthread_mutex_lock(&(shard->mutex));
+        struct sv_cache_entry *entry = shard_find(shard, hash, seq, seq_len, lcp_level);
+        if (entry != NULL) {
+            lru_unlink(shard, entry);
+            lru_push_front(shard, entry);
+            shard->hits++;
+            int size = entry->size;
+            reserve_cores(cores, capacity, size);
+            if (size) {
+                memcpy(*cores, entry->cores, size * sizeof(struct sv_bound));
+            }
+            pthread_mutex_unlock(&(shard->mutex));
+            return size;
+        }
+        shard->misses++;
+        pthread_mutex_unlock(&(shard->mutex));
+    }
+
+    // parse outside of the lock, other threads may parse the same allele meanwhile
+    struct lps substr;
+    init_lps_offset(&substr, seq, seq_len, 0);
+    lps_deepen(&substr, lcp_level);
+
+    int size = substr.size;
+    reserve_cores(cores, capacity, size);
+    for (int i=0; i<size; i++) {
+        (*cores)[i] = (struct sv_bound){substr.cores[i].start, substr.cores[i].end};
+    }
+    free_lps(&substr);
+
+    if (shard != NULL) {
+        pthread_mutex_lock(&(shard->mutex));
+        shard_insert(cache, shard, hash, seq, seq_len, lcp_level, *cores, size);
+        pthread_mutex_unlock(&(shard->mutex));
+    }
+
+    return size;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file sv_cache.h
+ * @brief Shared cache of the LCP decompositions of long ALT alleles.
+ *
+ * Population VCFs carry the same long insertion (e.g. a common Alu or L1
+ * insertion) in many records, and `vg_variate_sv`/`vgx_variate_sv` would parse
+ * it again for every one of them. The cache maps an allele and an LCP level
+ * to the start and end of its cores. It is split into shards, each guarded by
+ * its own mutex and evicting its least recently used entries to stay within
+ * its share of the byte budget. Alleles are compared in full on a hash match,
+ * so a collision never returns the cores of another sequence.
+ */
+
+#ifndef __SV_CACHE_H__
+#define __SV_CACHE_H__
+
+#include "lps.h"
+#include "mpmc.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SV_CACHE_SHARD_BITS 6
+#define SV_CACHE_SHARDS (1 << SV_CACHE_SHARD_BITS)
+#define SV_CACHE_MIN_BUCKETS 64
+#define DEFAULT_SV_CACHE_MB 64
+
+struct sv_bound {
+    uint64_t start; /** Start index of the core in the allele. */
+    uint64_t end;   /** End index of the core in the allele. */
+};
+
+struct sv_cache_entry {
+    uint64_t hash;
+    uint64_t seq_len;
+    int lcp_level;
+    int size;                           /** Number of cores. */
+    struct sv_bound *cores;             /** Cores, stored right after the entry. */
+    char *seq;                          /** Allele, stored after the cores. */
+    struct sv_cache_entry *next;        /** Next entry in the same bucket. */
+    struct sv_cache_entry *lru_prev;    /** More recently used entry. */
+    struct sv_cache_entry *lru_next;    /** Less recently used entry. */
+};
+
+struct sv_cache_shard {
+    _Alignas(MPMC_CACHE_LINE) pthread_mutex_t mutex;
+    struct sv_cache_entry **buckets;
+    uint64_t bucket_mask;               /** Number of buckets-1 (a power of two). */
+    uint64_t entry_count;
+    uint64_t bytes;                     /** Bytes taken by the entries. */
+    struct sv_cache_entry *lru_first;   /** Most recently used entry. */
+    struct sv_cache_entry *lru_last;    /** Least recently used entry, evicted first. */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+struct sv_cache {
+    struct sv_cache_shard shards[SV_CACHE_SHARDS];
+    uint64_t shard_capacity; /** Byte budget of a shard. */
+};
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param capacity Byte budget of the whole cache, split evenly among the shards.
+ * @return Pointer to the cache, NULL if `capacity` is less than a byte per shard or memory allocation fails.
+ */
+struct sv_cache *sv_cache_create(uint64_t capacity);
+
+/**
+ * @brief Adds the counters of the cache to the run stats and frees it.
+ * Does nothing if `cache` is NULL.
+ */
+void sv_cache_destroy(struct sv_cache *cache);
+
+/**
+ * @brief Finds the LCP cores of `seq` at `lcp_level`.
+ *
+ * The cores are copied to `*cores`, which is grown as needed. On a miss the
+ * allele is parsed and the result is added to the cache if it fits in the
+ * budget of its shard. With a NULL cache the allele is always parsed.
+ *
+ * @param cache     The cache, can be NULL.
+ * @param seq       The allele.
+ * @param seq_len   Length of the allele.
+ * @param lcp_level LCP level to parse the allele at.
+ * @param cores     Buffer the cores are copied to, owned by the caller.
+ * @param capacity  Capacity of `*cores`.
+ * @return Number of cores.
+ */
+int sv_cache_decompose(struct sv_cache *cache, const char *seq, uint64_t seq_len, int lcp_level, struct sv_bound **cores, int *capacity);
+
+#endif
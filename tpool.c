@@ -1,194 +1,482 @@
 #include "tpool.h"
 
+/** Worker of the calling thread, NULL outside of the pools. */
+static _Thread_local struct tpool_worker *tpool_self = NULL;
+
+// ------------------------------------------------------------------------------------
+//      TASK OBJECTS
+// ------------------------------------------------------------------------------------
+
+/**
+ * Allocates a slab and links its tasks into a list.
+ *
+ * @return First task of the slab or NULL on failure. Must be called with `work_mutex` held.
+ */
+static struct tpool_work *tpool_slab_create(struct tpool *tm) {
+    struct tpool_slab *slab = malloc(sizeof(struct tpool_slab));
+    if (slab == NULL)
+        return NULL;
+
+    for (size_t i=0; i<TPOOL_SLAB_TASKS; i++) {
+        slab->works[i].next = i+1 < TPOOL_SLAB_TASKS ? &(slab->works[i+1]) : NULL;
+    }
+    slab->next = tm->slabs;
+    tm->slabs = slab;
+
+    return slab->works;
+}
+
 /**
- * Creates a new work task for the thread pool.
- * 
- * @param func Function pointer representing the work to execute.
- * @param arg Argument to be passed to the function.
- * @return Pointer to the newly created tpool_work structure or NULL on failure.
+ * Takes a free task object. Workers take it from their own cache and refill
+ * the cache in chunks, any other thread takes it from the shared free list.
+ *
+ * @param tm Pointer to the thread pool.
+ * @param self Worker of the calling thread in this pool, NULL if none.
+ * @return Pointer to the task or NULL on failure.
  */
-struct tpool_work *tpool_work_create(thread_func_t func, void *arg) {
+static struct tpool_work *tpool_work_create(struct tpool *tm, struct tpool_worker *self) {
     struct tpool_work *work;
 
-    if (func == NULL)
-        return NULL;
+    if (self != NULL && self->free_works != NULL) {
+        work = self->free_works;
+        self->free_works = work->next;
+        self->free_cnt--;
+        return work;
+    }
+
+    pthread_mutex_lock(&(tm->work_mutex));
+    if (tm->free_works == NULL)
+        tm->free_works = tpool_slab_create(tm);
+
+    work = tm->free_works;
+    if (work != NULL) {
+        tm->free_works = work->next;
+
+        // move a chunk to the cache of the worker
+        while (self != NULL && tm->free_works != NULL && self->free_cnt < TPOOL_CACHE_TASKS) {
+            struct tpool_work *cached = tm->free_works;
+            tm->free_works = cached->next;
+            cached->next = self->free_works;
+            self->free_works = cached;
+            self->free_cnt++;
+        }
+    }
+    pthread_mutex_unlock(&(tm->work_mutex));
 
-    work = malloc(sizeof(struct tpool_work));
-    work->func = func;
-    work->arg = arg;
-    work->next = NULL;
     return work;
 }
 
 /**
- * Frees the memory allocated for a tpool_work structure.
- * 
- * @param work Pointer to the tpool_work structure to destroy.
+ * Gives a task object back. A worker keeps it in its cache and returns a
+ * chunk to the shared list once the cache grows too large, so that tasks
+ * added from outside of the pool do not pile up in the caches.
  */
-void tpool_work_destroy(struct tpool_work *work) {
-    if (work == NULL)
+static void tpool_work_destroy(struct tpool *tm, struct tpool_worker *self, struct tpool_work *work) {
+    if (self != NULL) {
+        work->next = self->free_works;
+        self->free_works = work;
+        self->free_cnt++;
+        if (self->free_cnt <= 2 * TPOOL_CACHE_TASKS)
+            return;
+
+        pthread_mutex_lock(&(tm->work_mutex));
+        while (TPOOL_CACHE_TASKS < self->free_cnt) {
+            struct tpool_work *returned = self->free_works;
+            self->free_works = returned->next;
+            self->free_cnt--;
+            returned->next = tm->free_works;
+            tm->free_works = returned;
+        }
+        pthread_mutex_unlock(&(tm->work_mutex));
         return;
-    free(work);
+    }
+
+    pthread_mutex_lock(&(tm->work_mutex));
+    work->next = tm->free_works;
+    tm->free_works = work;
+    pthread_mutex_unlock(&(tm->work_mutex));
+}
+
+// ------------------------------------------------------------------------------------
+//      DEQUES
+// ------------------------------------------------------------------------------------
+
+static struct tpool_deque_array *tpool_deque_array_create(int64_t capacity) {
+    struct tpool_deque_array *array = malloc(sizeof(struct tpool_deque_array));
+    if (array == NULL)
+        return NULL;
+
+    array->works = malloc(capacity * sizeof(_Atomic(struct tpool_work *)));
+    if (array->works == NULL) {
+        free(array);
+        return NULL;
+    }
+    array->mask = capacity - 1;
+    array->prev = NULL;
+
+    return array;
+}
+
+static void tpool_deque_init(struct tpool_deque *deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, tpool_deque_array_create(TPOOL_DEQUE_CAPACITY));
+}
+
+static void tpool_deque_free(struct tpool_deque *deque) {
+    struct tpool_deque_array *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    while (array != NULL) {
+        struct tpool_deque_array *prev = array->prev;
+        free(array->works);
+        free(array);
+        array = prev;
+    }
 }
 
 /**
- * Retrieves the next available work task from the thread pool queue.
- * 
- * @param tm Pointer to the thread pool.
- * @return Pointer to the next tpool_work structure or NULL if the queue is empty.
+ * Pushes a task to the bottom of the deque, owner only. A full array is
+ * replaced by one twice as large. The old array is kept until the deque is
+ * freed, as a thief may still be reading it.
+ *
+ * @return 1 on success, 0 if the deque couldn't grow.
  */
-struct tpool_work *tpool_work_get(struct tpool *tm) {
-    struct tpool_work *work;
+static int tpool_deque_push(struct tpool_deque *deque, struct tpool_work *work) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    struct tpool_deque_array *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
 
-    if (tm == NULL)
-        return NULL;
+    if (array == NULL)
+        return 0;
 
-    work = tm->work_first;
-    if (work == NULL)
+    if (array->mask < bottom - top) {
+        struct tpool_deque_array *bigger = tpool_deque_array_create(2 * (array->mask + 1));
+        if (bigger == NULL)
+            return 0;
+        for (int64_t i=top; i<bottom; i++) {
+            struct tpool_work *moved = atomic_load_explicit(&(array->works[i & array->mask]), memory_order_relaxed);
+            atomic_store_explicit(&(bigger->works[i & bigger->mask]), moved, memory_order_relaxed);
+        }
+        bigger->prev = array;
+        atomic_store_explicit(&deque->array, bigger, memory_order_release);
+        array = bigger;
+    }
+
+    atomic_store_explicit(&(array->works[bottom & array->mask]), work, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+
+    return 1;
+}
+
+/**
+ * Pops the last pushed task of the deque, owner only.
+ *
+ * @return Pointer to the task or NULL if the deque is empty.
+ */
+static struct tpool_work *tpool_deque_take(struct tpool_deque *deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    struct tpool_deque_array *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (bottom < top) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
         return NULL;
+    }
 
-    if (work->next == NULL) {
-        tm->work_first = NULL;
-        tm->work_last = NULL;
-    } else {
-        tm->work_first = work->next;
+    struct tpool_work *work = atomic_load_explicit(&(array->works[bottom & array->mask]), memory_order_relaxed);
+    if (top == bottom) {
+        // last task, race against thieves
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            work = NULL;
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
     }
 
     return work;
 }
 
 /**
- * Worker thread function to process tasks from the thread pool.
- * 
- * @param arg Pointer to the thread pool structure.
+ * Takes the oldest task of another worker's deque.
+ *
+ * @return Pointer to the task or NULL if the deque is empty or another thief won.
  */
-void* tpool_worker(void *arg) {
-    struct tpool *tm = arg;
-    struct tpool_work *work;
+static struct tpool_work *tpool_deque_steal(struct tpool_deque *deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
 
-    while (1) {
-        pthread_mutex_lock(&(tm->work_mutex));
+    if (bottom <= top)
+        return NULL;
 
-        while (tm->work_first == NULL && !tm->stop)
-            pthread_cond_wait(&(tm->work_cond), &(tm->work_mutex));
+    struct tpool_deque_array *array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    struct tpool_work *work = atomic_load_explicit(&(array->works[top & array->mask]), memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
 
-        if (tm->stop)
-            break;
+    return work;
+}
+
+// ------------------------------------------------------------------------------------
+//      WORKERS
+// ------------------------------------------------------------------------------------
+
+static inline uint64_t tpool_rand(struct tpool_worker *self) {
+    self->rand_state ^= self->rand_state << 13;
+    self->rand_state ^= self->rand_state >> 7;
+    self->rand_state ^= self->rand_state << 17;
+    return self->rand_state;
+}
 
-        work = tpool_work_get(tm);
-        tm->working_cnt++;
+/**
+ * Finds a task for the worker: its own deque first, then the tasks added
+ * from outside of the pool, then the deques of the others starting from a
+ * random victim.
+ *
+ * @return Pointer to the task or NULL if none is found.
+ */
+static struct tpool_work *tpool_work_get(struct tpool *tm, struct tpool_worker *self) {
+    struct tpool_work *work = tpool_deque_take(&(self->deque));
+
+    // the list is checked without the lock first, as it is empty most of the time
+    if (work == NULL && atomic_load_explicit(&tm->work_first, memory_order_relaxed) != NULL) {
+        pthread_mutex_lock(&(tm->work_mutex));
+        work = tm->work_first;
+        if (work != NULL) {
+            tm->work_first = work->next;
+            if (tm->work_first == NULL)
+                tm->work_last = NULL;
+        }
         pthread_mutex_unlock(&(tm->work_mutex));
+    }
+
+    if (work == NULL && 1 < tm->thread_cnt) {
+        size_t first = tpool_rand(self) % tm->thread_cnt;
+        for (size_t i=0; i<tm->thread_cnt && work == NULL; i++) {
+            struct tpool_worker *victim = &(tm->workers[(first + i) % tm->thread_cnt]);
+            if (victim != self)
+                work = tpool_deque_steal(&(victim->deque));
+        }
+    }
+
+    if (work != NULL)
+        atomic_fetch_sub_explicit(&tm->queued, 1, memory_order_relaxed);
+
+    return work;
+}
+
+/**
+ * Runs the task and signals its group and the pool if they are finished.
+ * The task object is recycled before the call, so that the function can
+ * spawn new tasks with it.
+ */
+static void tpool_work_run(struct tpool *tm, struct tpool_worker *self, struct tpool_work *work) {
+    thread_func_t func = work->func;
+    void *arg = work->arg;
+    struct tpool_group *group = work->group;
+    int finished = 0;
+
+    tpool_work_destroy(tm, self, work);
+    func(arg);
+
+    // the group may be released by its waiter right after, so it is not touched afterwards
+    if (group != NULL && atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) == 1)
+        finished = 1;
+    if (atomic_fetch_sub_explicit(&tm->working_cnt, 1, memory_order_acq_rel) == 1)
+        finished = 1;
+    if (finished)
+        ec_notify(&tm->done_ec);
+}
 
+/**
+ * Worker thread function to process tasks from the thread pool.
+ *
+ * @param arg Pointer to the worker structure.
+ */
+static void *tpool_worker(void *arg) {
+    struct tpool_worker *self = arg;
+    struct tpool *tm = self->tm;
+
+    tpool_self = self;
+
+    while (!atomic_load_explicit(&tm->stop, memory_order_acquire)) {
+        struct tpool_work *work = tpool_work_get(tm, self);
         if (work != NULL) {
-            work->func(work->arg);
-            tpool_work_destroy(work);
+            tpool_work_run(tm, self, work);
+            continue;
         }
 
-        pthread_mutex_lock(&(tm->work_mutex));
-        tm->working_cnt--;
-        if (!tm->stop && tm->working_cnt == 0 && tm->work_first == NULL)
-            pthread_cond_signal(&(tm->working_cond));
-        pthread_mutex_unlock(&(tm->work_mutex));
+        uint32_t key = ec_prepare(&tm->work_ec);
+        if (atomic_load_explicit(&tm->queued, memory_order_seq_cst) || atomic_load_explicit(&tm->stop, memory_order_acquire)) {
+            ec_cancel(&tm->work_ec);
+            continue;
+        }
+        ec_wait(&tm->work_ec, key);
     }
 
-    tm->thread_cnt--;
-    pthread_cond_signal(&(tm->working_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
+    tpool_self = NULL;
 
     return NULL;
 }
 
+// ------------------------------------------------------------------------------------
+//      POOL
+// ------------------------------------------------------------------------------------
+
 struct tpool *tpool_create(size_t num) {
     struct tpool *tm;
-    pthread_t thread;
     size_t i;
 
     if (num == 0)
         num = 1;
 
     tm = calloc(1, sizeof(*tm));
+    if (tm == NULL)
+        return NULL;
+
+    tm->workers = aligned_alloc(MPMC_CACHE_LINE, num * sizeof(struct tpool_worker));
+    if (tm->workers == NULL) {
+        free(tm);
+        return NULL;
+    }
     tm->thread_cnt = num;
 
     pthread_mutex_init(&(tm->work_mutex), NULL);
-    pthread_cond_init(&(tm->work_cond), NULL);
-    pthread_cond_init(&(tm->working_cond), NULL);
+    atomic_init(&tm->queued, 0);
+    atomic_init(&tm->working_cnt, 0);
+    atomic_init(&tm->stop, 0);
+    ec_init(&tm->work_ec);
+    ec_init(&tm->done_ec);
 
-    tm->work_first = NULL;
-    tm->work_last = NULL;
+    // every deque exists before any worker starts to steal
+    for (i=0; i<num; i++) {
+        struct tpool_worker *worker = &(tm->workers[i]);
+        tpool_deque_init(&(worker->deque));
+        worker->tm = tm;
+        worker->free_works = NULL;
+        worker->free_cnt = 0;
+        worker->rand_state = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
 
     for (i=0; i<num; i++) {
-        pthread_create(&thread, NULL, tpool_worker, tm);
-        pthread_detach(thread);
+        pthread_create(&(tm->workers[i].thread), NULL, tpool_worker, &(tm->workers[i]));
     }
 
     return tm;
 }
 
 void tpool_destroy(struct tpool *tm) {
-    struct tpool_work *work;
-    struct tpool_work *work2;
-
     if (tm == NULL)
         return;
 
-    pthread_mutex_lock(&(tm->work_mutex));
-    work = tm->work_first;
-    while (work != NULL) {
-        work2 = work->next;
-        tpool_work_destroy(work);
-        work = work2;
-    }
-    tm->work_first = NULL;
-    tm->stop = 1;
-    pthread_cond_broadcast(&(tm->work_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
+    atomic_store_explicit(&tm->stop, 1, memory_order_release);
+    ec_notify(&tm->work_ec);
 
-    tpool_wait(tm);
+    for (size_t i=0; i<tm->thread_cnt; i++) {
+        pthread_join(tm->workers[i].thread, NULL);
+        tpool_deque_free(&(tm->workers[i].deque));
+    }
+
+    // task objects of queued tasks and of the caches are freed with the slabs
+    while (tm->slabs != NULL) {
+        struct tpool_slab *next = tm->slabs->next;
+        free(tm->slabs);
+        tm->slabs = next;
+    }
 
     pthread_mutex_destroy(&(tm->work_mutex));
-    pthread_cond_destroy(&(tm->work_cond));
-    pthread_cond_destroy(&(tm->working_cond));
+    ec_destroy(&tm->work_ec);
+    ec_destroy(&tm->done_ec);
 
+    free(tm->workers);
     free(tm);
 }
 
-int tpool_add_work(struct tpool *tm, thread_func_t func, void *arg) {
+int tpool_spawn(struct tpool *tm, struct tpool_group *group, thread_func_t func, void *arg) {
+    struct tpool_worker *self = tpool_self;
     struct tpool_work *work;
 
-    if (tm == NULL)
+    if (tm == NULL || func == NULL)
         return 0;
 
-    work = tpool_work_create(func, arg);
+    if (self != NULL && self->tm != tm)
+        self = NULL;
+
+    work = tpool_work_create(tm, self);
     if (work == NULL)
         return 0;
 
-    pthread_mutex_lock(&(tm->work_mutex));
-    if (tm->work_first == NULL) {
-        tm->work_first = work;
-        tm->work_last  = tm->work_first;
-    } else {
-        tm->work_last->next = work;
-        tm->work_last       = work;
+    work->func = func;
+    work->arg = arg;
+    work->group = group;
+    work->next = NULL;
+
+    if (group != NULL)
+        atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tm->working_cnt, 1, memory_order_relaxed);
+
+    // counted before it is visible, so that a worker going to sleep cannot miss it
+    atomic_fetch_add_explicit(&tm->queued, 1, memory_order_seq_cst);
+
+    if (self == NULL || !tpool_deque_push(&(self->deque), work)) {
+        pthread_mutex_lock(&(tm->work_mutex));
+        if (tm->work_first == NULL) {
+            tm->work_first = work;
+            tm->work_last  = tm->work_first;
+        } else {
+            tm->work_last->next = work;
+            tm->work_last       = work;
+        }
+        pthread_mutex_unlock(&(tm->work_mutex));
     }
 
-    pthread_cond_broadcast(&(tm->work_cond));
-    pthread_mutex_unlock(&(tm->work_mutex));
+    ec_notify_one(&tm->work_ec);
 
     return 1;
 }
 
+int tpool_add_work(struct tpool *tm, thread_func_t func, void *arg) {
+    return tpool_spawn(tm, NULL, func, arg);
+}
+
 void tpool_wait(struct tpool *tm) {
     if (tm == NULL)
         return;
 
-    pthread_mutex_lock(&(tm->work_mutex));
-    while (1) {
-        if (tm->work_first != NULL || (!tm->stop && tm->working_cnt != 0) || (tm->stop && tm->thread_cnt != 0)) {
-            pthread_cond_wait(&(tm->working_cond), &(tm->work_mutex));
-        } else {
+    while (atomic_load_explicit(&tm->working_cnt, memory_order_acquire)) {
+        uint32_t key = ec_prepare(&tm->done_ec);
+        if (atomic_load_explicit(&tm->working_cnt, memory_order_acquire) == 0) {
+            ec_cancel(&tm->done_ec);
             break;
         }
+        ec_wait(&tm->done_ec, key);
     }
-    pthread_mutex_unlock(&(tm->work_mutex));
 }
 
+void tpool_group_init(struct tpool_group *group) {
+    atomic_init(&group->pending, 0);
+}
+
+void tpool_group_wait(struct tpool *tm, struct tpool_group *group) {
+    struct tpool_worker *self = tpool_self;
+    int helps = self != NULL && self->tm == tm;
+
+    while (atomic_load_explicit(&group->pending, memory_order_acquire)) {
+        if (helps) {
+            struct tpool_work *work = tpool_work_get(tm, self);
+            if (work != NULL) {
+                tpool_work_run(tm, self, work);
+                continue;
+            }
+        }
+
+        // tasks of the group are all running, sleep until one of the groups is finished
+        uint32_t key = ec_prepare(&tm->done_ec);
+        if (atomic_load_explicit(&group->pending, memory_order_acquire) == 0 ||
+            (helps && atomic_load_explicit(&tm->queued, memory_order_seq_cst))) {
+            ec_cancel(&tm->done_ec);
+            continue;
+        }
+        ec_wait(&tm->done_ec, key);
+    }
+}
@@ -1,12 +1,19 @@
 /**
  * @file tpool.h
- * @brief Implementation of a simple thread pool for parallel task execution.
+ * @brief Implementation of a work-stealing thread pool for parallel task execution.
  *
  * This file provides the implementation of a thread pool that allows users
- * to efficiently distribute tasks among a fixed number of worker threads. 
- * It supports creating tasks, adding them to a work queue, and waiting for 
+ * to efficiently distribute tasks among a fixed number of worker threads.
+ * It supports creating tasks, adding them to a work queue, and waiting for
  * their completion.
  *
+ * Every worker owns a Chase-Lev deque. Tasks spawned by a worker are pushed
+ * to the bottom of its own deque and popped from there in LIFO order, while
+ * idle workers steal from the top of the deques of others. Tasks added by
+ * threads outside of the pool go to a shared injection list. Task objects
+ * are taken from per-worker caches refilled from slabs, so adding a task
+ * does not call `malloc`.
+ *
  * ## Example Usage:
  * ```c
  * #include "tpool.h"
@@ -46,13 +53,25 @@
  * }
  * ```
  *
+ * ## Fork/join:
+ * ```c
+ * struct tpool_group group;
+ * tpool_group_init(&group);
+ * for (i = 0; i < num_items; i++) {
+ *     tpool_spawn(tm, &group, worker, vals + i);
+ * }
+ * tpool_group_wait(tm, &group); // only waits for the tasks of the group
+ * ```
+ *
  * ## Features:
- * - Efficient task scheduling with a fixed number of worker threads.
- * - Dynamic work queue management.
- * - Thread-safe operations using mutexes and condition variables.
+ * - Per-worker deques, so spawning and finishing tasks do not take a lock.
+ * - Idle workers steal from random victims and sleep on an event count.
+ * - A worker waiting for a group runs other tasks in the meantime.
  *
  * ## Notes:
  * - Ensure that the worker function and its arguments are thread-safe.
+ * - Tasks that block on each other need a thread each. A pool runs at most
+ *   `num` such tasks at once.
  * - The thread pool must be destroyed after use to free allocated resources.
  */
 
@@ -61,45 +80,91 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include "mpmc.h"
+
+#define TPOOL_SLAB_TASKS 256
+#define TPOOL_CACHE_TASKS 64
+#define TPOOL_DEQUE_CAPACITY 256
 
 typedef void (*thread_func_t)(void *arg);
 
+/**
+ * Set of tasks that can be waited for together.
+ */
+struct tpool_group {
+    _Atomic size_t pending; /** Number of tasks of the group that are not finished. */
+};
+
 struct tpool_work {
     thread_func_t func;
     void *arg;
-    struct tpool_work *next;
+    struct tpool_group *group; /** Group of the task, NULL if none. */
+    struct tpool_work *next;   /** Next task in the injection list or in a free list. */
+};
+
+struct tpool_slab {
+    struct tpool_work works[TPOOL_SLAB_TASKS];
+    struct tpool_slab *next;
+};
+
+struct tpool_deque_array {
+    int64_t mask;                        /** Capacity-1 (capacity is a power of two). */
+    _Atomic(struct tpool_work *) *works; /** Circular buffer of tasks. */
+    struct tpool_deque_array *prev;      /** Smaller array it replaced, freed with the deque. */
+};
+
+struct tpool_deque {
+    _Alignas(MPMC_CACHE_LINE) _Atomic int64_t top;    /** Position to steal from. */
+    _Alignas(MPMC_CACHE_LINE) _Atomic int64_t bottom; /** Position to push to, owner only. */
+    _Atomic(struct tpool_deque_array *) array;
+};
+
+struct tpool_worker {
+    struct tpool_deque deque;
+    struct tpool *tm;
+    struct tpool_work *free_works; /** Cache of free tasks, owner only. */
+    size_t free_cnt;               /** Number of tasks in the cache. */
+    uint64_t rand_state;           /** State to pick victims. */
+    pthread_t thread;
 };
 
 struct tpool {
-    struct tpool_work *work_first;
-    struct tpool_work *work_last;
-    pthread_mutex_t work_mutex;
-    pthread_cond_t work_cond;
-    pthread_cond_t working_cond;
-    size_t working_cnt;
+    struct tpool_worker *workers;
     size_t thread_cnt;
-    int stop;
+    pthread_mutex_t work_mutex;               /** Guards the injection list and the shared free list. */
+    _Atomic(struct tpool_work *) work_first;  /** Tasks added from outside of the pool. */
+    struct tpool_work *work_last;
+    struct tpool_work *free_works;            /** Free tasks shared by all threads. */
+    struct tpool_slab *slabs;
+    _Atomic size_t queued;                    /** Number of tasks waiting in the deques and the injection list. */
+    _Atomic size_t working_cnt;               /** Number of tasks added and not finished. */
+    eventcount_t work_ec;                     /** Idle workers sleep here. */
+    eventcount_t done_ec;                     /** Notified when a group or the whole pool is finished. */
+    _Atomic int stop;
 };
 
 /**
  * Creates a new thread pool with the specified number of threads.
- * 
- * @param num Number of worker threads to create (minimum is 2).
+ *
+ * @param num Number of worker threads to create (minimum is 1).
  * @return Pointer to the created tpool structure or NULL on failure.
  */
 struct tpool *tpool_create(size_t num);
 
 /**
  * Destroys the thread pool, freeing all resources and stopping threads.
- * 
+ * Tasks that are not started yet are dropped.
+ *
  * @param tm Pointer to the thread pool to destroy.
  */
 void tpool_destroy(struct tpool *tm);
 
 /**
  * Adds a new work task to the thread pool.
- * 
+ *
  * @param tm Pointer to the thread pool.
  * @param func Function pointer representing the work to execute.
  * @param arg Argument to be passed to the function.
@@ -108,10 +173,38 @@ void tpool_destroy(struct tpool *tm);
 int tpool_add_work(struct tpool *tm, thread_func_t func, void *arg);
 
 /**
- * Waits for all pending tasks in the thread pool to complete and all threads to finish.
- * 
+ * Waits for all pending tasks in the thread pool to complete. Must not be
+ * called from a task of the same pool.
+ *
  * @param tm Pointer to the thread pool.
  */
 void tpool_wait(struct tpool *tm);
 
+/**
+ * Initializes an empty task group.
+ */
+void tpool_group_init(struct tpool_group *group);
+
+/**
+ * Adds a new task to the thread pool as a member of the group. When called
+ * from a task of the same pool, the task is pushed to the worker's own deque.
+ *
+ * @param tm Pointer to the thread pool.
+ * @param group Group of the task, NULL if the task has no group.
+ * @param func Function pointer representing the work to execute.
+ * @param arg Argument to be passed to the function.
+ * @return 1 on success, 0 on failure.
+ */
+int tpool_spawn(struct tpool *tm, struct tpool_group *group, thread_func_t func, void *arg);
+
+/**
+ * Waits until every task of the group is finished. A worker of the pool
+ * runs other tasks while waiting, any other thread sleeps. Returns at once
+ * for an empty group, even if `tm` is NULL.
+ *
+ * @param tm Pointer to the thread pool the tasks are added to.
+ * @param group Group to wait for.
+ */
+void tpool_group_wait(struct tpool *tm, struct tpool_group *group);
+
 #endif
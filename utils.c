@@ -56,152 +56,194 @@ void open_file_w(FILE **file, const char *filename) {
     }
 }
 
-void open_files(struct opt_arg *args, FILE **out_segment, FILE **out_link) {
-
-    *out_segment = NULL;
-    *out_link = NULL;
-
-    // create segment file name and open it
-    char segment_filename[strlen(args->gfa_path)+5];
-    snprintf(segment_filename, sizeof(segment_filename), "%s.s.0", args->gfa_path);
-    open_file_w(out_segment, segment_filename);
-
-    // create link file name and open it
-    char link_filename[strlen(args->gfa_path)+5];
-    snprintf(link_filename, sizeof(link_filename), "%s.l.0", args->gfa_path);
-    open_file_w(out_link, link_filename);
-
-    // print header
-    fprintf(*out_segment, "H\tVN:Z:1.1\n");
-
-    FILE *out_log;
-    if (args->prefix == NULL) {
-        char out_err_filename[10];
-        snprintf(out_err_filename, sizeof(out_err_filename), "lcpan.log");
-        open_file_w(&out_log, out_err_filename);
-    } else {
-        char out_err_filename[strlen(args->prefix)+5];
-        snprintf(out_err_filename, sizeof(out_err_filename), "%s.log", args->prefix);
-        open_file_w(&out_log, out_err_filename);
+static inline void print_seq_tag(const char *seq_name, int has_order, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    if (is_rgfa) {
+        gfa_put_str(out, "\tSN:Z:", 6);
+        gfa_put_cstr(out, seq_name);
+        if (has_order) {
+            gfa_put_char(out, '.');
+            gfa_put_i64(out, order);
+        }
+        gfa_put_str(out, "\tSO:i:", 6);
+        gfa_put_u64(out, start);
+        gfa_put_str(out, "\tSR:i:", 6);
+        gfa_put_i64(out, rank);
     }
+    gfa_put_char(out, '\n');
+}
 
-    fprintf(out_log, "vg\n");
-    fprintf(out_log, "%s\n", args->gfa_path);
-    fprintf(out_log, "%d\n", args->thread_number);
-    fclose(out_log);
+static inline void print_seq_id(uint64_t id, gfa_stream_t *out) {
+    gfa_put_str(out, "S\t", 2);
+    gfa_put_u64(out, id);
+    gfa_put_char(out, '\t');
 }
 
-void print_seq3(uint64_t id, const char *seq1, int seq1_len, 
-                             const char *seq2, int seq2_len,
-                             const char *seq3, int seq3_len,
-                             const char *seq_name, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq1, 1, seq1_len, out);
-    fwrite(seq2, 1, seq2_len, out);
-    fwrite(seq3, 1, seq3_len, out);
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s\tSO:i:%d\tSR:i:%d\n", seq_name, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_seq3(uint64_t id, const char *seq1, uint64_t seq1_len, 
+                             const char *seq2, uint64_t seq2_len,
+                             const char *seq3, uint64_t seq3_len,
+                             const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq1, seq1_len);
+    gfa_put_str(out, seq2, seq2_len);
+    gfa_put_str(out, seq3, seq3_len);
+    print_seq_tag(seq_name, 0, 0, start, rank, is_rgfa, out);
 }
 
-void print_seq2(uint64_t id, const char *seq1, int seq1_len, 
-                             const char *seq2, int seq2_len,
-                             const char *seq_name, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq1, 1, seq1_len, out);
-    fwrite(seq2, 1, seq2_len, out);
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s\tSO:i:%d\tSR:i:%d\n", seq_name, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_seq2(uint64_t id, const char *seq1, uint64_t seq1_len, 
+                             const char *seq2, uint64_t seq2_len,
+                             const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq1, seq1_len);
+    gfa_put_str(out, seq2, seq2_len);
+    print_seq_tag(seq_name, 0, 0, start, rank, is_rgfa, out);
 }
 
-void print_seq(uint64_t id, const char *seq, int seq_len, const char *seq_name, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq, 1, seq_len, out); 
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s\tSO:i:%d\tSR:i:%d\n", seq_name, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_seq(uint64_t id, const char *seq, uint64_t seq_len, const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq, seq_len);
+    print_seq_tag(seq_name, 0, 0, start, rank, is_rgfa, out);
 }
 
-void print_seq3_vg(uint64_t id, const char *seq1, int seq1_len, 
-                                const char *seq2, int seq2_len,
-                                const char *seq3, int seq3_len,
-                                const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq1, 1, seq1_len, out);
-    fwrite(seq2, 1, seq2_len, out);
-    fwrite(seq3, 1, seq3_len, out);
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s.%d\tSO:i:%d\tSR:i:%d\n", seq_name, order, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_ref_seq(uint64_t id, const struct chr *chrom, uint64_t start, uint64_t end, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    if (chrom->packed.codes != NULL) {
+        unpack_seq(&(chrom->packed), start, end - start, gfa_stream_reserve(out, end - start));
+        out->size += end - start;
+    } else {
+        gfa_put_str(out, chrom->seq + start, end - start);
+    }
+    print_seq_tag(chrom->seq_name, 0, 0, start, 0, is_rgfa, out);
 }
 
-void print_seq2_vg(uint64_t id, const char *seq1, int seq1_len, 
-                                const char *seq2, int seq2_len,
-                                const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq1, 1, seq1_len, out);
-    fwrite(seq2, 1, seq2_len, out);
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s.%d\tSO:i:%d\tSR:i:%d\n", seq_name, order, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_seq3_vg(uint64_t id, const char *seq1, uint64_t seq1_len, 
+                                const char *seq2, uint64_t seq2_len,
+                                const char *seq3, uint64_t seq3_len,
+                                const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq1, seq1_len);
+    gfa_put_str(out, seq2, seq2_len);
+    gfa_put_str(out, seq3, seq3_len);
+    print_seq_tag(seq_name, 1, order, start, rank, is_rgfa, out);
 }
 
-void print_seq_vg(uint64_t id, const char *seq, int seq_len, const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out) {
-	fprintf(out, "S\t%lu\t", id);
-    fwrite(seq, 1, seq_len, out); 
-	if (is_rgfa) {
-		fprintf(out, "\tSN:Z:%s.%d\tSO:i:%d\tSR:i:%d\n", seq_name, order, start, rank); 
-	} else {
-		fprintf(out, "\n");
-	}
+void print_seq2_vg(uint64_t id, const char *seq1, uint64_t seq1_len, 
+                                const char *seq2, uint64_t seq2_len,
+                                const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq1, seq1_len);
+    gfa_put_str(out, seq2, seq2_len);
+    print_seq_tag(seq_name, 1, order, start, rank, is_rgfa, out);
 }
 
-void print_link(uint64_t id1, char sign1, uint64_t id2, char sign2, uint64_t overlap, FILE *out) {
-    fprintf(out, "L\t%lu\t%c\t%lu\t%c\t%ldM\n", id1, sign1, id2, sign2, overlap);
+void print_seq_vg(uint64_t id, const char *seq, uint64_t seq_len, const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out) {
+    print_seq_id(id, out);
+    gfa_put_str(out, seq, seq_len);
+    print_seq_tag(seq_name, 1, order, start, rank, is_rgfa, out);
 }
 
-void find_boundaries(uint64_t start_loc, uint64_t end_loc, const struct chr *chrom, uint64_t start_index, uint64_t *latest_core_index, uint64_t *first_core_after) {
+void print_link(uint64_t id1, char sign1, uint64_t id2, char sign2, uint64_t overlap, gfa_stream_t *out) {
+    gfa_put_str(out, "L\t", 2);
+    gfa_put_u64(out, id1);
+    gfa_put_char(out, '\t');
+    gfa_put_char(out, sign1);
+    gfa_put_char(out, '\t');
+    gfa_put_u64(out, id2);
+    gfa_put_char(out, '\t');
+    gfa_put_char(out, sign2);
+    gfa_put_char(out, '\t');
+    gfa_put_i64(out, (int64_t)overlap);
+    gfa_put_str(out, "M\n", 2);
+}
 
-    const struct simple_core *cores = chrom->cores;
+uint64_t find_core_before(const struct chr *chrom, uint64_t loc, uint64_t hint) {
     uint64_t cores_size = (uint64_t)chrom->cores_size;
-    uint64_t core_idx_1 = cores[start_index].end <= start_loc ? start_index : 0;
-    int left, mid, right;
-
-    left = core_idx_1;
-    right = core_idx_1+5 < cores_size && end_loc < cores[core_idx_1+5].start ? core_idx_1+5 : cores_size;
-    while (left < right) {
-        mid = left + (right - left) / 2;
-        if (cores[mid].end <= start_loc) {
-            core_idx_1 = mid;
-            left = mid + 1;
+
+    if (cores_size == 0) {
+        return 0;
+    }
+    if (cores_size <= hint) {
+        hint = cores_size - 1;
+    }
+
+    // bracket the answer such that cores[low].end <= loc < cores[high].end
+    uint64_t low, high;
+    if (core_end(chrom, hint) <= loc) {
+        low = hint;
+        high = cores_size;
+        uint64_t step = 1;
+        while (low + step < cores_size) {
+            if (loc < core_end(chrom, low + step)) {
+                high = low + step;
+                break;
+            }
+            low += step;
+            step <<= 1;
+        }
+    } else {
+        high = hint;
+        uint64_t step = 1;
+        while (1) {
+            if (high < step) {
+                if (loc < core_end(chrom, 0)) return 0;
+                low = 0;
+                break;
+            }
+            if (core_end(chrom, high - step) <= loc) {
+                low = high - step;
+                break;
+            }
+            high -= step;
+            step <<= 1;
+        }
+    }
+
+    while (low + 1 < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (core_end(chrom, mid) <= loc) {
+            low = mid;
         } else {
-            right = mid;
+            high = mid;
         }
     }
+    return low;
+}
 
-    while (core_idx_1 && start_loc < cores[core_idx_1].end ) {
-        core_idx_1--;
+uint64_t find_core_after(const struct chr *chrom, uint64_t loc, uint64_t from) {
+    uint64_t cores_size = (uint64_t)chrom->cores_size;
+
+    if (cores_size <= from) {
+        return cores_size;
+    }
+    if (loc <= core_start(chrom, from)) {
+        return from;
     }
 
-    *latest_core_index = core_idx_1;
-    *first_core_after = cores_size;
-	for (uint64_t j=core_idx_1; j<cores_size; j++) {
-        if (end_loc <= cores[j].start) {
-            *first_core_after = j;
-			return;
+    // bracket the answer such that cores[low].start < loc <= cores[high].start
+    uint64_t low = from, high = cores_size;
+    uint64_t step = 1;
+    while (low + step < cores_size) {
+        if (loc <= core_start(chrom, low + step)) {
+            high = low + step;
+            break;
         }
+        low += step;
+        step <<= 1;
     }
+
+    while (low + 1 < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (loc <= core_start(chrom, mid)) {
+            high = mid;
+        } else {
+            low = mid;
+        }
+    }
+    return high;
+}
+
+void find_boundaries(uint64_t start_loc, uint64_t end_loc, const struct chr *chrom, uint64_t start_index, uint64_t *latest_core_index, uint64_t *first_core_after) {
+    *latest_core_index = find_core_before(chrom, start_loc, start_index);
+    *first_core_after = find_core_after(chrom, end_loc, *latest_core_index);
 }
 
 void refine_seqs(struct ref_seq *seqs, int no_overlap) {
@@ -226,45 +268,92 @@ void refine_seq(struct lps *str, int no_overlap) {
     }
 }
 
-void print_path(const struct ref_seq *seqs, FILE *out) {
-    for (int i=0; i<seqs->size; i++) {
-        if (seqs->chrs[i].cores_size) {
-            const struct chr *chrom = seqs->chrs + i;
+void print_chr_path(const struct chr *chrom, gfa_stream_t *stream) {
+    uint64_t line_start = stream->size;
+
+    // print Path (P)
+    gfa_put_str(stream, "P\t", 2);
+    gfa_put_cstr(stream, chrom->seq_name);
+    gfa_put_char(stream, '\t');
+
+    // every core is preceded by the sub-segments it is split into, if any
+    const uint32_t *offsets = chrom->ids.offsets;
+    for (int j=0; j<chrom->cores_size; j++) {
+        if (offsets != NULL) {
+            for (uint32_t k=offsets[j]; k<offsets[j+1]; k++) {
+                gfa_put_u64(stream, chrom->ids.ids[k]);
+                gfa_put_str(stream, "+,", 2);
+            }
+        }
+        gfa_put_u64(stream, core_id(chrom, j));
+        gfa_put_char(stream, '+');
+        if (j + 1 < chrom->cores_size) {
+            gfa_put_char(stream, ',');
+        }
+    }
 
-            // print Path (P)
-            fprintf(out, "P\t%s\t", chrom->seq_name);
+    // print cigar
+    gfa_put_str(stream, "\t*\n", 3);
 
-            // print first core
-            if (chrom->ids != NULL && chrom->ids[0] != NULL) { // if first one is not NULL
-                fprintf(out, "%lu+", chrom->ids[0][0]);
-                int index = 1;
-                while (chrom->ids[0][index]) {
-                    fprintf(out, ",%lu+", chrom->ids[0][index++]);
-                }
-                fprintf(out, ",%lu+", chrom->cores[0].id);
-            } else {
-                fprintf(out, "%lu+", chrom->cores[0].id);
-            }
-            
-            // print rest
-            if (chrom->ids != NULL) {
-                for (int j=1; j<chrom->cores_size; j++) {
-                    if (chrom->ids[j] != NULL) {
-                        int index = 0;
-                        while (chrom->ids[j][index]) {
-                            fprintf(out, ",%lu+", chrom->ids[j][index++]);
-                        }
-                    }
-                    fprintf(out, ",%lu+", chrom->cores[j].id);
-                }
-            } else {
-                for (int j=1; j<chrom->cores_size; j++) {
-                    fprintf(out, ",%lu+", chrom->cores[j].id);
-                }
-            }
+    uint64_t steps = chrom->cores_size + (offsets != NULL ? offsets[chrom->cores_size] : 0);
+    stats_add_path(steps, stream->size - line_start);
+}
+
+struct path_task {
+    struct chr *chrom;
+    gfa_stream_t stream; /** P line of the chromosome, appended to the file in order. */
+};
 
-            // print cigar
-            fprintf(out, "\t*\n");
+static void print_path_task(void *arg) {
+    struct path_task *task = (struct path_task *)arg;
+    path_ids_build(&(task->chrom->ids), task->chrom->cores_size);
+    print_chr_path(task->chrom, &(task->stream));
+}
+
+/**
+ * Estimated length of the P line of a chromosome, with 10-digit ids.
+ */
+static uint64_t path_size_estimate(const struct chr *chrom) {
+    uint64_t steps = chrom->cores_size;
+    const struct path_ids *ids = &(chrom->ids);
+    if (ids->chunks != NULL) {
+        for (int i=0; i<ids->chunk_count; i++) {
+            steps += ids->chunks[i].size;
         }
+    } else if (ids->offsets != NULL) {
+        steps += ids->offsets[chrom->cores_size];
     }
+    return strlen(chrom->seq_name) + 8 + 12 * steps;
+}
+
+void print_path(struct ref_seq *seqs, gfa_file_t *file, int thread_number) {
+    struct path_task *tasks = (struct path_task *)malloc((seqs->size ? seqs->size : 1) * sizeof(struct path_task));
+    struct tpool *tm = tpool_create(thread_number);
+
+    int next = 0;
+    while (next < seqs->size) {
+        // render a window of P lines in parallel, the window is bounded in bytes unless it has one chromosome
+        int count = 0;
+        uint64_t window_size = 0;
+        while (next < seqs->size && (count == 0 || window_size < PATH_WINDOW_SIZE)) {
+            struct chr *chrom = &(seqs->chrs[next++]);
+            if (chrom->cores_size == 0) continue;
+
+            uint64_t estimate = path_size_estimate(chrom);
+            tasks[count].chrom = chrom;
+            gfa_stream_open_capacity(&(tasks[count].stream), file, estimate);
+            tpool_add_work(tm, print_path_task, tasks + count);
+            window_size += estimate;
+            count++;
+        }
+        tpool_wait(tm);
+
+        // appended in chromosome order
+        for (int i=0; i<count; i++) {
+            gfa_stream_close(&(tasks[i].stream));
+        }
+    }
+
+    tpool_destroy(tm);
+    free(tasks);
 }
@@ -3,11 +3,17 @@
 
 #include "struct_def.h"
 #include "lps.h"
+#include "seq_pack.h"
+#include "core_table.h"
+#include "path_ids.h"
+#include "tpool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 
+#define PATH_WINDOW_SIZE 268435456
+
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
@@ -56,28 +62,6 @@ void open_file_r(FILE **file, const char *filename);
  */
 void open_file_w(FILE **file, const char *filename);
 
-/**
- * @brief Creates and opens output files (segment + link) and writes initial headers/logs.
- *
- * This function creates output file names based on the input GFA path:
- *   - "<gfa_path>.s.0" for segment output
- *   - "<gfa_path>.l.0" for link output
- *
- * It opens both files in write mode and writes the GFA header line
- * into the segment file.
- *
- * It also creates a log file:
- *   - "lcpan.log" if args->prefix is NULL
- *   - "<prefix>.log" otherwise
- *
- * The log file stores basic run information (tool name, gfa path, thread number).
- *
- * @param args Pointer to the program arguments/options struct.
- * @param out_segment Output pointer where the opened segment file handle will be stored.
- * @param out_link Output pointer where the opened link file handle will be stored.
- */
-void open_files(struct opt_arg *args, FILE **out_segment, FILE **out_link);
-
 /**
  * Prints three sequences as single segment in GFA or rGFA format.
  *
@@ -92,9 +76,9 @@ void open_files(struct opt_arg *args, FILE **out_segment, FILE **out_link);
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq3(uint64_t id, const char *seq1, int seq1_len, const char *seq2, int seq2_len, const char *seq3, int seq3_len, const char *seq_name, int start, int rank, int is_rgfa, FILE *out);
+void print_seq3(uint64_t id, const char *seq1, uint64_t seq1_len, const char *seq2, uint64_t seq2_len, const char *seq3, uint64_t seq3_len, const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints two sequences as single segment in GFA or rGFA format.
@@ -108,9 +92,9 @@ void print_seq3(uint64_t id, const char *seq1, int seq1_len, const char *seq2, i
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq2(uint64_t id, const char *seq1, int seq1_len, const char *seq2, int seq2_len, const char *seq_name, int start, int rank, int is_rgfa, FILE *out);
+void print_seq2(uint64_t id, const char *seq1, uint64_t seq1_len, const char *seq2, uint64_t seq2_len, const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints a sequence in GFA or rGFA format.
@@ -122,9 +106,22 @@ void print_seq2(uint64_t id, const char *seq1, int seq1_len, const char *seq2, i
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq(uint64_t id, const char *seq, int seq_len, const char *seq_name, int start, int rank, int is_rgfa, FILE *out);
+void print_seq(uint64_t id, const char *seq, uint64_t seq_len, const char *seq_name, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
+
+/**
+ * Prints a slice of a reference chromosome as a segment in GFA or rGFA format.
+ * The slice is decoded directly into the output if the chromosome is packed.
+ *
+ * @param id       Sequence identifier.
+ * @param chrom    The chromosome (its name is used as `SN:Z:`).
+ * @param start    Start position of the slice.
+ * @param end      End position of the slice (exclusive).
+ * @param is_rgfa  Flag to determine if rGFA format should be used.
+ * @param out      Output buffer of the thread.
+ */
+void print_ref_seq(uint64_t id, const struct chr *chrom, uint64_t start, uint64_t end, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints three sequences as single segment in GFA or rGFA format. Unlike `print_seq`, this function
@@ -142,9 +139,9 @@ void print_seq(uint64_t id, const char *seq, int seq_len, const char *seq_name,
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq3_vg(uint64_t id, const char *seq1, int seq1_len, const char *seq2, int seq2_len, const char *seq3, int seq3_len, const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out);
+void print_seq3_vg(uint64_t id, const char *seq1, uint64_t seq1_len, const char *seq2, uint64_t seq2_len, const char *seq3, uint64_t seq3_len, const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints two sequences as single segment in GFA or rGFA format. Unlike `print_seq`, this function
@@ -160,9 +157,9 @@ void print_seq3_vg(uint64_t id, const char *seq1, int seq1_len, const char *seq2
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq2_vg(uint64_t id, const char *seq1, int seq1_len, const char *seq2, int seq2_len, const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out);
+void print_seq2_vg(uint64_t id, const char *seq1, uint64_t seq1_len, const char *seq2, uint64_t seq2_len, const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints a sequence in GFA or rGFA format. Unlike `print_seq`, this function
@@ -176,9 +173,9 @@ void print_seq2_vg(uint64_t id, const char *seq1, int seq1_len, const char *seq2
  * @param start    Start position of the sequence.
  * @param rank     Rank of the sequence.
  * @param is_rgfa  Flag to determine if rGFA format should be used.
- * @param out      Output file stream.
+ * @param out      Output buffer of the thread.
  */
-void print_seq_vg(uint64_t id, const char *seq, int seq_len, const char *seq_name, int order, int start, int rank, int is_rgfa, FILE *out);
+void print_seq_vg(uint64_t id, const char *seq, uint64_t seq_len, const char *seq_name, int order, uint64_t start, int rank, int is_rgfa, gfa_stream_t *out);
 
 /**
  * Prints a link between two sequences in GFA format.
@@ -188,9 +185,32 @@ void print_seq_vg(uint64_t id, const char *seq, int seq_len, const char *seq_nam
  * @param id2        Identifier of the second sequence.
  * @param sign2      Orientation of the second sequence ('+' or '-').
  * @param overlap    Length of the overlap between the sequences.
- * @param out        Output file stream.
+ * @param out        Output buffer of the thread.
  */
-void print_link(uint64_t id1, char sign1, uint64_t id2, char sign2, uint64_t overlap, FILE *out);
+void print_link(uint64_t id1, char sign1, uint64_t id2, char sign2, uint64_t overlap, gfa_stream_t *out);
+
+/**
+ * Finds the last core that ends at or before `loc` by galloping from `hint`
+ * in either direction, then binary searching the bracketed range. The cost
+ * is logarithmic in the distance between `hint` and the result.
+ *
+ * @param chrom Pointer to the chromosome structure containing core regions.
+ * @param loc   The location.
+ * @param hint  Index to start from (e.g., the result for the previous variation).
+ * @return Index of the core, 0 if no core ends at or before `loc`.
+ */
+uint64_t find_core_before(const struct chr *chrom, uint64_t loc, uint64_t hint);
+
+/**
+ * Finds the first core at or after `from` that starts at or after `loc` by
+ * galloping forward from `from`.
+ *
+ * @param chrom Pointer to the chromosome structure containing core regions.
+ * @param loc   The location.
+ * @param from  Index of the first core to be considered.
+ * @return Index of the core, `cores_size` if there is no such core.
+ */
+uint64_t find_core_after(const struct chr *chrom, uint64_t loc, uint64_t from);
 
 /**
  * Finds the latest core index before a given range and the first core index after it.
@@ -221,11 +241,23 @@ void refine_seqs(struct ref_seq *seqs, int no_overlap);
 void refine_seq(struct lps *str, int no_overlap);
 
 /**
- * Prints all Paths in given sequences. The ids should be initialized
+ * Prints the Path of a chromosome with cores. The ids should be stitched (see path_ids_build)
+ *
+ * @param chrom     The chromosome
+ * @param stream    Output stream to write path, not synced.
+ */
+void print_chr_path(const struct chr *chrom, gfa_stream_t *stream);
+
+/**
+ * Prints the Paths of all chromosomes with cores, one task per chromosome.
+ * The ids of every chromosome are stitched and its P line is rendered into
+ * its own buffer; the buffers are appended to the file in chromosome order,
+ * in windows of about PATH_WINDOW_SIZE bytes.
  * 
- * @param ref_seq   The reference sequences
- * @param out       Output file to write path.
+ * @param ref_seq       The reference sequences
+ * @param file          Output file to append paths
+ * @param thread_number Number of threads rendering paths
  */
-void print_path(const struct ref_seq *seqs, FILE *out);
+void print_path(struct ref_seq *seqs, gfa_file_t *file, int thread_number);
 
 #endif
\ No newline at end of file
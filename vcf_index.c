@@ -0,0 +1,224 @@
+#include "vcf_index.h"
+
+/**
+ * Bounds checked cursor over the decompressed index.
+ */
+struct index_cursor {
+    const uint8_t *data;
+    uint64_t size;
+    uint64_t pos;
+    int error;
+};
+
+static inline const uint8_t *take(struct index_cursor *cur, uint64_t len) {
+    if (cur->error || cur->size - cur->pos < len) {
+        cur->error = 1;
+        return NULL;
+    }
+    const uint8_t *p = cur->data + cur->pos;
+    cur->pos += len;
+    return p;
+}
+
+static inline int32_t take_i32(struct index_cursor *cur) {
+    const uint8_t *p = take(cur, 4);
+    return p ? (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24)) : 0;
+}
+
+static inline uint64_t take_u64(struct index_cursor *cur) {
+    const uint8_t *p = take(cur, 8);
+    uint64_t v = 0;
+    if (p) {
+        for (int i=7; i>=0; i--) v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/**
+ * Reads the whole (BGZF compressed) index file into memory.
+ */
+static uint8_t *read_index_file(const char *path, uint64_t *size) {
+    bgzf_file_t *fp = bgzf_open(path, 1);
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    uint64_t capacity = 1048576;
+    uint8_t *data = (uint8_t *)malloc(capacity);
+    if (data == NULL) {
+        bgzf_close(fp);
+        return NULL;
+    }
+    *size = 0;
+
+    int64_t n;
+    while ((n = bgzf_read(fp, data + *size, capacity - *size)) > 0) {
+        *size += n;
+        if (*size == capacity) {
+            capacity *= 2;
+            uint8_t *temp = (uint8_t *)realloc(data, capacity);
+            if (temp == NULL) {
+                free(data);
+                bgzf_close(fp);
+                return NULL;
+            }
+            data = temp;
+        }
+    }
+    bgzf_close(fp);
+
+    if (n < 0) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+/**
+ * Splits null separated sequence names of tabix header into the index.
+ */
+static int parse_names(struct index_cursor *cur, struct vcf_index *index, int ref_count) {
+    int32_t l_nm = take_i32(cur);
+    const char *names = (const char *)take(cur, l_nm < 0 ? cur->size : (uint64_t)l_nm);
+    if (names == NULL) {
+        return 0;
+    }
+
+    index->size = ref_count;
+    index->refs = (struct vcf_index_ref *)calloc(ref_count ? ref_count : 1, sizeof(struct vcf_index_ref));
+
+    const char *p = names, *end = names + l_nm;
+    for (int i=0; i<ref_count; i++) {
+        const char *term = (const char *)memchr(p, '\0', end - p);
+        if (term == NULL) {
+            return 0;
+        }
+        index->refs[i].name = strdup(p);
+        p = term + 1;
+    }
+    return 1;
+}
+
+/**
+ * Computes the range of a reference from its bins. The pseudo-bin holds the
+ * range directly; if it is missing, chunks of all bins are combined.
+ */
+static void parse_bins(struct index_cursor *cur, struct vcf_index_ref *ref, uint32_t pseudo_bin, int is_csi) {
+    int32_t n_bin = take_i32(cur);
+    uint64_t begin = UINT64_MAX, end = 0;
+    int has_pseudo = 0;
+
+    for (int32_t b=0; b<n_bin && !cur->error; b++) {
+        uint32_t bin = (uint32_t)take_i32(cur);
+        if (is_csi) {
+            take_u64(cur); // loffset
+        }
+        int32_t n_chunk = take_i32(cur);
+        if (bin == pseudo_bin) {
+            // (ref_beg, ref_end) and (n_mapped, n_unmapped)
+            uint64_t ref_beg = take_u64(cur), ref_end = take_u64(cur);
+            take(cur, n_chunk < 2 ? 0 : (uint64_t)(n_chunk - 1) * 16);
+            if (!cur->error) {
+                begin = ref_beg;
+                end = ref_end;
+                has_pseudo = 1;
+            }
+            continue;
+        }
+        for (int32_t c=0; c<n_chunk && !cur->error; c++) {
+            uint64_t chunk_beg = take_u64(cur), chunk_end = take_u64(cur);
+            if (!has_pseudo) {
+                if (chunk_beg < begin) begin = chunk_beg;
+                if (end < chunk_end) end = chunk_end;
+            }
+        }
+    }
+
+    ref->begin = begin == UINT64_MAX ? 0 : begin;
+    ref->end = end;
+}
+
+static int parse_tbi(struct index_cursor *cur, struct vcf_index *index) {
+    int32_t n_ref = take_i32(cur);
+    take(cur, 6 * 4); // format, col_seq, col_beg, col_end, meta, skip
+    if (cur->error || n_ref < 0 || !parse_names(cur, index, n_ref)) {
+        return 0;
+    }
+
+    for (int i=0; i<n_ref && !cur->error; i++) {
+        parse_bins(cur, &(index->refs[i]), TBI_PSEUDO_BIN, 0);
+        int32_t n_intv = take_i32(cur);
+        take(cur, n_intv < 0 ? cur->size : (uint64_t)n_intv * 8);
+    }
+    return !cur->error;
+}
+
+static int parse_csi(struct index_cursor *cur, struct vcf_index *index) {
+    take_i32(cur); // min_shift
+    int32_t depth = take_i32(cur);
+    int32_t l_aux = take_i32(cur);
+    if (cur->error || depth < 0 || 10 < depth || l_aux < 28) {
+        return 0; // names are stored in the tabix-style auxiliary header
+    }
+
+    struct index_cursor aux = {take(cur, l_aux), (uint64_t)l_aux, 0, 0};
+    int32_t n_ref = take_i32(cur);
+    if (cur->error || n_ref < 0) {
+        return 0;
+    }
+    take(&aux, 6 * 4);
+    if (aux.error || !parse_names(&aux, index, n_ref)) {
+        return 0;
+    }
+
+    uint32_t pseudo_bin = (uint32_t)(((1ULL << ((depth + 1) * 3)) - 1) / 7 + 1);
+    for (int i=0; i<n_ref && !cur->error; i++) {
+        parse_bins(cur, &(index->refs[i]), pseudo_bin, 1);
+    }
+    return !cur->error;
+}
+
+int load_vcf_index(const char *vcf_path, struct vcf_index *index) {
+    index->size = 0;
+    index->refs = NULL;
+
+    const char *extensions[2] = {"tbi", "csi"};
+    for (int e=0; e<2; e++) {
+        char index_path[strlen(vcf_path) + 5];
+        snprintf(index_path, sizeof(index_path), "%s.%s", vcf_path, extensions[e]);
+
+        uint64_t size;
+        uint8_t *data = read_index_file(index_path, &size);
+        if (data == NULL) {
+            continue;
+        }
+
+        struct index_cursor cur = {data, size, 0, 0};
+        const uint8_t *magic = take(&cur, 4);
+        int ok = 0;
+        if (magic && memcmp(magic, "TBI\1", 4) == 0) {
+            ok = parse_tbi(&cur, index);
+        } else if (magic && memcmp(magic, "CSI\1", 4) == 0) {
+            ok = parse_csi(&cur, index);
+        }
+        free(data);
+
+        if (ok) {
+            return 1;
+        }
+
+        fprintf(stderr, "[WARN] Couldn't parse VCF index %s, ignoring it.\n", index_path);
+        free_vcf_index(index);
+    }
+
+    return 0;
+}
+
+void free_vcf_index(struct vcf_index *index) {
+    for (int i=0; i<index->size; i++) {
+        free(index->refs[i].name);
+    }
+    free(index->refs);
+    index->size = 0;
+    index->refs = NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef __VCF_INDEX_H__
+#define __VCF_INDEX_H__
+
+#include "bgzf.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TBI_PSEUDO_BIN 37450
+
+/**
+ * Range of the records of a reference sequence in a BGZF compressed VCF.
+ * Offsets are BGZF virtual offsets (compressed block offset << 16 | offset
+ * in the uncompressed block).
+ */
+struct vcf_index_ref {
+    char *name;      /** Name of the reference sequence. */
+    uint64_t begin;  /** Virtual offset of the first record. */
+    uint64_t end;    /** Virtual offset after the last record. */
+};
+
+struct vcf_index {
+    int size;                    /** Number of reference sequences in the index. */
+    struct vcf_index_ref *refs;  /** Ranges of the reference sequences, in index order. */
+};
+
+/**
+ * @brief Loads the tabix (.tbi) or CSI (.csi) index of a VCF file.
+ *
+ * Only the per-reference ranges are kept, bins and linear index are skipped.
+ * `<vcf>.tbi` is tried first, then `<vcf>.csi`.
+ *
+ * @param vcf_path Path to the VCF file.
+ * @param index    A pointer to the `vcf_index` structure to be filled.
+ * @return 1 if an index is loaded, 0 if there is no (valid) index.
+ */
+int load_vcf_index(const char *vcf_path, struct vcf_index *index);
+
+/**
+ * @brief Frees the memory allocated by `load_vcf_index`.
+ */
+void free_vcf_index(struct vcf_index *index);
+
+#endif
@@ -12,31 +12,22 @@
  * on entire chromosome.)
  * 
  */
-void vg_print_seq(struct chr *chrom, int is_rgfa, FILE *out_segment, FILE *out_link) {
+void vg_print_seq(struct chr *chrom, int is_rgfa, gfa_stream_t *out) {
     if (chrom->cores_size) {
-        chrom->ids = NULL; // To print simple path
-        const char *seq_name = chrom->seq_name;
-        const char *seq = chrom->seq;
+        path_ids_free(&(chrom->ids)); // To print simple path
         int cores_size = chrom->cores_size;
         
-        {
-            const struct simple_core *temp_core = &(chrom->cores[0]);
-            uint64_t start = temp_core->start;
-            int seq_len = (int)(temp_core->end - start);
-            print_seq(temp_core->id, seq+start, seq_len, seq_name, start, 0, is_rgfa, out_segment);
-        }
+        print_ref_seq(core_id(chrom, 0), chrom, core_start(chrom, 0), core_end(chrom, 0), is_rgfa, out);
         
-        uint64_t prev_core_id = chrom->cores[0].id;
+        uint64_t prev_core_id = core_id(chrom, 0);
 
         for (int j=1; j<cores_size; j++) {
-            const struct simple_core *temp_core = &(chrom->cores[j]);
-            uint64_t temp_id = temp_core->id;
-            uint64_t temp_start = temp_core->start;
-            int seq_len = (int)(temp_core->end - temp_start);
+            uint64_t temp_id = core_id(chrom, j);
 
-            print_seq(temp_core->id, seq+temp_start, seq_len, seq_name, temp_start, 0, is_rgfa, out_segment);
-            print_link(prev_core_id, '+', temp_core->id, '+', 0, out_link);
+            print_ref_seq(temp_id, chrom, core_start(chrom, j), core_end(chrom, j), is_rgfa, out);
+            print_link(prev_core_id, '+', temp_id, '+', 0, out);
             prev_core_id = temp_id;
+            gfa_stream_sync(out, GFA_STREAM_FLUSH_SIZE);
         }
     }
 }
@@ -119,35 +110,44 @@ void locate_ids(vg_core_bucket_t *bucket, struct simple_core *segments, int segm
 
 /**
  * This function adds the variations that are note part of the current vdg (i.e., outgoing).
- * Note that data is stored in sorted order, based on the positions. The element that is
- * inserted is stored as 64-bit integer, (32-bit ID + 32-bit Pos), which the ID is assigned 
- * by main thread.
+ * Note that data is stored as a binary min-heap, based on the end positions. The id of the 
+ * element is assigned by the producer.
  */
-static inline void add_pending_var_end(uint64_t ** restrict pending_var_ends, int * restrict pending_var_ends_size, int * restrict pending_var_ends_capacity, uint64_t id, uint64_t loc) {
-    int size      = *pending_var_ends_size;
-    int cap       = *pending_var_ends_capacity;
-    uint64_t *arr = *pending_var_ends;
-
-    if (size == cap) {
-        uint64_t *temp = (uint64_t *)realloc(arr, sizeof(uint64_t) * 2 * cap);
+static inline void add_pending_var_end(vg_producer_t *p, uint64_t id, uint64_t loc) {
+    if (p->pending_var_ends_size == p->pending_var_ends_capacity) {
+        vg_pending_end_t *temp = (vg_pending_end_t *)realloc(p->pending_var_ends, sizeof(vg_pending_end_t) * 2 * p->pending_var_ends_capacity);
         if (!temp) { perror("[ERROR] Failed to increase remaining variants array."); abort(); }
-        cap *= 2;
-        arr = temp;
-        *pending_var_ends = arr;
-        *pending_var_ends_capacity = cap;
+        p->pending_var_ends_capacity *= 2;
+        p->pending_var_ends = temp;
     }
 
-    arr[size++] = (id << 32) | (uint32_t)loc;
-
-    int i = size - 1;
-    while (i > 0 && (uint32_t)arr[i - 1] > (uint32_t)arr[i]) {
-        uint64_t t = arr[i - 1];
-        arr[i - 1] = arr[i];
-        arr[i] = t;
-        i--;
+    vg_pending_end_t *heap = p->pending_var_ends;
+    int i = p->pending_var_ends_size++;
+    while (i > 0 && heap[(i - 1) / 2].end > loc) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
+    heap[i] = (vg_pending_end_t){id, loc};
+}
 
-    *pending_var_ends_size = size;
+/**
+ * This function removes and returns the variation with the smallest end position.
+ * The heap must not be empty.
+ */
+static inline vg_pending_end_t pop_pending_var_end(vg_producer_t *p) {
+    vg_pending_end_t *heap = p->pending_var_ends;
+    vg_pending_end_t top   = heap[0];
+    vg_pending_end_t last  = heap[--p->pending_var_ends_size];
+    int size = p->pending_var_ends_size, i = 0;
+    while (2 * i + 1 < size) {
+        int child = 2 * i + 1;
+        if (child + 1 < size && heap[child + 1].end < heap[child].end) child++;
+        if (last.end <= heap[child].end) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
 }
 
 /**
@@ -164,31 +164,48 @@ static inline void move_to_next_core(vg_core_bucket_t *bucket, int chr_idx, int
 }
 
 /**
- * This function creates new bucket data. It initializes a new array to store variatons.
+ * This function opens the next bucket of the batch. Its variations are stored in the
+ * element slab of the batch, right after the ones of the previous bucket.
  * All other necessary information is also initialized.
  */
-static inline vg_core_bucket_t *malloc_vg_core_bucket(int chr_idx, int core_idx, uint64_t curr_id, uint64_t prev_id) {
-    vg_core_bucket_t *bucket = (vg_core_bucket_t *)malloc(sizeof(vg_core_bucket_t));
+static inline vg_core_bucket_t *open_vg_core_bucket(vg_bucket_batch_t *batch, int chr_idx, int core_idx, uint64_t curr_id, uint64_t prev_id) {
+    vg_core_bucket_t *bucket = &(batch->items[batch->count]);
+    vg_element_t *items      = batch->elements;
+    if (batch->count) {
+        items = batch->items[batch->count - 1].items + batch->items[batch->count - 1].size;
+    }
     bucket->chr_idx     = chr_idx;
     bucket->core_idx    = core_idx;
-    bucket->capacity    = DEFAULT_ARRAY_CAPACITY;
+    bucket->span        = 1;
+    bucket->capacity    = batch->element_capacity - (int)(items - batch->elements);
     bucket->size        = 0;
     bucket->curr_id     = curr_id;
     bucket->prev_id     = prev_id;
-    bucket->items       = (vg_element_t *)malloc(sizeof(vg_element_t) * bucket->capacity);
+    bucket->items       = items;
     return bucket;
 }
 
 /**
  * This function checks whether there is any space left to insert variation (element)
- * into bucket->items array. If not, it increases the array by reallocating data.
+ * into the current bucket of the producer. If not, it grows the element slab of the batch
+ * and moves the variations of its buckets to the new slab.
  */
-static inline int check_vg_items(vg_core_bucket_t *bucket) {
+static inline int check_vg_items(vg_producer_t *p) {
+    vg_core_bucket_t *bucket = p->bucket;
     if (bucket->size == bucket->capacity) {
-        bucket->capacity *= 2;
-        vg_element_t *temp = (vg_element_t *)realloc(bucket->items, sizeof(vg_element_t) * bucket->capacity);
+        vg_bucket_batch_t *batch = p->batch;
+        int capacity = batch->element_capacity * 2;
+        vg_element_t *temp = (vg_element_t *)realloc(batch->elements, sizeof(vg_element_t) * capacity);
         if (temp == NULL) return 0;
-        bucket->items = temp;
+        // the open bucket is the last one, right after the filled ones
+        int offset = 0;
+        for (int i = 0; i <= batch->count; i++) {
+            batch->items[i].items = temp + offset;
+            offset += batch->items[i].size;
+        }
+        batch->elements         = temp;
+        batch->element_capacity = capacity;
+        bucket->capacity        = capacity - (int)(bucket->items - temp);
     }
     return 1;
 }
@@ -198,43 +215,56 @@ static inline int check_vg_items(vg_core_bucket_t *bucket) {
  * This function basically assigns incoming variations to the segment if there is any.
  * So, threads can make necesarry linking of incoming variatons (such as del, alt...)
  */
-static inline void add_element_to_bucket(vg_core_bucket_t *bucket, uint64_t *arr, int *arr_size, uint64_t start, uint64_t end) {
-    int i = 0, size = *arr_size;
+static inline void add_element_to_bucket(vg_producer_t *p, uint64_t start, uint64_t end) {
+    vg_core_bucket_t *bucket = p->bucket;
     // If elements in rem_arr lies in this core, add them to vg_data
-    while (i < size && (uint32_t)(arr[i]) < start) {
+    while (p->pending_var_ends_size && p->pending_var_ends[0].end < start) {
         // this only happens when the end point of variation is in masked region (N)
         // if masked regions are represented in segments, no problem will occur
-        fprintf(stderr, "[ERROR] Left element on the way. chrom: %d, var end: %u, core start: %lu\n", bucket->chr_idx, (uint32_t)(arr[i]), start);
-        i++;
+        vg_pending_end_t left = pop_pending_var_end(p);
+        fprintf(stderr, "[ERROR] Left element on the way. chrom: %d, var end: %lu, core start: %lu\n", bucket->chr_idx, left.end, start);
     }
-    while (i < size && (uint32_t)(arr[i]) < end) {
-        check_vg_items(bucket); // check if there is a space to add element
-        bucket->items[bucket->size] = (vg_element_t){VG_DIR_INCOMING, VG_VAR_NONE, arr[i] >> 32, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFF & arr[i], NULL, NULL, 0}; // order not matter here
+    while (p->pending_var_ends_size && p->pending_var_ends[0].end < end) {
+        // check if there is a space to add element, a dropped end would leave the variation unlinked
+        if (!check_vg_items(p)) {
+            fprintf(stderr, "[ERROR] Couldn't allocate memory to bucket elements.\n");
+            exit(EXIT_FAILURE);
+        }
+        vg_pending_end_t incoming = pop_pending_var_end(p);
+        bucket->items[bucket->size] = (vg_element_t){VG_DIR_INCOMING, VG_VAR_NONE, incoming.id, 0xFFFFFFFFFFFFFFFF, incoming.end, NULL, NULL, 0}; // order not matter here
         bucket->size++;
-        i++;
     }
-    // remove first elements by shifting the data to the left
-    if (i && i < size) {
-        memmove(arr, arr+i, (size-i) * sizeof(uint64_t));
+}
+
+/**
+ * Drops `count` references to the chromosome. The thread dropping the last one
+ * prints the path of the chromosome to `out` and frees its sequence, cores and
+ * ids (`--stream`).
+ */
+static void vg_release_chrom(struct ref_seq *seqs, int chr_idx, int64_t count, gfa_stream_t *out) {
+    struct chr *chrom = &(seqs->chrs[chr_idx]);
+    if (atomic_fetch_sub_explicit(&(chrom->path_refs), count, memory_order_acq_rel) != count) {
+        return;
     }
 
-    *arr_size = size - i;
+    uint64_t path_start = stats_now();
+    if (chrom->cores_size) {
+        path_ids_build(&(chrom->ids), chrom->cores_size);
+        print_chr_path(chrom, out);
+    }
+    free_chr_data(seqs, chr_idx);
+    stats_add_time(STATS_PATH_PRINT, stats_now() - path_start);
 }
 
-static inline void vg_print_core_as_is(const struct chr *chr, int chr_idx, int core_idx, struct ref_seq *seqs, int is_rgfa, FILE *out_segment, FILE *out_link) {
-    const struct simple_core *c = &chr->cores[core_idx];
-    uint64_t core_id            = c->id;
-    uint64_t core_start         = c->start;
-    uint64_t core_end           = c->end;
+static inline void vg_print_core_as_is(const struct chr *chr, int core_idx, int is_rgfa, gfa_stream_t *out) {
+    uint64_t id = core_id(chr, core_idx);
 
-    print_seq(core_id, chr->seq + core_start, core_end - core_start, chr->seq_name, core_start, 0, is_rgfa, out_segment);
+    print_ref_seq(id, chr, core_start(chr, core_idx), core_end(chr, core_idx), is_rgfa, out);
 
     // in case it is first lcp core in chromosome
     if (core_idx) {
-        print_link(chr->cores[core_idx - 1].id, '+', core_id, '+', 0, out_link);
+        print_link(id - 1, '+', id, '+', 0, out);
     }
-
-    seqs->chrs[chr_idx].ids[core_idx] = NULL;
 }
 
 // ------------------------------------------------------------------------------------
@@ -243,41 +273,71 @@ static inline void vg_print_core_as_is(const struct chr *chr, int chr_idx, int c
 // ------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------
 
-void vg_queue_init(vg_work_queue_t *queue, int capacity) {
-    queue->batch    = (vg_bucket_batch_t **)malloc(sizeof(vg_bucket_batch_t *) * capacity);
-    queue->size     = 0;
-    queue->capacity = capacity;
-    queue->front    = 0;
-    queue->rear     = 0;
+void vg_queue_init(vg_work_queue_t *queue, int capacity, int free_capacity) {
+    if (!mpmc_init(&(queue->ring), capacity) || !mpmc_init(&(queue->free_batches), free_capacity)) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to work queue.\n");
+        exit(EXIT_FAILURE);
+    }
 }
 
-static inline void vg_queue_push(vg_work_queue_t *queue, vg_bucket_batch_t *batch, vg_queue_sync_t *sync) {
-    pthread_mutex_lock(sync->mutex);
-    while (queue->size == queue->capacity) {
-        pthread_cond_wait(sync->cond_not_full, sync->mutex);
-    }
-    queue->batch[queue->rear] = batch;
-    queue->rear = (queue->rear + 1) % queue->capacity;
-    queue->size++;
-    pthread_cond_signal(sync->cond_not_empty);
-    pthread_mutex_unlock(sync->mutex);
+static inline void free_vg_bucket_batch(vg_bucket_batch_t *batch) {
+    free(batch->elements);
+    free(batch);
 }
 
-static inline vg_bucket_batch_t *vg_queue_pop(vg_work_queue_t *queue, vg_queue_sync_t *sync) {
-    pthread_mutex_lock(sync->mutex);
-    while (queue->size == 0 && *(sync->exit_signal) == 0) {
-        pthread_cond_wait(sync->cond_not_empty, sync->mutex);
+/**
+ * Takes an emptied batch from the free list, or allocates one if there is none.
+ */
+static inline vg_bucket_batch_t *vg_batch_get(vg_work_queue_t *queue) {
+    vg_bucket_batch_t *batch;
+    if (mpmc_try_pop(&(queue->free_batches), (void **)&batch)) {
+        batch->count      = 0;
+        batch->core_count = 0;
+        return batch;
     }
-    if (*(sync->exit_signal) == 1) {
-        pthread_mutex_unlock(sync->mutex);
-        return NULL;
+    batch = (vg_bucket_batch_t *)malloc(sizeof(vg_bucket_batch_t));
+    if (batch == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to bucket batch.\n");
+        exit(EXIT_FAILURE);
     }
-    vg_bucket_batch_t *bucket = queue->batch[queue->front];
-    queue->front = (queue->front + 1) % queue->capacity;
-    queue->size--;
-    pthread_cond_signal(sync->cond_not_full);
-    pthread_mutex_unlock(sync->mutex);
-    return bucket;
+    batch->count            = 0;
+    batch->core_count       = 0;
+    batch->element_capacity = VG_BATCH_ELEMENTS;
+    batch->elements         = (vg_element_t *)malloc(sizeof(vg_element_t) * batch->element_capacity);
+    if (batch->elements == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't allocate memory to bucket batch.\n");
+        exit(EXIT_FAILURE);
+    }
+    return batch;
+}
+
+/**
+ * Gives a processed batch back to the free list so that producers can refill it.
+ */
+static inline void vg_batch_put(vg_work_queue_t *queue, vg_bucket_batch_t *batch) {
+    if (!mpmc_try_push(&(queue->free_batches), batch)) {
+        free_vg_bucket_batch(batch);
+    }
+}
+
+/**
+ * Pushes a batch to the workers and adds the time spent in the call to `*wait_ns`.
+ */
+static inline void vg_queue_push(vg_work_queue_t *queue, vg_bucket_batch_t *batch, vg_queue_sync_t *sync, uint64_t *wait_ns) {
+    uint64_t start = stats_now();
+    mpmc_push(&(queue->ring), batch, sync->not_full, sync->not_empty);
+    stats_queue_size(mpmc_size(&(queue->ring)));
+    *wait_ns += stats_now() - start;
+}
+
+/**
+ * Pops a batch and adds the time spent in the call to `*wait_ns`.
+ */
+static inline vg_bucket_batch_t *vg_queue_pop(vg_work_queue_t *queue, vg_queue_sync_t *sync, uint64_t *wait_ns) {
+    uint64_t start = stats_now();
+    vg_bucket_batch_t *batch = (vg_bucket_batch_t *)mpmc_pop(&(queue->ring), sync->not_full, sync->not_empty, sync->exit_signal);
+    *wait_ns += stats_now() - start;
+    return batch;
 }
 
 // ------------------------------------------------------------------------------------
@@ -290,47 +350,45 @@ void vg_variate_sv(struct t_arg *t_args, uint64_t split_id, uint64_t merge_id, v
 
     uint64_t alt_len = strlen(sv->seq);
  
-	struct lps substr;
-	init_lps_offset(&substr, sv->seq, alt_len, 0);
-	lps_deepen(&substr, t_args->lcp_level);
+    // the cores of recurring alleles come from the cache
+    int cores_size = sv_cache_decompose(t_args->sv_cache, sv->seq, alt_len, t_args->lcp_level, &(t_args->sv_cores), &(t_args->sv_cores_capacity));
+    const struct sv_bound *cores = t_args->sv_cores;
 
-    if (substr.size) {
-        int start = sv->start;
+    if (cores_size) {
+        uint64_t start = sv->start;
         uint64_t prev_id = split_id;
         uint64_t prev_index = 0;
-        if (substr.cores[0].start) {
-            print_seq_vg(t_args->core_id_index, sv->seq, substr.cores[0].start, sv->seq_id, sv->order, start, 1, t_args->is_rgfa, t_args->out1);
-            print_link(prev_id, '+', t_args->core_id_index, '+', 0, t_args->out2);
+        if (cores[0].start) {
+            print_seq_vg(t_args->core_id_index, sv->seq, cores[0].start, sv->seq_id, sv->order, start, 1, t_args->is_rgfa, t_args->stream);
+            print_link(prev_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
             prev_id = t_args->core_id_index;
-            prev_index = substr.cores[0].start;
+            prev_index = cores[0].start;
             t_args->core_id_index++;
         }
-        int lcp_core_end_index = substr.size;
-        if (substr.cores[substr.size-1].end == alt_len)
+        int lcp_core_end_index = cores_size;
+        if (cores[cores_size-1].end == alt_len)
             lcp_core_end_index--;
         
         for(int i=0; i<lcp_core_end_index; i++) {
-            print_seq_vg(t_args->core_id_index, sv->seq+prev_index, substr.cores[i].end-prev_index, sv->seq_id, sv->order, start+prev_index, 1, t_args->is_rgfa, t_args->out1);
-            print_link(prev_id, '+', t_args->core_id_index, '+', 0, t_args->out2);
+            print_seq_vg(t_args->core_id_index, sv->seq+prev_index, cores[i].end-prev_index, sv->seq_id, sv->order, start+prev_index, 1, t_args->is_rgfa, t_args->stream);
+            print_link(prev_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
             prev_id = t_args->core_id_index;
-            prev_index = substr.cores[i].end;
+            prev_index = cores[i].end;
             t_args->core_id_index++;
         }
-        print_seq_vg(sv->id, sv->seq+prev_index, alt_len-prev_index, sv->seq_id, sv->order, start+prev_index, 1, t_args->is_rgfa, t_args->out1);
-        print_link(prev_id, '+', sv->id, '+', 0, t_args->out2);       
+        print_seq_vg(sv->id, sv->seq+prev_index, alt_len-prev_index, sv->seq_id, sv->order, start+prev_index, 1, t_args->is_rgfa, t_args->stream);
+        print_link(prev_id, '+', sv->id, '+', 0, t_args->stream);       
     } else {
-        print_seq_vg(sv->id, sv->seq, alt_len, sv->seq_id, sv->order, sv->start, 1, t_args->is_rgfa, t_args->out1);
-        print_link(split_id, '+', sv->id, '+', 0, t_args->out2);
+        print_seq_vg(sv->id, sv->seq, alt_len, sv->seq_id, sv->order, sv->start, 1, t_args->is_rgfa, t_args->stream);
+        print_link(split_id, '+', sv->id, '+', 0, t_args->stream);
     }
 
     if (merge_id) {
-        print_link(sv->id, '+', merge_id, '+', 0, t_args->out2);
+        print_link(sv->id, '+', merge_id, '+', 0, t_args->stream);
     }
 
     free(sv->seq);
     free(sv->seq_id);
-
-	free_lps(&substr);
 }
 
 // ------------------------------------------------------------------------------------
@@ -344,7 +402,7 @@ void vg_read_vcf_thd(void *args) {
     struct t_arg *t_args = (struct t_arg *)args;
     vg_work_queue_t *queue = (vg_work_queue_t *)t_args->queue;
 
-    if (t_args->out1 == NULL || t_args->out2 == NULL) {
+    if (t_args->stream == NULL) {
         return;
     }
 
@@ -353,32 +411,46 @@ void vg_read_vcf_thd(void *args) {
     snprintf(thread_name, sizeof(thread_name), "worker-%d", t_args->thread_id);
     name_thread(thread_name);
 
-    time_t thread_start;
-    time(&thread_start);
+    uint64_t thread_start = stats_now();
+    t_args->idle_ns = 0;
+
+    // reused for every bucket, grown as needed
+    int split_capacity = 0, segment_capacity = 0;
+    uint64_t *split_points = NULL;
+    struct simple_core *segments = NULL;
 
     while (1) {
-        vg_bucket_batch_t *batch = vg_queue_pop(queue, t_args->sync);
+        vg_bucket_batch_t *batch = vg_queue_pop(queue, t_args->sync, &(t_args->idle_ns));
 		if (batch == NULL) break;
 
         for (int i = 0; i < batch->count; i++) {
             
-            vg_core_bucket_t *bucket = batch->items[i];
+            vg_core_bucket_t *bucket = &(batch->items[i]);
 
             if (bucket->size == 0) {
-                vg_print_core_as_is(&(t_args->seqs->chrs[bucket->chr_idx]), bucket->chr_idx, bucket->core_idx, t_args->seqs, t_args->is_rgfa, t_args->out1, t_args->out2);
-                free(bucket->items); free(bucket);
+                const struct chr *chrom = &(t_args->seqs->chrs[bucket->chr_idx]);
+                for (int k = bucket->core_idx; k < bucket->core_idx + bucket->span; k++) {
+                    vg_print_core_as_is(chrom, k, t_args->is_rgfa, t_args->stream);
+                }
                 continue;
             }
 
             // split LCP core into segments
-            uint64_t *split_points = (uint64_t *)malloc((2 * bucket->size + 2) * sizeof(uint64_t));
+            if (split_capacity < 2 * bucket->size + 2) {
+                split_capacity = 2 * (2 * bucket->size + 2);
+                free(split_points);
+                split_points = (uint64_t *)malloc(split_capacity * sizeof(uint64_t));
+            }
             int size = 0;
             for (int i = 0; i < bucket->size; i++) {
                 if (bucket->items[i].start != 0xFFFFFFFFFFFFFFFF) split_points[size++] = bucket->items[i].start;
                 if (bucket->items[i].end   != 0xFFFFFFFFFFFFFFFF) split_points[size++] = bucket->items[i].end;
             }
-            split_points[size++] = t_args->seqs->chrs[bucket->chr_idx].cores[bucket->core_idx].start;
-            split_points[size++] = t_args->seqs->chrs[bucket->chr_idx].cores[bucket->core_idx].end;
+            const struct chr *chrom = &(t_args->seqs->chrs[bucket->chr_idx]);
+            uint64_t curr_start     = core_start(chrom, bucket->core_idx);
+            uint64_t curr_end       = core_end(chrom, bucket->core_idx);
+            split_points[size++] = curr_start;
+            split_points[size++] = curr_end;
             quicksort(split_points, 0, size - 1); // to remove duplicate locations
 
             int segment_count = 0;
@@ -386,43 +458,37 @@ void vg_read_vcf_thd(void *args) {
                 if (split_points[segment_count] != split_points[i]) split_points[++segment_count] = split_points[i];
             }
 
-            struct simple_core *segments = (struct simple_core *)malloc(sizeof(struct simple_core) * segment_count);
+            if (segment_capacity < segment_count) {
+                segment_capacity = 2 * segment_count;
+                free(segments);
+                segments = (struct simple_core *)malloc(sizeof(struct simple_core) * segment_capacity);
+            }
             // initialize segments data (id, start, end) and print links and segments. 
             // Note: there might be outgoing edge with pre-defined id. Make sure the ids are assigned properly
             // Note: link first segment with bucket->prev_id, give id to last element sizeof(struct simple_core)->curr_id
             if (1 < segment_count) {
-                t_args->seqs->chrs[bucket->chr_idx].ids[bucket->core_idx] = (uint64_t *)malloc(sizeof(uint64_t) * segment_count);
-                const char *seq                     = t_args->seqs->chrs[bucket->chr_idx].seq;
-                const char *seq_name                = t_args->seqs->chrs[bucket->chr_idx].seq_name;
-                const struct simple_core *curr_core = &(t_args->seqs->chrs[bucket->chr_idx].cores[bucket->core_idx]);
-                uint64_t prev_segment_id            = bucket->prev_id;
+                uint64_t *path_ids = path_ids_append(&(t_args->seqs->chrs[bucket->chr_idx].ids), t_args->thread_id - 1, bucket->core_idx, segment_count - 1);
+                uint64_t prev_segment_id = bucket->prev_id;
                 
                 for (int k = 0; k < segment_count - 1; k++) {
                     uint64_t segment_id = set_id(bucket, split_points[k+1], &(t_args->core_id_index));
                     segments[k] = (struct simple_core){segment_id, split_points[k], split_points[k+1]};
                     
-                    print_seq(segment_id, seq + split_points[k], split_points[k + 1] - split_points[k], seq_name, split_points[k], 0, t_args->is_rgfa, t_args->out1);
-                    print_link(prev_segment_id, '+', segment_id, '+', 0, t_args->out2);
+                    print_ref_seq(segment_id, chrom, split_points[k], split_points[k + 1], t_args->is_rgfa, t_args->stream);
+                    print_link(prev_segment_id, '+', segment_id, '+', 0, t_args->stream);
                     
                     prev_segment_id = segment_id;
-                    t_args->seqs->chrs[bucket->chr_idx].ids[bucket->core_idx][k] = segment_id;
+                    path_ids[k] = segment_id;
                 }
-                segments[segment_count - 1]       = (struct simple_core){bucket->curr_id, split_points[segment_count - 1], curr_core->end};
-                
-                print_seq(bucket->curr_id, seq + split_points[segment_count - 1], curr_core->end-split_points[segment_count - 1], seq_name, split_points[segment_count - 1], 0, t_args->is_rgfa, t_args->out1);
-                print_link(prev_segment_id, '+', bucket->curr_id, '+', 0, t_args->out2);
+                segments[segment_count - 1] = (struct simple_core){bucket->curr_id, split_points[segment_count - 1], curr_end};
                 
-                t_args->seqs->chrs[bucket->chr_idx].ids[bucket->core_idx][segment_count - 1] = 0;
+                print_ref_seq(bucket->curr_id, chrom, split_points[segment_count - 1], curr_end, t_args->is_rgfa, t_args->stream);
+                print_link(prev_segment_id, '+', bucket->curr_id, '+', 0, t_args->stream);
             } else {
-                const char *seq                     = t_args->seqs->chrs[bucket->chr_idx].seq;
-                const char *seq_name                = t_args->seqs->chrs[bucket->chr_idx].seq_name;
-                const struct simple_core *curr_core = &(t_args->seqs->chrs[bucket->chr_idx].cores[bucket->core_idx]);
-                segments[0]                         = (struct simple_core){bucket->curr_id, curr_core->start, curr_core->end};
+                segments[0] = (struct simple_core){bucket->curr_id, curr_start, curr_end};
                 
-                print_seq(bucket->curr_id, seq+curr_core->start, curr_core->end-curr_core->start, seq_name, curr_core->start, 0, t_args->is_rgfa, t_args->out1);
-                print_link(bucket->prev_id, '+', bucket->curr_id, '+', 0, t_args->out2);
-                
-                t_args->seqs->chrs[bucket->chr_idx].ids[bucket->core_idx] = NULL;
+                print_ref_seq(bucket->curr_id, chrom, curr_start, curr_end, t_args->is_rgfa, t_args->stream);
+                print_link(bucket->prev_id, '+', bucket->curr_id, '+', 0, t_args->stream);
             }
 
             // iterate through every variation and print segments and links
@@ -432,22 +498,22 @@ void vg_read_vcf_thd(void *args) {
                 case VG_DIR_IN:
                     if (bucket->items[i].var == VG_VAR_SNP) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
-                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
+                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_INS) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
-                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
+                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_INS_SV) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
                         vg_variate_sv(t_args, split_id, merge_id, &(bucket->items[i]));
                     } else if (bucket->items[i].var == VG_VAR_DEL) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', merge_id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', merge_id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_ALT) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
-                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
+                        print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_ALT_SV) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
                         vg_variate_sv(t_args, split_id, merge_id, &(bucket->items[i]));
@@ -456,16 +522,16 @@ void vg_read_vcf_thd(void *args) {
                 case VG_DIR_OUT:
                     if (bucket->items[i].var == VG_VAR_SNP) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_INS) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_INS_SV) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
                         vg_variate_sv(t_args, split_id, 0, &(bucket->items[i]));
                     } else if (bucket->items[i].var == VG_VAR_ALT) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->out2);
+                        print_link(split_id, '+', bucket->items[i].id, '+', 0, t_args->stream);
                     } else if (bucket->items[i].var == VG_VAR_ALT_SV) {
                         locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
                         vg_variate_sv(t_args, split_id, 0, &(bucket->items[i]));
@@ -473,26 +539,37 @@ void vg_read_vcf_thd(void *args) {
                     break;
                 case VG_DIR_INCOMING:
                     locate_ids(bucket, segments, segment_count, bucket->items[i].start, bucket->items[i].end, &split_id, &merge_id);
-                    print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->out2);
+                    print_link(bucket->items[i].id, '+', merge_id, '+', 0, t_args->stream);
                     break;
                 default:
                     fprintf(stderr, "[ERROR] Invalid variation.\n");
                     break;
                 }
             }
+        }
 
-            // cleanup
-            free(bucket->items); free(bucket);
-            free(split_points);  free(segments);
+        // every bucket holds a reference to its chromosome, released per run of buckets
+        if (t_args->stream_paths) {
+            int run_start = 0;
+            for (int i = 1; i <= batch->count; i++) {
+                if (i == batch->count || batch->items[i].chr_idx != batch->items[run_start].chr_idx) {
+                    vg_release_chrom(t_args->seqs, batch->items[run_start].chr_idx, i - run_start, t_args->stream);
+                    run_start = i;
+                }
+            }
         }
 
-        free(batch);
+        vg_batch_put(queue, batch);
+
+        gfa_stream_sync(t_args->stream, GFA_STREAM_FLUSH_SIZE);
     }
 
-    time_t thread_end;
-    time(&thread_end);
+    free(split_points);
+    free(segments);
 
-    t_args->exec_time = difftime(thread_end, thread_start);
+    t_args->busy_ns = stats_now() - thread_start - t_args->idle_ns;
+    stats_add_thread("worker", t_args->thread_id, t_args->busy_ns, t_args->idle_ns);
+    stats_add_time(STATS_QUEUE_WAIT, t_args->idle_ns);
 }
 
 // ------------------------------------------------------------------------------------
@@ -501,392 +578,622 @@ void vg_read_vcf_thd(void *args) {
 // ------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------
 
-static inline vg_bucket_batch_t *malloc_vg_bucket_batch(void) {
-    vg_bucket_batch_t *batch = (vg_bucket_batch_t *)malloc(sizeof(vg_bucket_batch_t));
-    batch->count = 0;
-    memset(batch->items, 0, sizeof(batch->items));
-    return batch;
-}
-
-static inline void reset_vg_bucket_batch(vg_bucket_batch_t *b) {
-    b->count = 0;
-    memset(b->items, 0, sizeof(b->items));
-}
+static inline void handle_current_bucket(vg_producer_t *p) {
+    vg_bucket_batch_t *batch = p->batch;
+    vg_core_bucket_t *last   = batch->count ? &(batch->items[batch->count - 1]) : NULL;
 
-static inline void handle_current_bucket(vg_work_queue_t *queue, vg_bucket_batch_t **batch, vg_core_bucket_t **bucket, vg_queue_sync_t *sync,
-                                         struct chr *curr_chr, int chr_idx, int *core_idx, uint64_t *pending_var_ends, int *pending_var_ends_size) {
-    // vg_queue_push(queue, *bucket, sync);
-    (*batch)->items[(*batch)->count++] = *bucket;
+    // the current bucket is already in place, close it. a core without variations
+    // extends the run of untouched cores right before it, if any
+    if (p->bucket->size == 0 && last != NULL && last->size == 0 &&
+        last->chr_idx == p->bucket->chr_idx && last->core_idx + last->span == p->bucket->core_idx) {
+        last->span++;
+    } else {
+        batch->count++;
+        if (p->stream_paths) {
+            atomic_fetch_add_explicit(&(p->curr_chr->path_refs), 1, memory_order_relaxed);
+        }
+    }
+    batch->core_count++;
 
-    if ((*batch)->count == VG_BUCKET_BATCH) {
-        vg_queue_push(queue, *batch, sync);
-        *batch = malloc_vg_bucket_batch();  // start fresh batch
+    if (batch->count == VG_BUCKET_BATCH || batch->core_count == VG_BATCH_CORES) {
+        vg_queue_push(p->queue, p->batch, p->sync, &(p->wait_ns));
+        p->batch = vg_batch_get(p->queue);  // start fresh batch
     }
 
-    (*core_idx)++;
-    if ((*core_idx) < curr_chr->cores_size) {
-        *bucket = malloc_vg_core_bucket(chr_idx, *core_idx, curr_chr->cores[*core_idx].id, curr_chr->cores[(*core_idx) - 1].id);
-        add_element_to_bucket(*bucket, pending_var_ends, pending_var_ends_size, curr_chr->cores[*core_idx].start, curr_chr->cores[*core_idx].end);
+    p->core_idx++;
+    if (p->core_idx < p->curr_chr->cores_size) {
+        p->bucket = open_vg_core_bucket(p->batch, p->chr_idx, p->core_idx, core_id(p->curr_chr, p->core_idx), core_id(p->curr_chr, p->core_idx - 1));
+        add_element_to_bucket(p, core_start(p->curr_chr, p->core_idx), core_end(p->curr_chr, p->core_idx));
     } else {
-        *bucket = malloc_vg_core_bucket(chr_idx, 0, 0, 0);
+        p->bucket = open_vg_core_bucket(p->batch, p->chr_idx, 0, 0, 0);
     }
 }
 
-static inline void flush_batch_if_needed(vg_work_queue_t *queue, vg_bucket_batch_t **batch, vg_queue_sync_t *sync) {
+static inline void flush_batch_if_needed(vg_work_queue_t *queue, vg_bucket_batch_t **batch, vg_queue_sync_t *sync, uint64_t *wait_ns) {
     if (*batch && (*batch)->count > 0) {
-        vg_queue_push(queue, *batch, sync);
+        vg_queue_push(queue, *batch, sync, wait_ns);
         *batch = NULL;
     } else if (*batch) {
-        free(*batch);
+        vg_batch_put(queue, *batch);
         *batch = NULL;
     }
 }
 
-void vg_read_vcf(struct opt_arg *args, struct ref_seq *seqs) {
-
-    printf("[INFO] Processing variations...\n");
-
-    FILE *out_segment = NULL, *out_link = NULL;
-    open_files(args, &out_segment, &out_link);
-
-    // create thread arguments
-    struct t_arg *t_args = (struct t_arg*)malloc(sizeof(struct t_arg) * args->thread_number);
-    pthread_mutex_t queue_mutex   = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t cond_not_full  = PTHREAD_COND_INITIALIZER;
-    pthread_cond_t cond_not_empty = PTHREAD_COND_INITIALIZER;
-    pthread_mutex_init(&queue_mutex, NULL);
-    pthread_cond_init(&cond_not_full, NULL);
-    pthread_cond_init(&cond_not_empty, NULL);
-    int exit_signal = 0;
+/**
+ * Prints the node of a variation with the next id of the producer.
+ */
+static inline void vg_print_var_seq(vg_producer_t *p, const char *seq, uint64_t seq_len, const char *seq_id, int order, uint64_t start) {
+    print_seq_vg(p->core_id_index, seq, seq_len, seq_id, order, start, 1, p->is_rgfa, p->out);
+}
 
-    vg_queue_sync_t sync = {
-        .mutex = &queue_mutex,
-        .cond_not_full = &cond_not_full,
-        .cond_not_empty = &cond_not_empty,
-        .exit_signal = &exit_signal
-    };
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
+//      PRODUCER
+// ------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------
 
-    vg_work_queue_t queue;
-    vg_queue_init(&queue, args->tload_factor * args->thread_number);
+/**
+ * Positions the producer at the first LCP core of the given chromosome and allocates
+ * its bucket, batch and pending variation ends.
+ */
+static void vg_producer_start(vg_producer_t *p, int chr_idx) {
+    p->chr_idx     = chr_idx;
+    p->core_idx    = 0;
+    p->chrom_index = chr_idx;
+    p->curr_chr    = &(p->seqs->chrs[chr_idx]);
+    p->batch       = vg_batch_get(p->queue);
+    p->bucket      = open_vg_core_bucket(p->batch, chr_idx, 0, core_id(p->curr_chr, 0), 0);
+
+    p->pending_var_ends_capacity = 256;
+    p->pending_var_ends_size     = 0;
+    p->pending_var_ends          = (vg_pending_end_t *)malloc(p->pending_var_ends_capacity * sizeof(vg_pending_end_t));
+    p->line_count                = 0;
+    p->wait_ns                   = 0;
+    dedup_window_init(&(p->dedup_window));
+}
 
-    for (int i = 0; i < args->thread_number; i++) {
-        char indexed_seg_filename[strlen(args->gfa_path) + 7];
-        snprintf(indexed_seg_filename, sizeof(indexed_seg_filename), "%s.s.%d", args->gfa_path, i + 1);
-        open_file_w(&(t_args[i].out1), indexed_seg_filename);
+/**
+ * Pushes the remaining LCP cores of the current chromosome and releases the
+ * producer's buffers.
+ */
+static void vg_producer_finish(vg_producer_t *p) {
+    while (p->core_idx < p->curr_chr->cores_size) {
+        // if there is anything to push as a job into the pool, then push it (previous core's data)
+        handle_current_bucket(p);
+    }
 
-        char indexed_lin_filename[strlen(args->gfa_path) + 7];
-        snprintf(indexed_lin_filename, sizeof(indexed_lin_filename), "%s.l.%d", args->gfa_path, i + 1);
-        open_file_w(&(t_args[i].out2), indexed_lin_filename);
+    // variations after the last core of the chromosome have no bucket to be processed
+    for (int i = 0; i < p->bucket->size; i++) {
+        free(p->bucket->items[i].seq);
+        free(p->bucket->items[i].seq_id);
+    }
+    p->bucket = NULL;
 
-        t_args[i].core_id_index  = ((uint64_t)(i + 1) << 32) + 1;
-        t_args[i].thread_id      = i + 1;
-        t_args[i].lcp_level      = args->lcp_level;
-        t_args[i].is_rgfa        = args->is_rgfa;
-        t_args[i].no_overlap     = args->no_overlap;
-        t_args[i].seqs           = seqs;
-        t_args[i].exec_time      = 0;
-        t_args[i].queue          = (void*)&(queue);
-        t_args[i].sync           = &sync;
-        t_args[i].out_log_mutex  = NULL;
+    if (p->stream_paths) {
+        vg_release_chrom(p->seqs, p->chr_idx, 1, p->out);
     }
 
-    name_thread("main");
+    flush_batch_if_needed(p->queue, &(p->batch), p->sync, &(p->wait_ns));
 
-    struct tpool *tm = tpool_create(args->thread_number);
+    free(p->pending_var_ends);
+    p->pending_var_ends = NULL;
 
-    for (int i = 0; i < args->thread_number; i++) {
-        tpool_add_work(tm, vg_read_vcf_thd, t_args + i);
+    stats_add_dedup(p->dedup_window.merged);
+    dedup_window_free(&(p->dedup_window));
+}
+
+/**
+ * Parses a VCF record and adds its alleles to the bucket of the LCP core they lie in.
+ * Buckets of the cores passed are pushed to the workers.
+ */
+static void vg_producer_process_line(vg_producer_t *p, char *line) {
+    struct ref_seq *seqs = p->seqs;
+
+    // parse the `line`
+    char *chrom, *index, *id, *ref, *alt;
+    size_t offset;
+
+    char *saveptr;
+    chrom = strtok_r(line, "\t", &saveptr); // get chromosome name
+    if (strcmp(chrom, seqs->chrs[p->chrom_index].seq_name) != 0) {
+        int chrom_index = find_chr(seqs, chrom);
+        // if the chromosome is not found (rare or if VCF is not compatible with fasta)
+        // or it is before the current chromosome, which is already printed
+        if (chrom_index < p->chr_idx) return;
+        p->chrom_index = chrom_index;
     }
 
-    uint64_t current_size = 1048576;
-    char *line = (char *)malloc(current_size);
+    p->line_count++;
 
-    FILE *file;
-    open_file_r(&file, args->vcf_path);
-
-    int line_count = 0;
-
-    int pending_var_ends_capacity = 256;
-    int pending_var_ends_size = 0;
-    uint64_t *pending_var_ends = (uint64_t *)malloc(pending_var_ends_capacity * sizeof(uint64_t)); // id+end
-
-    int chr_idx = 0, core_idx = 0, chrom_index = 0;
-    struct chr *curr_chr = &(seqs->chrs[chr_idx]);
-    vg_bucket_batch_t *batch = malloc_vg_bucket_batch();
-    vg_core_bucket_t *bucket = malloc_vg_core_bucket(chr_idx, core_idx, seqs->chrs[chr_idx].cores[core_idx].id, 0);
-    curr_chr->ids = (uint64_t **)malloc(curr_chr->cores_size * sizeof(uint64_t *));
-
-    time_t main_start;
-    time(&main_start);
-
-    while (fgets(line, current_size, file) != NULL) {
-        size_t len = strlen(line);
-        int skip_line = 0;
-        // read the line and fit it to `line`
-        while (len == current_size - 1 && line[len - 1] != '\n') {
-            current_size *= 2;
-            char *temp_line = (char *)realloc(line, current_size);
-            if (!temp_line) {
-                fprintf(stderr, "[ERROR] Memory reallocation failed.\n");
-                free(line); free(pending_var_ends); free(bucket->items); free(bucket); fclose(file);
-                return;
-            }
-            line = temp_line;
+    index   = strtok_r(NULL, "\t", &saveptr);   // get index  
+    offset  = strtol(index, NULL, 10) - 1;      // get offset
+    id      = strtok_r(NULL, "\t", &saveptr);   // get ID
+    ref     = strtok_r(NULL, "\t", &saveptr);   // get REF
+    alt     = strtok_r(NULL, "\t", &saveptr);   // get ALT alleles
 
-            if (fgets(line + len, current_size - len, file) == NULL) {
-                skip_line = 1; break;
-            }
-            len = strlen(line);
+    // If we move to next lcp core, push array if there are elements and create new array
+    if (p->chrom_index == p->chr_idx && core_end(p->curr_chr, p->core_idx) <= offset) {
+        while (p->core_idx < p->curr_chr->cores_size && core_end(p->curr_chr, p->core_idx) <= offset) {
+            handle_current_bucket(p);
         }
-        // validate `line`
-        if (skip_line || len < 2 || line[0] == '#') continue;
-        if (line[len - 1] == '\n') { line[len - 1] = '\0'; len--; }
-        line_count++;
-
-        // parse the `line`
-        char *chrom, *index, *id, *ref, *alt;
-        size_t offset;
-
-        char *saveptr;
-        chrom = strtok_r(line, "\t", &saveptr); // get chromosome name
-        if (strcmp(chrom, seqs->chrs[chrom_index].seq_name) != 0) {
-            if (chrom_index + 1 < seqs->size && strcmp(chrom, seqs->chrs[chrom_index + 1].seq_name) == 0) { // if it continues with right next chromosome
-                chrom_index++;
-            } else { // search right chromosome from the beggining
-                chrom_index = -1;
-                for (int i = chr_idx; i < seqs->size; i++) {
-                    if (strcmp(chrom, seqs->chrs[i].seq_name) == 0) { chrom_index = i; break; }
-                }
-                // if the chromosome is not found (rare or if VCF is not compatible with fasta)
-                if (chrom_index == -1) continue;
-            }
+    } else if (p->chrom_index != p->chr_idx) {
+        // it seems that the vcf file moved to new chromosome. then, print remaining lcp cores on prev chrom
+        while (p->core_idx < p->curr_chr->cores_size) {
+            handle_current_bucket(p);
         }
+        if (p->stream_paths) {
+            vg_release_chrom(seqs, p->chr_idx, 1, p->out);
+        }
+        p->chr_idx++;
         
-        index   = strtok_r(NULL, "\t", &saveptr);   // get index  
-        offset  = strtol(index, NULL, 10) - 1;      // get offset
-        id      = strtok_r(NULL, "\t", &saveptr);   // get ID
-        ref     = strtok_r(NULL, "\t", &saveptr);   // get REF
-        alt     = strtok_r(NULL, "\t", &saveptr);   // get ALT alleles
-
-        // If we move to next lcp core, push array if there are elements and create new array
-        if (chrom_index == chr_idx && curr_chr->cores[core_idx].end <= offset) {
-            while (core_idx < curr_chr->cores_size && curr_chr->cores[core_idx].end <= offset) {
-                handle_current_bucket(&queue, &batch, &bucket, &sync, curr_chr, chr_idx, &core_idx, pending_var_ends, &pending_var_ends_size);
-            }
-        } else if (chrom_index != chr_idx) {
-            // it seems that the vcf file moved to new chromosome. then, print remaining lcp cores on prev chrom
-            while (core_idx < curr_chr->cores_size) {
-                handle_current_bucket(&queue, &batch, &bucket, &sync, curr_chr, chr_idx, &core_idx, pending_var_ends, &pending_var_ends_size);
+        // if there is a chromosomal jump (e.g., from chr1 to chr4), print chr2 and chr3
+        while (p->chr_idx < p->chrom_index) {
+            vg_print_seq(&(seqs->chrs[p->chr_idx]), p->is_rgfa, p->out);
+            if (p->stream_paths) {
+                vg_release_chrom(seqs, p->chr_idx, 1, p->out);
             }
-            chr_idx++;
-            
-            // if there is a chromosomal jump (e.g., from chr1 to chr4), print chr2 and chr3
-            while (chr_idx < chrom_index) {
-                vg_print_seq(&(seqs->chrs[chr_idx]), args->is_rgfa, out_segment, out_link);
-                chr_idx++;
-            }
-            
-            // reset chromosome and index info as it is a new chromosome
-            chr_idx = chrom_index;
-            core_idx = 0;
-            curr_chr = &(seqs->chrs[chr_idx]);
-            curr_chr->ids = (uint64_t **)malloc(curr_chr->cores_size * sizeof(uint64_t *));
+            p->chr_idx++;
+        }
+        
+        // reset chromosome and index info as it is a new chromosome
+        p->chr_idx = p->chrom_index;
+        p->core_idx = 0;
+        p->curr_chr = &(seqs->chrs[p->chr_idx]);
             
-            // move bucket data to correct position
-            while (core_idx < curr_chr->cores_size && curr_chr->cores[core_idx].end <= offset) {
-                vg_print_core_as_is(curr_chr, chr_idx, core_idx, seqs, args->is_rgfa, out_segment, out_link);
-                core_idx++;
-            }
-
-            // reset bucket data
-            bucket->chr_idx  = chrom_index;
-            bucket->core_idx = core_idx;
-            bucket->prev_id  = core_idx ? curr_chr->cores[core_idx - 1].id : 0;
-            bucket->curr_id  = curr_chr->cores[core_idx].id;
+        // move bucket data to correct position
+        while (p->core_idx < p->curr_chr->cores_size && core_end(p->curr_chr, p->core_idx) <= offset) {
+            vg_print_core_as_is(p->curr_chr, p->core_idx, p->is_rgfa, p->out);
+            p->core_idx++;
         }
 
-        // ALT can be multi-allelic; store one element per ALT if you want
-        size_t rlen = strlen(ref);
-        size_t alen = strlen(alt);
-        int order = 0;
+        // reset bucket data
+        p->bucket->chr_idx  = p->chrom_index;
+        p->bucket->core_idx = p->core_idx;
+        p->bucket->prev_id  = p->core_idx ? core_id(p->curr_chr, p->core_idx - 1) : 0;
+        p->bucket->curr_id  = core_id(p->curr_chr, p->core_idx);
+    }
 
-        if (rlen > 1 && alen == 1) {
-            char *ref_saveptr;
-            char *ref_token = strtok_r(ref, ",", &ref_saveptr); // split REF alleles by comma (it is rare but in case it happens)
-            while (ref_token != NULL) {
-                if (!check_vg_items(bucket)) break;
+    vg_core_bucket_t *bucket = p->bucket;
+    const struct simple_core core = {core_id(p->curr_chr, p->core_idx), core_start(p->curr_chr, p->core_idx), core_end(p->curr_chr, p->core_idx)};
 
-                size_t tlen = strlen(ref_token);
-                
-                if (offset + tlen < curr_chr->cores[core_idx].end) { // DEL inside
-                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_DEL, 0, offset + 1, offset + tlen, NULL, NULL, order};
-                    bucket->size++;
-                } else if (offset + 1 < curr_chr->cores[core_idx].end) { // it starts inside
-                    add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + tlen);
-                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_DEL, args->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order};
-                    bucket->size++;
-                    args->core_id_index++;
-                } else {
-                    add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, curr_chr->cores[core_idx].id, offset + tlen);
-                }
-                
+    // ALT can be multi-allelic; store one element per ALT if you want
+    size_t rlen = strlen(ref);
+    size_t alen = strlen(alt);
+    int order = 0;
+
+    if (rlen > 1 && alen == 1) {
+        char *ref_saveptr;
+        char *ref_token = strtok_r(ref, ",", &ref_saveptr); // split REF alleles by comma (it is rare but in case it happens)
+        while (ref_token != NULL) {
+            if (!check_vg_items(p)) break;
+
+            size_t tlen = strlen(ref_token);
+
+            // the same deletion is already in the graph
+            if (p->dedup && !dedup_window_add(&(p->dedup_window), p->chrom_index, offset, tlen, alt, alen)) {
                 ref_token = strtok_r(NULL, ",", &ref_saveptr);
                 order++;
+                continue;
             }
-            continue;
+            
+            if (offset + tlen < core.end) { // DEL inside
+                bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_DEL, 0, offset + 1, offset + tlen, NULL, NULL, order};
+                bucket->size++;
+            } else if (offset + 1 < core.end) { // it starts inside
+                add_pending_var_end(p, p->core_id_index, offset + tlen);
+                bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_DEL, p->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order};
+                bucket->size++;
+                p->core_id_index++;
+            } else {
+                add_pending_var_end(p, core.id, offset + tlen);
+            }
+            
+            ref_token = strtok_r(NULL, ",", &ref_saveptr);
+            order++;
         }
+        return;
+    }
+
+    char *alt_saveptr;
+    char *alt_token = strtok_r(alt, ",", &alt_saveptr); // split ALT alleles by comma
+    while (alt_token != NULL) {
+        if (!check_vg_items(p)) break;
 
-        char *alt_saveptr;
-        char *alt_token = strtok_r(alt, ",", &alt_saveptr); // split ALT alleles by comma
-        while (alt_token != NULL) {
-            if (!check_vg_items(bucket)) break;
+        size_t tlen = strlen(alt_token);
 
-            size_t tlen = strlen(alt_token);
+        // the same allele is already in the graph
+        if (p->dedup && !dedup_window_add(&(p->dedup_window), p->chrom_index, offset, rlen, alt_token, tlen)) {
+            alt_token = strtok_r(NULL, ",", &alt_saveptr);
+            order++;
+            continue;
+        }
 
-            if (rlen == 1 && tlen == 1) { // SNP
-                if (offset + 1 < curr_chr->cores[core_idx].end) {
-                    print_seq_vg(args->core_id_index, alt_token, 1, id, order, offset, 1, args->is_rgfa, out_segment);
-                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_SNP, args->core_id_index, offset, offset + 1, NULL, NULL, order}; // id assigned for segment
+        if (rlen == 1 && tlen == 1) { // SNP
+            if (offset + 1 < core.end) {
+                vg_print_var_seq(p, alt_token, 1, id, order, offset);
+                bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_SNP, p->core_id_index, offset, offset + 1, NULL, NULL, order}; // id assigned for segment
+            } else {
+                add_pending_var_end(p, p->core_id_index, offset + 1);
+                vg_print_var_seq(p, alt_token, 1, id, order, offset);
+                bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_SNP, p->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order}; // id assigned for segment
+            }
+            bucket->size++;
+            p->core_id_index++;
+        } else if (1 == rlen) { // INS
+            // Small insertion
+            if (tlen / 2 < core.end - core.start) {
+                vg_print_var_seq(p, alt_token + 1, tlen - 1, id, order, offset);
+                if (offset + 1 < core.end) {
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_INS, p->core_id_index, offset + 1, offset + 1, NULL, NULL, order}; // id assigned for segment         
                 } else {
-                    add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + 1);
-                    print_seq_vg(args->core_id_index, alt_token, 1, id, order, offset, 1, args->is_rgfa, out_segment);
-                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_SNP, args->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order}; // id assigned for segment
+                    add_pending_var_end(p, p->core_id_index, offset + 1);
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_INS, p->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order}; // id assigned for segment
                 }
                 bucket->size++;
-                args->core_id_index++;
-            } else if (1 == rlen) { // INS
-                // Small insertion
-                if (tlen / 2 < curr_chr->cores[core_idx].end - curr_chr->cores[core_idx].start) {
-                    print_seq_vg(args->core_id_index, alt_token + 1, tlen - 1, id, order, offset, 1, args->is_rgfa, out_segment);
-                    if (offset + 1 < curr_chr->cores[core_idx].end) {
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_INS, args->core_id_index, offset + 1, offset + 1, NULL, NULL, order}; // id assigned for segment         
-                    } else {
-                        add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + 1);
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_INS, args->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order}; // id assigned for segment
-                    }
-                    bucket->size++;
-                    args->core_id_index++;
-                } else {  // Large INS, to be processed with LCP
-                    char *alt_token_copy = strdup(alt_token);
-                    char *seq_id = strdup(id);
-                    if (offset + 1 < curr_chr->cores[core_idx].end) { // if inside of the lcp core
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_INS_SV, args->core_id_index, offset + 1, offset + 1, alt_token_copy, seq_id, order};
-                    } else { // if in the edge of the end of the lcp core
-                        add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + 1);
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_INS_SV, args->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, alt_token_copy, seq_id, order};
-                    }
-                    bucket->size++;
-                    args->core_id_index++;
+                p->core_id_index++;
+            } else {  // Large INS, to be processed with LCP
+                char *alt_token_copy = strdup(alt_token);
+                char *seq_id = strdup(id);
+                if (offset + 1 < core.end) { // if inside of the lcp core
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_INS_SV, p->core_id_index, offset + 1, offset + 1, alt_token_copy, seq_id, order};
+                } else { // if in the edge of the end of the lcp core
+                    add_pending_var_end(p, p->core_id_index, offset + 1);
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_INS_SV, p->core_id_index, offset + 1, 0xFFFFFFFFFFFFFFFF, alt_token_copy, seq_id, order};
                 }
-            } else { // ALT
-                if (tlen / 2 < curr_chr->cores[core_idx].end - curr_chr->cores[core_idx].start) { // alteration, simply print the underling string
-                    print_seq_vg(args->core_id_index, alt_token, tlen, id, order, offset, 1, args->is_rgfa, out_segment);
-                    if (offset + rlen < curr_chr->cores[core_idx].end) {
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_ALT, args->core_id_index, offset, offset + rlen, NULL, NULL, order};
-                    } else {
-                        add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + rlen);
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_ALT, args->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order};
-                    }
-                    bucket->size++;
-                    args->core_id_index++;
-                } else { // check if it the alt_token requires LCP processing
-                    char *alt_token_copy = strdup(alt_token);
-                    char *seq_id = strdup(id);
-                    if (offset + rlen < curr_chr->cores[core_idx].end) {
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_ALT_SV, args->core_id_index, offset, offset + rlen, alt_token_copy, seq_id, order};
-                    } else {
-                        add_pending_var_end(&pending_var_ends, &pending_var_ends_size, &pending_var_ends_capacity, args->core_id_index, offset + rlen);
-                        bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_ALT_SV, args->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, alt_token_copy, seq_id, order};
-                    }
-                    bucket->size++;
-                    args->core_id_index++;
+                bucket->size++;
+                p->core_id_index++;
+            }
+        } else { // ALT
+            if (tlen / 2 < core.end - core.start) { // alteration, simply print the underling string
+                vg_print_var_seq(p, alt_token, tlen, id, order, offset);
+                if (offset + rlen < core.end) {
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_ALT, p->core_id_index, offset, offset + rlen, NULL, NULL, order};
+                } else {
+                    add_pending_var_end(p, p->core_id_index, offset + rlen);
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_ALT, p->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, NULL, NULL, order};
                 }
+                bucket->size++;
+                p->core_id_index++;
+            } else { // check if it the alt_token requires LCP processing
+                char *alt_token_copy = strdup(alt_token);
+                char *seq_id = strdup(id);
+                if (offset + rlen < core.end) {
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_IN, VG_VAR_ALT_SV, p->core_id_index, offset, offset + rlen, alt_token_copy, seq_id, order};
+                } else {
+                    add_pending_var_end(p, p->core_id_index, offset + rlen);
+                    bucket->items[bucket->size] = (vg_element_t){VG_DIR_OUT, VG_VAR_ALT_SV, p->core_id_index, offset, 0xFFFFFFFFFFFFFFFF, alt_token_copy, seq_id, order};
+                }
+                bucket->size++;
+                p->core_id_index++;
             }
-            alt_token = strtok_r(NULL, ",", &alt_saveptr);
-            order++;
         }
+        alt_token = strtok_r(NULL, ",", &alt_saveptr);
+        order++;
     }
+}
 
-    // handle remaining LCP cores
-    while (core_idx < curr_chr->cores_size) {
-        // if there is anything to push as a job into the pool, then push it (previous core's data)
-        handle_current_bucket(&queue, &batch, &bucket, &sync, curr_chr, chr_idx, &core_idx, pending_var_ends, &pending_var_ends_size);
+/**
+ * Reads the whole VCF with a single producer (the calling thread).
+ */
+static void vg_read_vcf_serial(struct opt_arg *args, vg_producer_t *p) {
+
+    uint64_t start = stats_now();
+
+    bgzf_file_t *file = bgzf_open(args->vcf_path, args->thread_number);
+    if (file == NULL) {
+        fprintf(stderr, "[ERROR] Couldn't open file %s\n", args->vcf_path);
+        exit(EXIT_FAILURE);
     }
-    
-    if (batch->count) {
-        flush_batch_if_needed(&queue, &batch, &sync);
-    } else {
-        free(batch);
+
+    uint64_t current_size = 1048576;
+    char *line = (char *)malloc(current_size);
+
+    vg_producer_start(p, 0);
+
+    int64_t len;
+    while ((len = bgzf_getline(file, &line, &current_size)) != -1) {
+        // validate `line`
+        if (len < 2 || line[0] == '#') continue;
+        if (line[len - 1] == '\r') { line[len - 1] = '\0'; len--; }
+
+        vg_producer_process_line(p, line);
+        gfa_stream_sync(p->out, GFA_STREAM_FLUSH_SIZE);
     }
 
-    chr_idx++;
+    vg_producer_finish(p);
+
     // print remaining chromosomes if any
-    while (chr_idx < seqs->size) {
-        vg_print_seq(&(seqs->chrs[chr_idx]), args->is_rgfa, out_segment, out_link);
-        chr_idx++;
+    for (int chr_idx = p->chr_idx + 1; chr_idx < p->seqs->size; chr_idx++) {
+        vg_print_seq(&(p->seqs->chrs[chr_idx]), args->is_rgfa, p->out);
+        if (p->stream_paths) {
+            vg_release_chrom(p->seqs, chr_idx, 1, p->out);
+        }
+    }
+
+    args->core_id_index = p->core_id_index;
+
+    bgzf_close(file);
+    free(line);
+
+    stats_add_thread("producer", 0, stats_now() - start - p->wait_ns, p->wait_ns);
+    stats_add_time(STATS_QUEUE_WAIT, p->wait_ns);
+}
+
+/**
+ * Producer of a shard. Seeks to the first record of the shard's chromosome and
+ * processes the records until the chromosome changes.
+ */
+static void vg_read_vcf_shard(void *arg) {
+
+    vg_shard_t *shard = (vg_shard_t *)arg;
+    vg_producer_t *p = &(shard->producer);
+    const char *chrom = p->seqs->chrs[shard->chr_idx].seq_name;
+    size_t chrom_len = strlen(chrom);
+
+    name_thread("producer");
+
+    uint64_t start = stats_now();
+
+    // shards print to their own stream, appended to the same file
+    gfa_stream_t out;
+    gfa_stream_open(&out, p->out->file);
+    p->out = &out;
+
+    bgzf_file_t *file = bgzf_open(shard->vcf_path, 1);
+    if (file == NULL || bgzf_seek(file, shard->begin) != 0) {
+        fprintf(stderr, "[ERROR] Couldn't seek to %s in %s\n", chrom, shard->vcf_path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t current_size = 1048576;
+    char *line = (char *)malloc(current_size);
+
+    vg_producer_start(p, shard->chr_idx);
+
+    int64_t len;
+    while ((len = bgzf_getline(file, &line, &current_size)) != -1) {
+        // validate `line`
+        if (len < 2 || line[0] == '#') continue;
+        if (line[len - 1] == '\r') { line[len - 1] = '\0'; len--; }
+        if (strncmp(line, chrom, chrom_len) != 0 || line[chrom_len] != '\t') break; // records of the chromosome are contiguous
+
+        vg_producer_process_line(p, line);
+        gfa_stream_sync(p->out, GFA_STREAM_FLUSH_SIZE);
+    }
+
+    vg_producer_finish(p);
+    gfa_stream_close(&out);
+
+    bgzf_close(file);
+    free(line);
+
+    stats_add_thread("shard", shard->chr_idx, stats_now() - start - p->wait_ns, p->wait_ns);
+    stats_add_time(STATS_QUEUE_WAIT, p->wait_ns);
+}
+
+static int compare_shards_by_chrom(const void *a, const void *b) {
+    return ((const vg_shard_t *)a)->chr_idx - ((const vg_shard_t *)b)->chr_idx;
+}
+
+static int compare_shards_by_size(const void *a, const void *b) {
+    uint64_t size_a = ((const vg_shard_t *)a)->end - ((const vg_shard_t *)a)->begin;
+    uint64_t size_b = ((const vg_shard_t *)b)->end - ((const vg_shard_t *)b)->begin;
+    return (size_a < size_b) - (size_a > size_b); // largest first
+}
+
+/**
+ * Reads the VCF with one producer per chromosome, using the tabix/CSI index to
+ * locate the records of each chromosome. Each producer owns its buckets and pending
+ * variation ends; the ids of its variations are drawn from a separate range.
+ *
+ * @return 1 if the VCF is processed, 0 if it cannot be sharded.
+ */
+static int vg_read_vcf_sharded(struct opt_arg *args, const vg_producer_t *base, const struct vcf_index *index) {
+
+    struct ref_seq *seqs = base->seqs;
+
+    bgzf_file_t *file = bgzf_open(args->vcf_path, 1);
+    int is_bgzf = file != NULL && file->format == BGZF_BGZF;
+    bgzf_close(file);
+    if (!is_bgzf) {
+        return 0;
     }
-    fclose(file);
 
-    pthread_mutex_lock(sync.mutex);
-    while (queue.size > 0) { 
-        pthread_cond_wait(sync.cond_not_full, sync.mutex);
+    vg_shard_t *shards = (vg_shard_t *)malloc((index->size ? index->size : 1) * sizeof(vg_shard_t));
+    int *has_shard = (int *)calloc(seqs->size, sizeof(int));
+    int shard_count = 0;
+
+    for (int i = 0; i < index->size; i++) {
+        if (index->refs[i].end <= index->refs[i].begin) continue; // no record
+
+        int chr_idx = find_chr(seqs, index->refs[i].name);
+        if (chr_idx == -1 || has_shard[chr_idx] || seqs->chrs[chr_idx].cores_size == 0) continue;
+
+        has_shard[chr_idx] = 1;
+        shards[shard_count].producer = *base;
+        shards[shard_count].vcf_path = args->vcf_path;
+        shards[shard_count].chr_idx  = chr_idx;
+        shards[shard_count].begin    = index->refs[i].begin;
+        shards[shard_count].end      = index->refs[i].end;
+        shard_count++;
+    }
+
+    if (shard_count == 0) {
+        free(shards);
+        free(has_shard);
+        return 0;
+    }
+
+    // chromosomes without variations are printed before the producers share the outputs
+    for (int i = 0; i < seqs->size; i++) {
+        if (!has_shard[i]) {
+            vg_print_seq(&(seqs->chrs[i]), args->is_rgfa, base->out);
+            if (base->stream_paths) {
+                vg_release_chrom(seqs, i, 1, base->out);
+            }
+        }
     }
-    pthread_mutex_unlock(sync.mutex);
 
-    exit_signal = 1;
-    pthread_cond_broadcast(sync.cond_not_empty);
+    // id ranges are given in chromosome order after the ranges of the workers
+    qsort(shards, shard_count, sizeof(vg_shard_t), compare_shards_by_chrom);
+    for (int i = 0; i < shard_count; i++) {
+        shards[i].producer.core_id_index = ((uint64_t)(args->thread_number + i + 1) << 32) + 1;
+    }
+    qsort(shards, shard_count, sizeof(vg_shard_t), compare_shards_by_size);
+
+    int producer_number = shard_count < args->thread_number ? shard_count : args->thread_number;
+    printf("[INFO] Processing %d chromosomes with %d producers.\n", shard_count, producer_number);
+
+    struct tpool *tm = tpool_create(producer_number);
+    for (int i = 0; i < shard_count; i++) {
+        tpool_add_work(tm, vg_read_vcf_shard, shards + i);
+    }
     tpool_wait(tm);
     tpool_destroy(tm);
-    pthread_mutex_destroy(sync.mutex);
-    pthread_cond_destroy(sync.cond_not_full);
-    pthread_cond_destroy(sync.cond_not_empty);
 
-    time_t main_end;
-    time(&main_end);
+    free(shards);
+    free(has_shard);
+
+    return 1;
+}
+
+void vg_read_vcf(struct opt_arg *args, struct ref_seq *seqs, gfa_file_t *gfa) {
+
+    printf("[INFO] Processing variations...\n");
+
+    const char *header = "H\tVN:Z:1.1\n";
+    gfa_file_append(gfa, header, strlen(header));
+
+    gfa_stream_t out;
+    gfa_stream_open(&out, gfa);
+
+    // create thread arguments
+    struct t_arg *t_args = (struct t_arg*)malloc(sizeof(struct t_arg) * args->thread_number);
+    eventcount_t not_full, not_empty;
+    ec_init(&not_full);
+    ec_init(&not_empty);
+    int exit_signal = 0;
+
+    vg_queue_sync_t sync = {
+        .not_full = &not_full,
+        .not_empty = &not_empty,
+        .exit_signal = &exit_signal
+    };
+
+    vg_work_queue_t queue;
+    vg_queue_init(&queue, args->tload_factor * args->thread_number, (args->tload_factor + 1) * args->thread_number + 2);
+
+    gfa_stream_t *streams = (gfa_stream_t *)malloc(sizeof(gfa_stream_t) * args->thread_number);
+    struct sv_cache *sv_cache = sv_cache_create(args->sv_cache_mb << 20);
+
+    for (int i = 0; i < args->thread_number; i++) {
+        gfa_stream_open(&(streams[i]), gfa);
+        t_args[i].stream = &(streams[i]);
+
+        t_args[i].core_id_index  = ((uint64_t)(i + 1) << 32) + 1;
+        t_args[i].thread_id      = i + 1;
+        t_args[i].lcp_level      = args->lcp_level;
+        t_args[i].is_rgfa        = args->is_rgfa;
+        t_args[i].no_overlap     = args->no_overlap;
+        t_args[i].seqs           = seqs;
+        t_args[i].busy_ns        = 0;
+        t_args[i].idle_ns        = 0;
+        t_args[i].queue          = (void*)&(queue);
+        t_args[i].sync           = &sync;
+        t_args[i].out_log_mutex  = NULL;
+        t_args[i].sv_cache       = sv_cache;
+        t_args[i].sv_cores       = NULL;
+        t_args[i].sv_cores_capacity = 0;
+        t_args[i].stream_paths   = args->stream_paths;
+    }
+
+    name_thread("main");
+
+    struct tpool *tm = tpool_create(args->thread_number);
+
+    for (int i = 0; i < args->thread_number; i++) {
+        tpool_add_work(tm, vg_read_vcf_thd, t_args + i);
+    }
+
+    uint64_t main_start = stats_now();
+
+    vg_producer_t producer = {
+        .seqs          = seqs,
+        .queue         = &queue,
+        .sync          = &sync,
+        .out           = &out,
+        .is_rgfa       = args->is_rgfa,
+        .core_id_index = args->core_id_index,
+        .dedup         = args->dedup,
+        .stream_paths  = args->stream_paths
+    };
+
+    // the producer holds a reference to every chromosome until it has passed it
+    for (int i = 0; i < seqs->size; i++) {
+        atomic_store_explicit(&(seqs->chrs[i].path_refs), 1, memory_order_relaxed);
+        path_ids_init(&(seqs->chrs[i].ids), args->thread_number);
+    }
+
+    // with an index, chromosomes are parsed by several producers at once
+    struct vcf_index index;
+    int is_sharded = 0;
+    if (1 < args->thread_number && load_vcf_index(args->vcf_path, &index)) {
+        is_sharded = vg_read_vcf_sharded(args, &producer, &index);
+        free_vcf_index(&index);
+    }
+    if (!is_sharded) {
+        vg_read_vcf_serial(args, &producer);
+    }
+
+    mpmc_wait_empty(&(queue.ring), sync.not_full);
+
+    __atomic_store_n(&exit_signal, 1, __ATOMIC_RELEASE);
+    ec_notify(sync.not_empty);
+    tpool_wait(tm);
+    tpool_destroy(tm);
+    ec_destroy(sync.not_full);
+    ec_destroy(sync.not_empty);
 
     for (int i = 0; i < args->thread_number; i++) {
-        fclose(t_args[i].out1);
-        fclose(t_args[i].out2);
+        gfa_stream_close(&(streams[i]));
+        free(t_args[i].sv_cores);
     }
+    gfa_stream_close(&out);
+    free(streams);
     free(t_args);
+    sv_cache_destroy(sv_cache);
+
+    uint64_t main_end = stats_now();
+    stats_add_time(STATS_VCF_READ, main_end - main_start);
 
-    printf("[INFO] VCF processing completed in %0.2f sec.\n", difftime(main_end, main_start));
+    if (args->dedup) {
+        printf("[INFO] Merged %lu duplicate alleles.\n", stats_get_dedup());
+    }
+    printf("[INFO] VCF processing completed in %0.2f sec.\n", (main_end - main_start) / 1e9);
 
-    while (queue.size) {
+    vg_bucket_batch_t *left_batch;
+    while (mpmc_try_pop(&(queue.ring), (void **)&left_batch)) {
         fprintf(stderr, "[WARN] Left work in the queue.\n"); // should not happen
-        vg_bucket_batch_t *batch = queue.batch[queue.front];
-        queue.front = (queue.front + 1) % queue.capacity;
-        queue.size--;
+        vg_bucket_batch_t *batch = left_batch;
         if (batch) {
             for (int j = 0; j < batch->count; j++) {
-                vg_core_bucket_t *bucket = batch->items[j];
+                vg_core_bucket_t *bucket = &(batch->items[j]);
                 for (int i = 0; i < bucket->size; i++) {
                     if (bucket->items[i].seq != NULL)    free(bucket->items[i].seq);
                     if (bucket->items[i].seq_id != NULL) free(bucket->items[i].seq_id);
                 }
-                free(bucket->items);
-                free(bucket);
             }
-            free(batch);
+            free_vg_bucket_batch(batch);
         }
     }
-    free(queue.batch);
-    free(line);
-
-    free(pending_var_ends);
-    
-    // print path
-    FILE *out_path;
-    char path_filename[strlen(args->gfa_path)+5];
-    snprintf(path_filename, sizeof(path_filename), "%s.p", args->gfa_path);
-    out_path = fopen(path_filename, "w");
-    if (out_path == NULL) {
-        fprintf(stderr, "[ERROR] Couldn't open path file\n");
-        exit(EXIT_FAILURE);
+    while (mpmc_try_pop(&(queue.free_batches), (void **)&left_batch)) {
+        free_vg_bucket_batch(left_batch);
     }
-
-    print_path(seqs, out_path);
-    fclose(out_path);
-    fclose(out_segment);
-    fclose(out_link);
+    mpmc_free(&(queue.ring));
+    mpmc_free(&(queue.free_batches));
+    
+    // print path, after all segments and links
+    uint64_t path_start = stats_now();
+    print_path(seqs, gfa, args->thread_number);
+    stats_add_time(STATS_PATH_PRINT, stats_now() - path_start);
 }
\ No newline at end of file
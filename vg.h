@@ -7,7 +7,10 @@
 
 #include "struct_def.h"
 #include "utils.h"
+#include "fa_parser.h"
 #include "tpool.h"
+#include "bgzf.h"
+#include "vcf_index.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -15,8 +18,6 @@
 #include <sys/prctl.h>
 #endif
 
-#define DEFAULT_ARRAY_CAPACITY 10
-
 /**
  * @brief Reads a VCF file, processes variations, and logs output to files.
  *
@@ -30,7 +31,8 @@
  *             including the path to the VCF file.
  * @param seqs A pointer to the `ref_seq` structure holding the reference 
  *             sequences for variation processing.
+ * @param gfa  The output rGFA/GFA file that all threads append to.
  */
-void vg_read_vcf(struct opt_arg *args, struct ref_seq *seqs);
+void vg_read_vcf(struct opt_arg *args, struct ref_seq *seqs, gfa_file_t *gfa);
 
 #endif
\ No newline at end of file
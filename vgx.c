@@ -1,130 +1,197 @@
 #include "vgx.h"
 
-void line_queue_init(struct line_queue *queue, int capacity) {
-    queue->lines = (char **)malloc(capacity * sizeof(char *));
-    queue->size = 0;
-    queue->capacity = capacity;
-    queue->front = 0;
-    queue->rear = 0;
+void line_queue_init(struct line_queue *queue, int capacity, int free_capacity) {
+    if (!mpmc_init(&(queue->ring), capacity) || !mpmc_init(&(queue->free_chunks), free_capacity)) {
+        fprintf(stderr, "VCF: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void line_queue_free(struct line_queue *queue) {
+    struct line_chunk *chunk;
+    while (mpmc_try_pop(&(queue->ring), (void **)&chunk)) {
+        free(chunk->data);
+        free(chunk);
+    }
+    while (mpmc_try_pop(&(queue->free_chunks), (void **)&chunk)) {
+        free(chunk->data);
+        free(chunk);
+    }
+    mpmc_free(&(queue->ring));
+    mpmc_free(&(queue->free_chunks));
+}
+
+void line_queue_push(struct line_queue *queue, struct line_chunk *chunk, vg_queue_sync_t *sync, uint64_t *wait_ns) {
+    uint64_t start = stats_now();
+    mpmc_push(&(queue->ring), chunk, sync->not_full, sync->not_empty);
+    stats_queue_size(mpmc_size(&(queue->ring)));
+    *wait_ns += stats_now() - start;
+}
+
+struct line_chunk *line_queue_pop(struct line_queue *queue, vg_queue_sync_t *sync, uint64_t *wait_ns) {
+    uint64_t start = stats_now();
+    struct line_chunk *chunk = (struct line_chunk *)mpmc_pop(&(queue->ring), sync->not_full, sync->not_empty, sync->exit_signal);
+    *wait_ns += stats_now() - start;
+    return chunk;
+}
+
+/**
+ * Takes an empty chunk from the free list, or allocates one if the list is empty.
+ */
+static inline struct line_chunk *line_chunk_get(struct line_queue *queue) {
+    struct line_chunk *chunk;
+    if (mpmc_try_pop(&(queue->free_chunks), (void **)&chunk)) {
+        chunk->size = 0;
+        return chunk;
+    }
+    chunk = (struct line_chunk *)malloc(sizeof(struct line_chunk));
+    if (chunk == NULL) {
+        fprintf(stderr, "VCF: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    chunk->capacity = VGX_CHUNK_SIZE;
+    chunk->size = 0;
+    chunk->data = (char *)malloc(chunk->capacity);
+    if (chunk->data == NULL) {
+        fprintf(stderr, "VCF: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return chunk;
 }
 
-void line_queue_push(struct line_queue *queue, char *line, vg_queue_sync_t *sync) {
-    pthread_mutex_lock(sync->mutex);
-    while (queue->size == queue->capacity) {
-        pthread_cond_wait(sync->cond_not_full, sync->mutex);
+/**
+ * Gives a processed chunk back to the free list so that reader can refill it.
+ */
+static inline void line_chunk_put(struct line_queue *queue, struct line_chunk *chunk) {
+    if (!mpmc_try_push(&(queue->free_chunks), chunk)) {
+        free(chunk->data);
+        free(chunk);
     }
-    queue->lines[queue->rear] = line;
-    queue->rear = (queue->rear + 1) % queue->capacity;
-    queue->size++;
-    pthread_cond_signal(sync->cond_not_empty);
-    pthread_mutex_unlock(sync->mutex);
 }
 
-char *line_queue_pop(struct line_queue *queue, vg_queue_sync_t *sync) {
-    pthread_mutex_lock(sync->mutex);
-    while (queue->size == 0 && *(sync->exit_signal) == 0) {
-        pthread_cond_wait(sync->cond_not_empty, sync->mutex);
+/**
+ * Start of the trailing lines of `data[0..size)` that have the same CHROM and
+ * POS as the last one, so that the records of a position are never split
+ * between two chunks (and workers) with `--dedup`. Returns `size` if all the
+ * lines share the position. `data` ends with a newline.
+ */
+static uint64_t same_position_start(const char *data, uint64_t size) {
+    const char *last = (const char *)memrchr(data, '\n', size - 1);
+    last = last == NULL ? data : last + 1;
+
+    const char *tab = (const char *)memchr(last, '\t', data + size - last);
+    if (tab != NULL) {
+        tab = (const char *)memchr(tab + 1, '\t', data + size - tab - 1);
+    }
+    if (tab == NULL) {
+        return size;
     }
-    if (*(sync->exit_signal) == 1) {
-        pthread_mutex_unlock(sync->mutex);
-        return NULL;
+    uint64_t key_len = tab - last + 1; // "CHROM\tPOS\t"
+
+    const char *start = last;
+    while (data < start) {
+        const char *prev = (const char *)memrchr(data, '\n', start - 1 - data);
+        prev = prev == NULL ? data : prev + 1;
+        if ((uint64_t)(start - prev) <= key_len || memcmp(prev, last, key_len) != 0) {
+            break;
+        }
+        start = prev;
     }
-    char *line = queue->lines[queue->front];
-    queue->front = (queue->front + 1) % queue->capacity;
-    queue->size--;
-    pthread_cond_signal(sync->cond_not_full);
-    pthread_mutex_unlock(sync->mutex);
-    return line;
+
+    return start == data ? size : (uint64_t)(start - data);
 }
 
 void vgx_variate_snp(struct t_arg *t_args, const struct chr *chrom, const char *alt_token, const char *seq_name, int order, uint64_t start_loc, uint64_t end_loc, uint64_t splitting_core_id, uint64_t merging_core_id, uint64_t marginal_start, uint64_t marginal_end, int merge_overlap) {
 
+    // reference between the splitting and merging cores, decoded if the reference is packed
+    const char *margin_seq = chr_seq_slice(chrom, marginal_start, MAX(marginal_end, end_loc) - marginal_start, &(t_args->ref_buf), &(t_args->ref_buf_capacity));
+
 	// print new node connecting directly from latest core before and first core after the alternating token
-    print_seq3_vg(t_args->core_id_index, chrom->seq+marginal_start, start_loc-marginal_start, 
+    print_seq3_vg(t_args->core_id_index, margin_seq, start_loc-marginal_start, 
                                          alt_token, strlen(alt_token), 
-                                         chrom->seq+end_loc, marginal_end-end_loc,
-                                         seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->out1);
+                                         margin_seq+(end_loc-marginal_start), marginal_end-end_loc,
+                                         seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->stream);
     // print splitting link
-    print_link(splitting_core_id, '+', t_args->core_id_index, '+', 0, t_args->out1);
+    print_link(splitting_core_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
 	// print merging link
-    print_link(t_args->core_id_index, '+', merging_core_id, '+', merge_overlap, t_args->out1);
+    print_link(t_args->core_id_index, '+', merging_core_id, '+', merge_overlap, t_args->stream);
     t_args->core_id_index++;
 }
 
 void vgx_variate_sv(struct t_arg *t_args, const struct chr *chrom, const char *alt_token, const char *seq_name, int order, uint64_t start_loc, uint64_t end_loc, uint64_t splitting_core_id, uint64_t merging_core_id, uint64_t marginal_start, uint64_t marginal_end, int merge_overlap) {
 
     uint64_t alt_len = strlen(alt_token);
+    // reference between the splitting and merging cores, decoded if the reference is packed
+    const char *margin_seq = chr_seq_slice(chrom, marginal_start, MAX(marginal_end, end_loc) - marginal_start, &(t_args->ref_buf), &(t_args->ref_buf_capacity));
  
-	struct lps substr;
-	init_lps_offset(&substr, alt_token, alt_len, 0);
-	lps_deepen(&substr, t_args->lcp_level);
+    // the cores of recurring alleles come from the cache
+    int cores_size = sv_cache_decompose(t_args->sv_cache, alt_token, alt_len, t_args->lcp_level, &(t_args->sv_cores), &(t_args->sv_cores_capacity));
+    const struct sv_bound *cores = t_args->sv_cores;
 
-    if (substr.size == 0) {
+    if (cores_size == 0) {
         // print first splitting node and link from reference graph	
-        print_seq3_vg(t_args->core_id_index, chrom->seq+marginal_start, start_loc-marginal_start,
+        print_seq3_vg(t_args->core_id_index, margin_seq, start_loc-marginal_start,
                                              alt_token, strlen(alt_token),
-                                             chrom->seq+end_loc, marginal_end-end_loc,
-                                             seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->out1);
+                                             margin_seq+(end_loc-marginal_start), marginal_end-end_loc,
+                                             seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->stream);
         // print splitting link
-        print_link(splitting_core_id, '+', t_args->core_id_index, '+', 0, t_args->out1);
+        print_link(splitting_core_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
         // print merging link
-        print_link(t_args->core_id_index, '+', merging_core_id, '+', merge_overlap, t_args->out1);
+        print_link(t_args->core_id_index, '+', merging_core_id, '+', merge_overlap, t_args->stream);
         t_args->core_id_index++;
     } else {
         // print new node in between latest core before alternating core and first core in alternating core
         uint64_t prev_core_id = splitting_core_id;
-        if (start_loc-marginal_start+substr.cores[0].start) {
-            print_seq2_vg(t_args->core_id_index, chrom->seq+marginal_start, start_loc-marginal_start,
-                                                 alt_token, substr.cores[0].start,
-                                                 seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->out1);
+        if (start_loc-marginal_start+cores[0].start) {
+            print_seq2_vg(t_args->core_id_index, margin_seq, start_loc-marginal_start,
+                                                 alt_token, cores[0].start,
+                                                 seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->stream);
             // print link between splitting segment with reference
-            print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->out1);
+            print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
             prev_core_id = t_args->core_id_index;
             t_args->core_id_index++;
         }
 
         // print LCP cores
         if (t_args->no_overlap) {
-            uint64_t prev_end = substr.cores[0].start;
-            for (int i=0; i<substr.size; i++) {
-                int start = maximum(prev_end, substr.cores[i].start); // if alt seq have gaps (NNN)
-                int core_len = substr.cores[i].end-start;
-                print_seq_vg(t_args->core_id_index, alt_token+start, core_len, seq_name, order, start_loc+start, 1, t_args->is_rgfa, t_args->out1);
-                print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->out1);
+            uint64_t prev_end = cores[0].start;
+            for (int i=0; i<cores_size; i++) {
+                uint64_t start = maximum(prev_end, cores[i].start); // if alt seq have gaps (NNN)
+                uint64_t core_len = cores[i].end-start;
+                print_seq_vg(t_args->core_id_index, alt_token+start, core_len, seq_name, order, start_loc+start, 1, t_args->is_rgfa, t_args->stream);
+                print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
                 prev_core_id = t_args->core_id_index;
                 t_args->core_id_index++;
-                prev_end = substr.cores[i].end;
+                prev_end = cores[i].end;
             }
         } else {
-            uint64_t prev_end = substr.cores[0].start;
-            for (int i=0; i<substr.size; i++) {
-                int start = substr.cores[i].start;
-                int core_len = substr.cores[i].end-start;
-                int overlap = prev_end >= substr.cores[i].start ? prev_end-substr.cores[i].start : 0;
-                print_seq_vg(t_args->core_id_index, alt_token+start, core_len, seq_name, order, start_loc+start, 1, t_args->is_rgfa, t_args->out1);
-                print_link(prev_core_id, '+', t_args->core_id_index, '+', overlap, t_args->out1);
+            uint64_t prev_end = cores[0].start;
+            for (int i=0; i<cores_size; i++) {
+                uint64_t start = cores[i].start;
+                uint64_t core_len = cores[i].end-start;
+                int overlap = prev_end >= cores[i].start ? prev_end-cores[i].start : 0;
+                print_seq_vg(t_args->core_id_index, alt_token+start, core_len, seq_name, order, start_loc+start, 1, t_args->is_rgfa, t_args->stream);
+                print_link(prev_core_id, '+', t_args->core_id_index, '+', overlap, t_args->stream);
                 prev_core_id = t_args->core_id_index;
                 t_args->core_id_index++;
-                prev_end = substr.cores[i].end;
+                prev_end = cores[i].end;
             }
         }
 
-        if (alt_len-substr.cores[substr.size-1].end+marginal_end-end_loc) {
+        if (alt_len-cores[cores_size-1].end+marginal_end-end_loc) {
             // create merging segment in between last core in alternating token and reference sequence.
-            print_seq2_vg(t_args->core_id_index, alt_token+substr.cores[substr.size-1].end, alt_len-substr.cores[substr.size-1].end,
-                                                 chrom->seq+end_loc, marginal_end-end_loc,
-                                                 seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->out1);
+            print_seq2_vg(t_args->core_id_index, alt_token+cores[cores_size-1].end, alt_len-cores[cores_size-1].end,
+                                                 margin_seq+(end_loc-marginal_start), marginal_end-end_loc,
+                                                 seq_name, order, marginal_start, 1, t_args->is_rgfa, t_args->stream);
 
-            print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->out1);
+            print_link(prev_core_id, '+', t_args->core_id_index, '+', 0, t_args->stream);
             prev_core_id = t_args->core_id_index;
             t_args->core_id_index++;
         }
 
         // print merging link
-        print_link(prev_core_id, '+', merging_core_id, '+', merge_overlap, t_args->out1);
+        print_link(prev_core_id, '+', merging_core_id, '+', merge_overlap, t_args->stream);
     }
-
-	free_lps(&substr);
 }
 
 uint64_t vgx_variate(struct t_arg *t_args, const struct chr *chrom, const char *org_seq, const char *alt_token, const char *seq_name, int order, uint64_t start_loc, uint64_t start_index) {
@@ -135,29 +202,29 @@ uint64_t vgx_variate(struct t_arg *t_args, const struct chr *chrom, const char *
 	uint64_t first_core_after;
 	find_boundaries(start_loc, end_loc, chrom, start_index, &latest_core_index, &first_core_after);
 
-	if (latest_core_index == 0 || chrom->cores[latest_core_index].end < chrom->cores[latest_core_index+1].start)  {
+	if (latest_core_index == 0 || core_end(chrom, latest_core_index) < core_start(chrom, latest_core_index+1))  {
         t_args->failed_var_count += 1;
         pthread_mutex_lock(t_args->out_log_mutex);
-        fprintf(t_args->out2, "VARIATE-MARGIN-START:\tCHROM: %s,\tPOSITION: %ld,\tORG: %s,\tALT: %s,\tlatest_core_index: %ld\n", chrom->seq_name, start_loc, org_seq, alt_token, latest_core_index);
-        fflush(t_args->out2);
+        fprintf(t_args->out_log, "VARIATE-MARGIN-START:\tCHROM: %s,\tPOSITION: %ld,\tORG: %s,\tALT: %s,\tlatest_core_index: %ld\n", chrom->seq_name, start_loc, org_seq, alt_token, latest_core_index);
+        fflush(t_args->out_log);
         pthread_mutex_unlock(t_args->out_log_mutex);
 		return start_index;
 	}
-	if (first_core_after+1 >= (uint64_t)chrom->cores_size || chrom->cores[first_core_after-1].end < chrom->cores[first_core_after].start) {
+	if (first_core_after+1 >= (uint64_t)chrom->cores_size || core_end(chrom, first_core_after-1) < core_start(chrom, first_core_after)) {
         t_args->failed_var_count += 1;
         pthread_mutex_lock(t_args->out_log_mutex);
-        fprintf(t_args->out2, "VARIATE-MARGIN-END:\tCHROM: %s,\tPOSITION: %ld,\tORG: %s,\tALT: %s,\tfirst_core_after: %ld,\tcores_size: %d\n", chrom->seq_name, start_loc, org_seq, alt_token, first_core_after, chrom->cores_size);
-        fflush(t_args->out2);
+        fprintf(t_args->out_log, "VARIATE-MARGIN-END:\tCHROM: %s,\tPOSITION: %ld,\tORG: %s,\tALT: %s,\tfirst_core_after: %ld,\tcores_size: %d\n", chrom->seq_name, start_loc, org_seq, alt_token, first_core_after, chrom->cores_size);
+        fflush(t_args->out_log);
         pthread_mutex_unlock(t_args->out_log_mutex);
 		return start_index;
 	}
 
     // get the chromosome
-    uint64_t marginal_start = chrom->cores[latest_core_index].end; // start of variation
-    uint64_t marginal_end = chrom->cores[first_core_after-1].end;  // end of variation
-    uint64_t splitting_core_id = chrom->cores[latest_core_index].id;
-    uint64_t merging_core_id = chrom->cores[first_core_after].id;
-    int merge_overlap = chrom->cores[first_core_after-1].end - chrom->cores[first_core_after].start;
+    uint64_t marginal_start = core_end(chrom, latest_core_index); // start of variation
+    uint64_t marginal_end = core_end(chrom, first_core_after-1);  // end of variation
+    uint64_t splitting_core_id = core_id(chrom, latest_core_index);
+    uint64_t merging_core_id = core_id(chrom, first_core_after);
+    int merge_overlap = core_end(chrom, first_core_after-1) - core_start(chrom, first_core_after);
 
     t_args->bubble_count += 1;
 
@@ -170,94 +237,120 @@ uint64_t vgx_variate(struct t_arg *t_args, const struct chr *chrom, const char *
     return latest_core_index;
 }
 
-void vgx_read_vcf_thd(void *args) {
+static void vgx_process_line(struct t_arg *t_args, char *line, int *latest_chrom_index, uint64_t *latest_core_index) {
 
-    struct t_arg *t_args = (struct t_arg *)args;
-    struct line_queue *queue = (struct line_queue *)t_args->queue;
+    char *chrom, *index, *id, *seq, *alt;
+    long offset;
 
-    uint64_t latest_core_index = 0;
-    int latest_chrom_index = 0;
+    char *saveptr;
+    chrom = strtok_r(line, "\t", &saveptr); // get chromosome name
+    index = strtok_r(NULL, "\t", &saveptr); // get index  
+    if (index == NULL) {
+        t_args->invalid_line_count += 1;
+        pthread_mutex_lock(t_args->out_log_mutex);
+        fprintf(t_args->out_log, "VCF: no index at line: %s\n", line);
+        fflush(t_args->out_log);
+        pthread_mutex_unlock(t_args->out_log_mutex);
+        return;
+    }
 
-    while (1) {
-        // split the line by tab characters
-        char *line = line_queue_pop(queue, t_args->sync);
-        if (line == NULL) {
-            break;
-        }
+    offset = strtol(index, NULL, 10) - 1; // get offset
+    id = strtok_r(NULL, "\t", &saveptr);  // skip ID
+    seq = strtok_r(NULL, "\t", &saveptr); // get sequence
+    alt = strtok_r(NULL, "\t", &saveptr); // get ALT alleles
 
-        char *chrom, *index, *id, *seq, *alt;
-        long offset;
+    int chrom_index = find_chr(t_args->seqs, chrom);
 
-        char *saveptr;
-        chrom = strtok_r(line, "\t", &saveptr); // get chromosome name
-        index = strtok_r(NULL, "\t", &saveptr); // get index  
-        if (index == NULL) {
-            t_args->invalid_line_count += 1;
-            pthread_mutex_lock(t_args->out_log_mutex);
-            fprintf(t_args->out2, "VCF: no index at line: %s\n", line);
-            fflush(t_args->out2);
-            pthread_mutex_unlock(t_args->out_log_mutex);
-            free(line);
-            continue;
-        }
+    if (chrom_index == -1) {
+        t_args->invalid_line_count += 1;
+        pthread_mutex_lock(t_args->out_log_mutex);
+        fprintf(t_args->out_log, "VCF: Couldn't locate chrom %s from VCF in reference\n", chrom);
+        fflush(t_args->out_log);
+        pthread_mutex_unlock(t_args->out_log_mutex);
+        return;
+    }
 
-        offset = strtol(index, NULL, 10) - 1; // get offset
-        id = strtok_r(NULL, "\t", &saveptr);  // skip ID
-        seq = strtok_r(NULL, "\t", &saveptr); // get sequence
-        alt = strtok_r(NULL, "\t", &saveptr); // get ALT alleles
+    if (*latest_chrom_index != chrom_index) {
+        *latest_chrom_index = chrom_index;
+        *latest_core_index = 0;
+    }
 
-        int chrom_index = -1;
-        for (int i=0; i<t_args->seqs->size; i++) {
-            if (strcmp(chrom, t_args->seqs->chrs[i].seq_name) == 0) {
-                chrom_index = i;
-                break;
-            }
+    char *alt_saveptr;
+    char *alt_token = strtok_r(alt, ",", &alt_saveptr); // split ALT alleles by comma
+    int order = 0;
+
+    while (alt_token != NULL) {
+        // the same allele is already in the graph
+        if (t_args->dedup && !dedup_window_add(&(t_args->dedup_window), chrom_index, offset, strlen(seq), alt_token, strlen(alt_token))) {
+            alt_token = strtok_r(NULL, ",", &alt_saveptr);
+            order++;
+            continue;
         }
 
-        if (chrom_index == -1) {
-            t_args->invalid_line_count += 1;
+        char *alt_token_copy = strdup(alt_token); 
+        if (alt_token_copy == NULL) {
+            t_args->failed_var_count += 1;
             pthread_mutex_lock(t_args->out_log_mutex);
-            fprintf(t_args->out2, "VCF: Couldn't locate chrom %s from VCF in reference\n", chrom);
-            fflush(t_args->out2);
+            fprintf(t_args->out_log, "VCF: Memory allocation failed for alt_token_copy.\n");
+            fflush(t_args->out_log);
             pthread_mutex_unlock(t_args->out_log_mutex);
-            free(line);
             continue;
         }
+        *latest_core_index = vgx_variate(t_args, &(t_args->seqs->chrs[chrom_index]), seq, alt_token_copy, id, order, offset, *latest_core_index);
+        free(alt_token_copy);
+
+        alt_token = strtok_r(NULL, ",", &alt_saveptr);
+        order++;
+    }
+}
+
+void vgx_read_vcf_thd(void *args) {
+
+    struct t_arg *t_args = (struct t_arg *)args;
+    struct line_queue *queue = (struct line_queue *)t_args->queue;
+
+    uint64_t latest_core_index = 0;
+    int latest_chrom_index = 0;
+    uint64_t thread_start = stats_now();
 
-        if (latest_chrom_index != chrom_index) {
-            latest_chrom_index = chrom_index;
-            latest_core_index = 0;
+    while (1) {
+        struct line_chunk *chunk = line_queue_pop(queue, t_args->sync, &(t_args->idle_ns));
+        if (chunk == NULL) {
+            break;
         }
 
-        char *alt_saveptr;
-        char *alt_token = strtok_r(alt, ",", &alt_saveptr); // split ALT alleles by comma
-        int order = 0;
-
-        while (alt_token != NULL) {
-            char *alt_token_copy = strdup(alt_token); 
-            if (alt_token_copy == NULL) {
-                t_args->failed_var_count += 1;
-                pthread_mutex_lock(t_args->out_log_mutex);
-                fprintf(t_args->out2, "VCF: Memory allocation failed for alt_token_copy.\n");
-                fflush(t_args->out2);
-                pthread_mutex_unlock(t_args->out_log_mutex);
-                continue;
+        // every chunk holds complete, newline terminated lines
+        char *line = chunk->data;
+        char *end = chunk->data + chunk->size;
+
+        while (line < end) {
+            char *next = (char *)memchr(line, '\n', end - line);
+            *next = '\0';
+            size_t len = next - line;
+
+            if (1 < len && line[0] != '#') {
+                t_args->line_count++;
+                vgx_process_line(t_args, line, &latest_chrom_index, &latest_core_index);
+                gfa_stream_sync(t_args->stream, GFA_STREAM_FLUSH_SIZE);
             }
-            latest_core_index = vgx_variate(t_args, &(t_args->seqs->chrs[chrom_index]), seq, alt_token_copy, id, order, offset, latest_core_index);
-            free(alt_token_copy);
 
-            alt_token = strtok_r(NULL, ",", &alt_saveptr);
-            order++;
+            line = next + 1;
         }
 
-        free(line);
+        line_chunk_put(queue, chunk);
     }
+
+    t_args->busy_ns = stats_now() - thread_start - t_args->idle_ns;
+    stats_add_thread("worker", t_args->thread_id, t_args->busy_ns, t_args->idle_ns);
+    stats_add_time(STATS_QUEUE_WAIT, t_args->idle_ns);
 }
 
-void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs) {
+void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs, gfa_file_t *gfa) {
 
     printf("[INFO] Processing variations...\n");
 
+    uint64_t main_start = stats_now();
+
     FILE *out_log;
     if (args->prefix == NULL) {
         char out_err_filename[10];
@@ -273,39 +366,29 @@ void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs) {
         fprintf(stderr, "Couldn't open error log file\n");
         exit(EXIT_FAILURE);
     }
-    fprintf(out_log, "vgx\n");
-    fprintf(out_log, "%s\n", args->gfa_path);
-    fprintf(out_log, "%d\n", args->thread_number);
 
     struct t_arg *t_args = (struct t_arg*)malloc(args->thread_number * sizeof(struct t_arg));
-    pthread_mutex_t queue_mutex   = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t cond_not_full  = PTHREAD_COND_INITIALIZER;
-    pthread_cond_t cond_not_empty = PTHREAD_COND_INITIALIZER;
     pthread_mutex_t out_log_mutex = PTHREAD_MUTEX_INITIALIZER;
-    pthread_mutex_init(&queue_mutex, NULL);
-    pthread_cond_init(&cond_not_full, NULL);
-    pthread_cond_init(&cond_not_empty, NULL);
     pthread_mutex_init(&out_log_mutex, NULL);
+    eventcount_t not_full, not_empty;
+    ec_init(&not_full);
+    ec_init(&not_empty);
     int exit_signal = 0;
 
     vg_queue_sync_t sync = {
-        .mutex = &queue_mutex,
-        .cond_not_full = &cond_not_full,
-        .cond_not_empty = &cond_not_empty,
+        .not_full = &not_full,
+        .not_empty = &not_empty,
         .exit_signal = &exit_signal
     };
 
     struct line_queue queue;
-    line_queue_init(&queue, args->tload_factor * args->thread_number);
+    line_queue_init(&queue, args->tload_factor * args->thread_number, (args->tload_factor + 1) * args->thread_number + 2);
+
+    gfa_stream_t *streams = (gfa_stream_t *)malloc(args->thread_number * sizeof(gfa_stream_t));
+    struct sv_cache *sv_cache = sv_cache_create(args->sv_cache_mb << 20);
 
     for (int i=0; i<args->thread_number; i++) {
-        char indexed_filename[strlen(args->gfa_path)+5];
-        snprintf(indexed_filename, sizeof(indexed_filename), "%s.%d", args->gfa_path, i+1);
-        FILE *out_thd = fopen(indexed_filename, "w");
-        if (out_thd == NULL) {
-            fprintf(stderr, "Couldn't open output file %s\n", indexed_filename);
-            exit(EXIT_FAILURE);
-        }
+        gfa_stream_open(&(streams[i]), gfa);
 
         t_args[i].core_id_index = ((uint64_t)(i)+1) << 32;
         t_args[i].thread_id = i+1;
@@ -316,8 +399,18 @@ void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs) {
         t_args[i].failed_var_count = 0;
         t_args[i].invalid_line_count = 0;
         t_args[i].bubble_count = 0;
-        t_args[i].out1 = out_thd;
-        t_args[i].out2 = out_log;
+        t_args[i].line_count = 0;
+        t_args[i].busy_ns = 0;
+        t_args[i].idle_ns = 0;
+        t_args[i].out_log = out_log;
+        t_args[i].stream = &(streams[i]);
+        t_args[i].ref_buf = NULL;
+        t_args[i].ref_buf_capacity = 0;
+        t_args[i].sv_cache = sv_cache;
+        t_args[i].sv_cores = NULL;
+        t_args[i].sv_cores_capacity = 0;
+        t_args[i].dedup = args->dedup;
+        dedup_window_init(&(t_args[i].dedup_window));
         t_args[i].queue = (void *)&(queue);
         t_args[i].sync = &sync;
         t_args[i].out_log_mutex = &out_log_mutex;
@@ -330,90 +423,118 @@ void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs) {
         tpool_add_work(tm, vgx_read_vcf_thd, t_args+i);
     }
 
-    uint64_t current_size = 1048576;
-    char *line = (char *)malloc(current_size);
-
-    FILE *file = fopen(args->vcf_path, "r");
+    bgzf_file_t *file = bgzf_open(args->vcf_path, args->thread_number);
     if (file == NULL) {
         fprintf(out_log, "VCF: Couldn't open file %s\n", args->vcf_path);
         exit(EXIT_FAILURE);
     }
 
-    int line_count = 0;
-    while (fgets(line, current_size, file) != NULL) {
-        size_t len = strlen(line);
-        int skip_line = 0;
-        
-        while (len == current_size - 1 && line[len - 1] != '\n') {
-            current_size *= 2;
-            char *temp_line = (char *)realloc(line, current_size);
-            if (!temp_line) {
-                fprintf(out_log, "VCF: Memory reallocation failed.\n");
-                free(line);
-                fclose(file);
-                return;
+    // fill chunks with complete lines. the partial line at the end of a chunk 
+    // is moved to the next one. the chunk is grown only if a single line does not fit.
+    struct line_chunk *chunk = line_chunk_get(&queue);
+    uint64_t reader_start = stats_now(), reader_wait = 0;
+
+    while (1) {
+        int64_t read_size = bgzf_read(file, chunk->data + chunk->size, chunk->capacity - chunk->size - 1);
+
+        if (read_size <= 0) {
+            if (read_size < 0) {
+                fprintf(out_log, "VCF: Couldn't read file %s\n", args->vcf_path);
+            }
+            if (chunk->size) {
+                if (chunk->data[chunk->size - 1] != '\n') {
+                    chunk->data[chunk->size++] = '\n';
+                }
+                line_queue_push(&queue, chunk, &sync, &reader_wait);
+            } else {
+                line_chunk_put(&queue, chunk);
             }
-            line = temp_line;
+            break;
+        }
+
+        chunk->size += read_size;
 
-            if (fgets(line + len, current_size - len, file) == NULL) {
-                skip_line = 1;
+        char *last_newline = (char *)memrchr(chunk->data, '\n', chunk->size);
+        if (last_newline == NULL) {
+            chunk->capacity *= 2;
+            char *temp = (char *)realloc(chunk->data, chunk->capacity);
+            if (temp == NULL) {
+                fprintf(out_log, "VCF: Memory reallocation failed.\n");
+                free(chunk->data);
+                free(chunk);
                 break;
             }
-            len = strlen(line);
-        }
-        
-        if (skip_line || len < 2 || line[0] == '#')
+            chunk->data = temp;
             continue;
-
-        if (line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-            len--;
         }
 
-        line_count++;
-        char *queue_line = strdup(line);
-        if (!queue_line) {
-            args->invalid_line_count += 1;
-            fprintf(out_log, "VCF: Memory allocation failed.\n");
-            continue;
+        struct line_chunk *next = line_chunk_get(&queue);
+        uint64_t complete_size = last_newline - chunk->data + 1;
+        if (args->dedup) {
+            complete_size = same_position_start(chunk->data, complete_size);
         }
-        line_queue_push(&queue, queue_line, &sync);
+        uint64_t rest_size = chunk->size - complete_size;
+        if (next->capacity <= rest_size) {
+            char *temp = (char *)realloc(next->data, chunk->capacity);
+            if (temp == NULL) {
+                fprintf(out_log, "VCF: Memory reallocation failed.\n");
+                free(next->data);
+                free(next);
+                free(chunk->data);
+                free(chunk);
+                break;
+            }
+            next->data = temp;
+            next->capacity = chunk->capacity;
+        }
+        memcpy(next->data, chunk->data + complete_size, rest_size);
+        next->size = rest_size;
+        chunk->size = complete_size;
+
+        line_queue_push(&queue, chunk, &sync, &reader_wait);
+        chunk = next;
     }
 
-    fclose(file);
+    bgzf_close(file);
 
-    pthread_mutex_lock(sync.mutex);
-    while (queue.size > 0) { 
-        pthread_cond_wait(sync.cond_not_full, sync.mutex);
-    }
-    pthread_mutex_unlock(sync.mutex);
+    stats_add_thread("reader", 0, stats_now() - reader_start - reader_wait, reader_wait);
+    stats_add_time(STATS_QUEUE_WAIT, reader_wait);
 
-    exit_signal = 1;
-    pthread_cond_broadcast(sync.cond_not_empty);
+    mpmc_wait_empty(&(queue.ring), sync.not_full);
+
+    __atomic_store_n(&exit_signal, 1, __ATOMIC_RELEASE);
+    ec_notify(sync.not_empty);
     tpool_wait(tm);
     tpool_destroy(tm);
-    pthread_mutex_destroy(sync.mutex);
-    pthread_cond_destroy(sync.cond_not_full);
-    pthread_cond_destroy(sync.cond_not_empty);
+    ec_destroy(sync.not_full);
+    ec_destroy(sync.not_empty);
 
+    int line_count = 0;
     for (int i=0; i<args->thread_number; i++) {
         args->failed_var_count += t_args[i].failed_var_count;
         args->invalid_line_count += t_args[i].invalid_line_count;
         args->bubble_count += t_args[i].bubble_count;
-        fclose(t_args[i].out1);
+        line_count += t_args[i].line_count;
+        gfa_stream_close(&(streams[i]));
+        free(t_args[i].ref_buf);
+        free(t_args[i].sv_cores);
+        stats_add_dedup(t_args[i].dedup_window.merged);
+        dedup_window_free(&(t_args[i].dedup_window));
     }
+    free(streams);
     free(t_args);
+    sv_cache_destroy(sv_cache);
 
-    while (queue.size) {
-        char *line = queue.lines[queue.front];
-        queue.front = (queue.front + 1) % queue.capacity;
-        queue.size--;
-        free(line);
-    }
-    free(queue.lines);
-    free(line);
+    line_queue_free(&queue);
 
     fclose(out_log);
 
+    uint64_t main_end = stats_now();
+    stats_add_time(STATS_VCF_READ, main_end - main_start);
+
     printf("[INFO] Ended processing %d lines. \n", line_count);
+    if (args->dedup) {
+        printf("[INFO] Merged %lu duplicate alleles.\n", stats_get_dedup());
+    }
+    printf("[INFO] VCF processing completed in %0.2f sec.\n", (main_end - main_start) / 1e9);
 }
\ No newline at end of file
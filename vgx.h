@@ -1,9 +1,15 @@
 #ifndef __VGX_H__
 #define __VGX_H__
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "struct_def.h"
 #include "utils.h"
+#include "fa_parser.h"
 #include "tpool.h"
+#include "bgzf.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -20,7 +26,8 @@
  *                           input options, including the path to the VCF file.
  * @param seqs               A pointer to the `ref_seq` structure holding the
  *                           reference sequences for variation processing.
+ * @param gfa                The output rGFA/GFA file that all threads append to.
  */
-void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs);
+void vgx_read_vcf(struct opt_arg *args, struct ref_seq *seqs, gfa_file_t *gfa);
 
 #endif
\ No newline at end of file